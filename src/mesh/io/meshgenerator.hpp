@@ -0,0 +1,82 @@
+#ifndef _MESH_MESHGENERATOR_HPP
+#define _MESH_MESHGENERATOR_HPP
+
+#include <vector>
+#include <cstdlib>
+#include <iostream>
+
+namespace ConservationLaw2D {
+	namespace Mesh {
+		namespace IO {
+			using namespace std;
+			/*! \brief Genera la mesh strutturata del rettangolo \f$ [x_0,x_1] \times [y_0,y_1] \f$:
+			nx per ny rettangoli, ognuno diviso in due triangoli lungo una diagonale alternata a scacchiera.
+			I poligoni hanno colore 0, i lati di bordo il colore del lato del rettangolo.
+			\param[out] mesh Mesh vuota da riempire
+			\param[in] nx Numero di suddivisioni lungo \f$ x \f$
+			\param[in] ny Numero di suddivisioni lungo \f$ y \f$
+			\param[in] cbottom Colore del lato \f$ y = y_0 \f$
+			\param[in] cright Colore del lato \f$ x = x_1 \f$
+			\param[in] ctop Colore del lato \f$ y = y_1 \f$
+			\param[in] cleft Colore del lato \f$ x = x_0 \f$ */
+			template <typename MESH>
+			void RectangleMesh( MESH& mesh, typename MESH::real_t x0, typename MESH::real_t x1,
+				typename MESH::real_t y0, typename MESH::real_t y1, size_t nx, size_t ny,
+				size_t cbottom = 1, size_t cright = 2, size_t ctop = 3, size_t cleft = 4 ) {
+				typedef typename MESH::real_t real_t;
+				typedef typename MESH::Vertex_ptr vertex_ptr;
+				typedef typename MESH::Polygon_ptr polygon_ptr;
+				typedef typename MESH::hedge_it hedge_it;
+
+				if ( nx == 0 || ny == 0 || !(x1 > x0) || !(y1 > y0) ) {
+					std::cerr << "Error: empty rectangle mesh!" << std::endl;
+					exit(1);
+				}
+				// Vertici, riga per riga: indice j*(nx+1)+i
+				vector<vertex_ptr> vhandle((nx+1)*(ny+1));
+				for (size_t j = 0; j <= ny; ++j)
+					for (size_t i = 0; i <= nx; ++i)
+						vhandle[j*(nx+1)+i] = mesh.addVertex( x0 + (x1-x0)*real_t(i)/nx, y0 + (y1-y0)*real_t(j)/ny );
+				// Triangoli (in senso antiorario)
+				vector<vertex_ptr> poly_vertex(3);
+				polygon_ptr tmpp;
+				for (size_t j = 0; j < ny; ++j) {
+					for (size_t i = 0; i < nx; ++i) {
+						vertex_ptr v00 = vhandle[j*(nx+1)+i],     v10 = vhandle[j*(nx+1)+i+1];
+						vertex_ptr v01 = vhandle[(j+1)*(nx+1)+i], v11 = vhandle[(j+1)*(nx+1)+i+1];
+						const bool diag = ( (i+j) % 2 == 0 );
+						poly_vertex[0] = v00;
+						poly_vertex[1] = v10;
+						poly_vertex[2] = diag ? v11 : v01;
+						tmpp = mesh.addPolygon( poly_vertex );
+						tmpp->setColor(0);
+						poly_vertex[0] = diag ? v00 : v10;
+						poly_vertex[1] = v11;
+						poly_vertex[2] = v01;
+						tmpp = mesh.addPolygon( poly_vertex );
+						tmpp->setColor(0);
+					}
+				}
+				// Lati di bordo: colore secondo la riga o la colonna dei vertici
+				for (hedge_it e = mesh.he_begin(); e != mesh.he_end(); ++e) {
+					if ( !(*e)->isBoundary() ) {
+						(*e)->setColor(0);
+						continue;
+					}
+					size_t a = (*e)->vertexS().getId(), b = (*e)->vertexE().getId();
+					size_t ia = a % (nx+1), ja = a / (nx+1), ib = b % (nx+1), jb = b / (nx+1);
+					if ( ja == 0 && jb == 0 )
+						(*e)->setColor(cbottom);
+					else if ( ia == nx && ib == nx )
+						(*e)->setColor(cright);
+					else if ( ja == ny && jb == ny )
+						(*e)->setColor(ctop);
+					else
+						(*e)->setColor(cleft);
+				}
+			} //RectangleMesh
+		} // IO
+	}
+}
+
+#endif
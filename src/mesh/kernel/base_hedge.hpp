@@ -74,6 +74,8 @@ namespace ConservationLaw2D {
 				inline HEdge const   & getTwinHEdge(void) const { return *twinhedge_; }
 				/*! \brief Restituisce l'halfedge gemello */
 				inline HEdge         & getTwinHEdge(void)       { return *twinhedge_; }
+				/*! \brief Restituisce l'indice dell'half-edge nella mesh */
+				size_t	getId(void)			const	{ return id_; }
 				/*! \brief Restituisce il colore del lato */
 				size_t	getColor(void) 		const	{ return color_; }
 				/*! \brief Assegna un colore al lato */
@@ -94,6 +96,8 @@ namespace ConservationLaw2D {
 				hedge_ptr	nexthedge_;
 				// Halfedge gemello (puo' essere nullo)
 				hedge_ptr	twinhedge_;
+				// Indice nella mesh
+				size_t		id_;
 				// Colore
 				size_t		color_;
 		};
@@ -40,6 +40,8 @@ namespace ConservationLaw2D {
 				inline real_t diam(void)	const;
 				
 				// TOPOLOGIA
+				/*! \brief Restituisce l'indice del poligono nella mesh */
+				size_t	getId(void)			const	{ return id_; }
 				/*! \brief Restituisce il colore del poligono */
 				size_t	getColor(void) 		const	{ return color_; }
 				/*! \brief Imposta il colore del poligono */
@@ -76,6 +78,7 @@ namespace ConservationLaw2D {
 			private:
 				// DATA
 				hedge_ptr	hedge_;
+				size_t		id_;
 				size_t		color_;
 		};
 		
@@ -129,7 +132,7 @@ namespace ConservationLaw2D {
 			do {
 				hedge_ptr hej = &(hei->getNextHEdge());
 				do {
-					diam = max(diam, pow(hei->vertexS().x()-hej->vertexS().x(),2)+pow(hei->vertexS().y()-hej->vertexS().y(),2));
+					diam = max(diam, real_t(pow(hei->vertexS().x()-hej->vertexS().x(),2)+pow(hei->vertexS().y()-hej->vertexS().y(),2)));
 					hej = &(hej->getNextHEdge());
 				} while ( hej != hedge_ );
 				hei = &(hei->getNextHEdge());
@@ -10,6 +10,16 @@ namespace ConservationLaw2D {
 		
 		using namespace std;
 
+		/*! \brief Tipologie di rinumerazione della mesh */
+		enum Ordering {
+			/*! \brief Reverse Cuthill-McKee sul grafo duale dei poligoni */
+			ORDERING_RCM,
+			/*! \brief Curva di Hilbert sui baricentri */
+			ORDERING_HILBERT,
+			/*! \brief Curva di Morton (Z-order) sui baricentri */
+			ORDERING_MORTON
+		};
+
 		template <typename KERNEL>
 		/*! \class BasePolygonalMesh
 			\brief Definizione della classe primitiva della Mesh
@@ -47,6 +57,18 @@ namespace ConservationLaw2D {
 				template <typename T>
 				static bool deleteAll( T* elm ) { delete elm; return true; }
 
+				// Ordinamento dei poligoni
+				void orderRCM( vector<size_t>& ) const;
+				void orderSFC( vector<size_t>&, bool ) const;
+				// Indice sulla curva di Hilbert di ordine 16
+				static unsigned long hilbertKey( unsigned long, unsigned long );
+				// Indice sulla curva di Morton di ordine 16
+				static unsigned long mortonKey( unsigned long, unsigned long );
+				// Raffinamento: nuovo half-edge con vertice iniziale, poligono e colore dati
+				static inline hedge_ptr newHEdge( vertex_ptr, polygon_ptr, size_t, hedge_list& );
+				// Raffinamento: nuovo poligono con il colore dato
+				static inline polygon_ptr newPolygon( size_t, polygon_list& );
+
 			public:
 				// Iteratori
 				/*! \brief Iteratore sui vertici */
@@ -75,6 +97,19 @@ namespace ConservationLaw2D {
 				/*! \brief Metodo per l'aggiunta di un poligono alla mesh
 				\param[in] v Lista dei puntatori ai vertici */
 				inline polygon_ptr	addPolygon	( const std::vector<vertex_ptr>& );
+				/*! \brief Rinumera vertici, half-edge e poligoni per migliorare la località in memoria
+				\param[in] type Tipo di ordinamento (ORDERING_RCM, ORDERING_HILBERT o ORDERING_MORTON)
+				\warning Gli elementi vengono riallocati: i puntatori precedenti non sono più validi */
+				void reorder( Ordering );
+				/*! \brief Raffinamento uniforme 1:4: ogni triangolo viene diviso in quattro unendo
+				i punti medi dei lati (raffinamento "red"), ogni altro poligono con n lati in n quadrilateri
+				unendo i punti medi dei lati al baricentro. Essendo uniforme, la mesh raffinata e' conforme
+				senza chiusure "green". Lati e poligoni figli ereditano il colore del padre (i lati interni
+				hanno colore 0) e i gemelli vengono collegati direttamente, senza ricerche sui vertici.
+				\warning Lati e poligoni vengono riallocati: i puntatori precedenti non sono più validi.
+				La numerazione originale diventa quella della mesh raffinata (figli di un poligono consecutivi);
+				la geometria memorizzata (es. init_geom() dei volumi finiti) va ricalcolata */
+				void refine( void );
 				
 				// LETTURA MESH
 				/*! \brief Restituisce il numero dei vertici */
@@ -90,6 +125,10 @@ namespace ConservationLaw2D {
 				hedge_ptr e(size_t i) const { return hedges_[i]; }
 				/*! \brief Restituisce l'i-esimo poligono */
 				polygon_ptr p(size_t i) const { return polygons_[i]; }
+				/*! \brief Restituisce il vertice con indice i nella numerazione originale */
+				vertex_ptr vOrig(size_t i) const { return vertices_[ vertexNew_.empty() ? i : vertexNew_[i] ]; }
+				/*! \brief Restituisce il poligono con indice i nella numerazione originale */
+				polygon_ptr pOrig(size_t i) const { return polygons_[ polygonNew_.empty() ? i : polygonNew_[i] ]; }
 
 				/*! \brief Restituisce l'iteratore al primo vertice */
 				vertex_it v_begin( void ) { return vertices_.begin(); }
@@ -130,6 +169,8 @@ namespace ConservationLaw2D {
 				hedge_list		hedges_;
 				polygon_list	polygons_;
 				bool			isTriangular_;
+				// Permutazioni: indice originale -> indice corrente
+				vector<size_t>	vertexNew_, polygonNew_;
 		};
 		
 		
@@ -141,6 +182,7 @@ namespace ConservationLaw2D {
 		inline typename KERNEL::Vertex_ptr BasePolygonalMesh<KERNEL>::addVertex(const real_t x, const real_t y) {
 			// Creo il vertice nella memoria
 			vertex_ptr vhandle( new Vertex() );
+			vhandle->id_ = vertices_.size();
 			// Imposto le coordinate
 			vhandle->setPosition(x, y);
 			// Salvo nella lista dei vertici
@@ -165,6 +207,7 @@ namespace ConservationLaw2D {
 				// Imposto il vertice iniziale
 				he[i]->vertex_ = v[i];
 				// Aggiungo alla lista dei lati
+				he[i]->id_ = hedges_.size();
 				hedges_.push_back(he[i]);
 			}
 			// Aggiungo al poligono uno dei suoi lati
@@ -215,6 +258,7 @@ namespace ConservationLaw2D {
 				}
 			}
 			// Aggiungo il poligono alla mesh
+			poly->id_ = polygons_.size();
 			polygons_.push_back(poly);
 			// Resituisco il puntatore
 			return poly;
@@ -222,16 +266,369 @@ namespace ConservationLaw2D {
 		
 		template <typename KERNEL>
 		void BasePolygonalMesh<KERNEL>::stats( void ) {
+			// Banda e distanza media degli indici tra poligoni adiacenti
+			size_t bandwidth(0), npairs(0);
+			double meandist(0.0);
+			for (size_t i = 0; i < nE(); ++i) {
+				if ( hedges_[i]->isBoundary() ) continue;
+				size_t a = hedges_[i]->polygon_->id_;
+				size_t b = hedges_[i]->twinhedge_->polygon_->id_;
+				size_t d = (a > b) ? a-b : b-a;
+				bandwidth = max(bandwidth, d);
+				meandist += d;
+				npairs++;
+			}
+			if ( npairs ) meandist /= npairs;
 			cout << "Mesh stats:" << endl;
 			cout << " Number of vertices: " << nV() << endl;
 			cout << " Number of hedges: " << nE() << endl;
 			cout << " Number of polygons: " << nP() << endl;
 			cout << " isTriangular: " << ((isTriangular_)?"yes":"no") << endl;
+			cout << "Locality stats:" << endl;
+			cout << " Polygon bandwidth: " << bandwidth << endl;
+			cout << " Mean neighbour distance: " << meandist << endl;
 			cout << "Memory stats:" << endl;
 			cout << " Vertices: " << (nV() * sizeof(Vertex))/1024. << " Kbytes" << endl;
 			cout << " Edges: " << (nE() * sizeof(HEdge))/1024. << " Kbytes" << endl;
 			cout << " Vertices: " << (nP() * sizeof(Polygon))/1024. << " Kbytes" << endl;
 		}
+
+		template <typename KERNEL>
+		void BasePolygonalMesh<KERNEL>::reorder( Ordering type ) {
+			// Nuovo ordine dei poligoni: porder[nuovo] = vecchio
+			vector<size_t> porder;
+			if ( type == ORDERING_RCM )
+				orderRCM(porder);
+			else
+				orderSFC(porder, type == ORDERING_HILBERT);
+			// Vertici e half-edge seguono l'ordine dei poligoni
+			const size_t none = nV()+nE()+nP();
+			vector<size_t> vnew(nV(), none), henew(nE(), none);
+			vector<size_t> vorder, heorder;
+			vorder.reserve(nV());
+			heorder.reserve(nE());
+			for (size_t i = 0; i < nP(); ++i) {
+				hedge_ptr he = polygons_[porder[i]]->hedge_;
+				do {
+					henew[he->id_] = heorder.size();
+					heorder.push_back(he->id_);
+					if ( vnew[he->vertex_->id_] == none ) {
+						vnew[he->vertex_->id_] = vorder.size();
+						vorder.push_back(he->vertex_->id_);
+					}
+					he = he->nexthedge_;
+				} while ( he != polygons_[porder[i]]->hedge_ );
+			}
+			// Vertici isolati in coda
+			for (size_t i = 0; i < nV(); ++i) {
+				if ( vnew[i] == none ) {
+					vnew[i] = vorder.size();
+					vorder.push_back(i);
+				}
+			}
+			vector<size_t> pnew(nP());
+			for (size_t i = 0; i < nP(); ++i) pnew[porder[i]] = i;
+			// Rialloco gli elementi nel nuovo ordine (memoria contigua)
+			vertex_list		vertices(nV());
+			hedge_list		hedges(nE());
+			polygon_list	polygons(nP());
+			for (size_t i = 0; i < nP(); ++i) {
+				polygons[i] = new Polygon( *polygons_[porder[i]] );
+				polygons[i]->id_ = i;
+			}
+			for (size_t i = 0; i < nE(); ++i) {
+				hedges[i] = new HEdge( *hedges_[heorder[i]] );
+				hedges[i]->id_ = i;
+			}
+			for (size_t i = 0; i < nV(); ++i) {
+				vertices[i] = new Vertex( *vertices_[vorder[i]] );
+				vertices[i]->id_ = i;
+			}
+			// Aggiorno i collegamenti
+			for (size_t i = 0; i < nP(); ++i)
+				polygons[i]->hedge_ = hedges[ henew[polygons[i]->hedge_->id_] ];
+			for (size_t i = 0; i < nE(); ++i) {
+				hedge_ptr he = hedges[i];
+				he->vertex_ = vertices[ vnew[he->vertex_->id_] ];
+				he->polygon_ = polygons[ pnew[he->polygon_->id_] ];
+				he->nexthedge_ = hedges[ henew[he->nexthedge_->id_] ];
+				if ( he->twinhedge_ ) he->twinhedge_ = hedges[ henew[he->twinhedge_->id_] ];
+			}
+			for (size_t i = 0; i < nV(); ++i)
+				for (size_t j = 0; j < vertices[i]->hedges_.size(); ++j)
+					vertices[i]->hedges_[j] = hedges[ henew[vertices[i]->hedges_[j]->id_] ];
+			// Aggiorno le permutazioni rispetto alla numerazione originale
+			if ( vertexNew_.empty() ) {
+				vertexNew_ = vnew;
+				polygonNew_ = pnew;
+			} else {
+				for (size_t i = 0; i < vertexNew_.size(); ++i) vertexNew_[i] = vnew[vertexNew_[i]];
+				for (size_t i = 0; i < polygonNew_.size(); ++i) polygonNew_[i] = pnew[polygonNew_[i]];
+			}
+			// Elimino i vecchi elementi
+			std::remove_if(vertices_.begin(), vertices_.end(), deleteAll<Vertex>);
+			std::remove_if(hedges_.begin(), hedges_.end(), deleteAll<HEdge>);
+			std::remove_if(polygons_.begin(), polygons_.end(), deleteAll<Polygon>);
+			vertices_.swap(vertices);
+			hedges_.swap(hedges);
+			polygons_.swap(polygons);
+		}
+
+		template <typename KERNEL>
+		inline typename KERNEL::HEdge_ptr BasePolygonalMesh<KERNEL>::newHEdge( vertex_ptr v, polygon_ptr p, size_t color, hedge_list& hedges ) {
+			hedge_ptr he( new HEdge() );
+			he->vertex_ = v;
+			he->polygon_ = p;
+			he->twinhedge_ = NULL;
+			he->color_ = color;
+			he->id_ = hedges.size();
+			hedges.push_back(he);
+			return he;
+		}
+
+		template <typename KERNEL>
+		inline typename KERNEL::Polygon_ptr BasePolygonalMesh<KERNEL>::newPolygon( size_t color, polygon_list& polygons ) {
+			polygon_ptr p( new Polygon() );
+			p->color_ = color;
+			p->id_ = polygons.size();
+			polygons.push_back(p);
+			return p;
+		}
+
+		template <typename KERNEL>
+		void BasePolygonalMesh<KERNEL>::refine( void ) {
+			const size_t ne = nE(), np = nP();
+			// Punto medio di ogni lato, condiviso dai due half-edge gemelli
+			vector<vertex_ptr> mid(ne, static_cast<vertex_ptr>(NULL));
+			for (size_t i = 0; i < ne; ++i) {
+				if ( mid[i] ) continue;
+				mid[i] = addVertex( hedges_[i]->BaseHEdge<KERNEL>::xm(), hedges_[i]->BaseHEdge<KERNEL>::ym() );
+				if ( hedges_[i]->twinhedge_ ) mid[hedges_[i]->twinhedge_->id_] = mid[i];
+			}
+			// Figli di ogni half-edge: il primo parte dal vertice iniziale, il secondo arriva a quello finale
+			vector<hedge_ptr> first(ne), second(ne);
+			hedge_list		hedges;
+			polygon_list	polygons;
+			hedges.reserve(4*ne);
+			polygons.reserve(4*np);
+			vector<hedge_ptr> phe, inner;
+			for (size_t p = 0; p < np; ++p) {
+				polygon_ptr parent = polygons_[p];
+				// Lati del padre: phe[i] va da v_i a v_{i+1} con punto medio m_i
+				phe.clear();
+				hedge_ptr he = parent->hedge_;
+				do {
+					phe.push_back(he);
+					he = he->nexthedge_;
+				} while ( he != parent->hedge_ );
+				const size_t n = phe.size();
+				inner.resize(n);
+				if ( n == 3 ) {
+					// Triangoli d'angolo (v_i, m_i, m_{i-1})
+					for (size_t i = 0; i < 3; ++i) {
+						hedge_ptr pi = phe[i], pp = phe[(i+2)%3];
+						polygon_ptr c = newPolygon(parent->color_, polygons);
+						hedge_ptr a = newHEdge(pi->vertex_, c, pi->color_, hedges);
+						hedge_ptr b = newHEdge(mid[pi->id_], c, 0, hedges);
+						hedge_ptr d = newHEdge(mid[pp->id_], c, pp->color_, hedges);
+						a->nexthedge_ = b;
+						b->nexthedge_ = d;
+						d->nexthedge_ = a;
+						c->hedge_ = b;
+						first[pi->id_] = a;
+						second[pp->id_] = d;
+						// Lato interno m_i -> m_{i-1}
+						inner[i] = b;
+					}
+					// Triangolo centrale (m_0, m_1, m_2)
+					polygon_ptr c = newPolygon(parent->color_, polygons);
+					hedge_ptr e[3];
+					for (size_t i = 0; i < 3; ++i)
+						e[i] = newHEdge(mid[phe[i]->id_], c, 0, hedges);
+					for (size_t i = 0; i < 3; ++i) {
+						e[i]->nexthedge_ = e[(i+1)%3];
+						// m_i -> m_{i+1} e' gemello di m_{i+1} -> m_i
+						e[i]->twinhedge_ = inner[(i+1)%3];
+						inner[(i+1)%3]->twinhedge_ = e[i];
+					}
+					c->hedge_ = e[0];
+				} else {
+					// Quadrilateri (v_i, m_i, c, m_{i-1}) attorno al baricentro
+					vertex_ptr g = addVertex( parent->BasePolygon<KERNEL>::cx(), parent->BasePolygon<KERNEL>::cy() );
+					vector<hedge_ptr> out(n);
+					for (size_t i = 0; i < n; ++i) {
+						hedge_ptr pi = phe[i], pp = phe[(i+n-1)%n];
+						polygon_ptr c = newPolygon(parent->color_, polygons);
+						hedge_ptr a = newHEdge(pi->vertex_, c, pi->color_, hedges);
+						hedge_ptr b = newHEdge(mid[pi->id_], c, 0, hedges);
+						hedge_ptr d = newHEdge(g, c, 0, hedges);
+						hedge_ptr f = newHEdge(mid[pp->id_], c, pp->color_, hedges);
+						a->nexthedge_ = b;
+						b->nexthedge_ = d;
+						d->nexthedge_ = f;
+						f->nexthedge_ = a;
+						c->hedge_ = b;
+						first[pi->id_] = a;
+						second[pp->id_] = f;
+						// m_i -> g e g -> m_{i-1}
+						inner[i] = b;
+						out[i] = d;
+					}
+					for (size_t i = 0; i < n; ++i) {
+						// m_i -> g e' gemello di g -> m_i, nel quadrilatero successivo
+						inner[i]->twinhedge_ = out[(i+1)%n];
+						out[(i+1)%n]->twinhedge_ = inner[i];
+					}
+				}
+			}
+			// Gemelli tra figli di lati interni: (v_i -> m) con (m -> v_i) del gemello
+			for (size_t i = 0; i < ne; ++i) {
+				if ( !hedges_[i]->twinhedge_ ) continue;
+				size_t t = hedges_[i]->twinhedge_->id_;
+				first[i]->twinhedge_ = second[t];
+				second[i]->twinhedge_ = first[t];
+			}
+			// Lati uscenti dai vertici: quelli di bordo, altrimenti uno qualsiasi
+			for (size_t i = 0; i < nV(); ++i)
+				vertices_[i]->hedges_.clear();
+			for (size_t i = 0; i < hedges.size(); ++i)
+				if ( hedges[i]->isBoundary() )
+					hedges[i]->vertex_->hedges_.push_back(hedges[i]);
+			for (size_t i = 0; i < hedges.size(); ++i)
+				if ( hedges[i]->vertex_->hedges_.empty() )
+					hedges[i]->vertex_->hedges_.push_back(hedges[i]);
+			// Elimino i vecchi elementi
+			std::remove_if(hedges_.begin(), hedges_.end(), deleteAll<HEdge>);
+			std::remove_if(polygons_.begin(), polygons_.end(), deleteAll<Polygon>);
+			hedges_.swap(hedges);
+			polygons_.swap(polygons);
+			// La nuova numerazione e' quella originale
+			vertexNew_.clear();
+			polygonNew_.clear();
+		}
+
+		template <typename KERNEL>
+		void BasePolygonalMesh<KERNEL>::orderRCM( vector<size_t>& order ) const {
+			// Grado di ogni poligono nel grafo duale
+			vector<size_t> degree(nP(), 0);
+			for (size_t i = 0; i < nE(); ++i)
+				if ( !hedges_[i]->isBoundary() ) degree[hedges_[i]->polygon_->id_]++;
+			order.clear();
+			order.reserve(nP());
+			vector<char> visited(nP(), 0);
+			vector<size_t> level(nP(), 0);
+			vector<size_t> neigh;
+			for (size_t seed = 0; seed < nP(); ++seed) {
+				if ( visited[seed] ) continue;
+				// Nodo di partenza pseudo-periferico: visite in ampiezza ripetute
+				// a partire dal nodo di grado minimo dell'ultimo livello
+				size_t start = seed, ecc = 0;
+				for (int iter = 0; iter < 8; ++iter) {
+					vector<size_t> bfs(1, start);
+					vector<char> seen(visited);
+					seen[start] = 1;
+					level[start] = 0;
+					for (size_t k = 0; k < bfs.size(); ++k) {
+						hedge_ptr he = polygons_[bfs[k]]->hedge_;
+						do {
+							if ( !he->isBoundary() ) {
+								size_t j = he->twinhedge_->polygon_->id_;
+								if ( !seen[j] ) {
+									seen[j] = 1;
+									level[j] = level[bfs[k]]+1;
+									bfs.push_back(j);
+								}
+							}
+							he = he->nexthedge_;
+						} while ( he != polygons_[bfs[k]]->hedge_ );
+					}
+					size_t last = bfs.back();
+					if ( iter > 0 && level[last] <= ecc ) break;
+					ecc = level[last];
+					for (size_t k = bfs.size(); k-- > 0 && level[bfs[k]] == ecc; )
+						if ( degree[bfs[k]] <= degree[last] ) last = bfs[k];
+					start = last;
+				}
+				// Cuthill-McKee: vicini in ordine di grado crescente
+				size_t first = order.size();
+				order.push_back(start);
+				visited[start] = 1;
+				for (size_t k = first; k < order.size(); ++k) {
+					neigh.clear();
+					hedge_ptr he = polygons_[order[k]]->hedge_;
+					do {
+						if ( !he->isBoundary() ) {
+							size_t j = he->twinhedge_->polygon_->id_;
+							if ( !visited[j] ) {
+								visited[j] = 1;
+								neigh.push_back(j);
+							}
+						}
+						he = he->nexthedge_;
+					} while ( he != polygons_[order[k]]->hedge_ );
+					for (size_t a = 1; a < neigh.size(); ++a)
+						for (size_t b = a; b > 0 && degree[neigh[b]] < degree[neigh[b-1]]; --b)
+							swap(neigh[b], neigh[b-1]);
+					order.insert(order.end(), neigh.begin(), neigh.end());
+				}
+			}
+			// Ordine inverso
+			std::reverse(order.begin(), order.end());
+		}
+
+		template <typename KERNEL>
+		void BasePolygonalMesh<KERNEL>::orderSFC( vector<size_t>& order, bool hilbert ) const {
+			// Bounding box dei baricentri
+			vector<real_t> cx(nP()), cy(nP());
+			real_t xmin(0), xmax(0), ymin(0), ymax(0);
+			for (size_t i = 0; i < nP(); ++i) {
+				cx[i] = polygons_[i]->BasePolygon<KERNEL>::cx();
+				cy[i] = polygons_[i]->BasePolygon<KERNEL>::cy();
+				if ( i == 0 || cx[i] < xmin ) xmin = cx[i];
+				if ( i == 0 || cx[i] > xmax ) xmax = cx[i];
+				if ( i == 0 || cy[i] < ymin ) ymin = cy[i];
+				if ( i == 0 || cy[i] > ymax ) ymax = cy[i];
+			}
+			// Stesso fattore di scala nelle due direzioni
+			real_t h = max(xmax-xmin, ymax-ymin);
+			if ( h <= 0 ) h = 1;
+			vector< pair<unsigned long, size_t> > keys(nP());
+			for (size_t i = 0; i < nP(); ++i) {
+				unsigned long ix = (unsigned long)( 65535.0 * (cx[i]-xmin) / h );
+				unsigned long iy = (unsigned long)( 65535.0 * (cy[i]-ymin) / h );
+				keys[i] = make_pair( hilbert ? hilbertKey(ix, iy) : mortonKey(ix, iy), i );
+			}
+			std::sort(keys.begin(), keys.end());
+			order.resize(nP());
+			for (size_t i = 0; i < nP(); ++i) order[i] = keys[i].second;
+		}
+
+		template <typename KERNEL>
+		unsigned long BasePolygonalMesh<KERNEL>::hilbertKey( unsigned long x, unsigned long y ) {
+			unsigned long d(0);
+			for (unsigned long s = 1UL << 15; s > 0; s >>= 1) {
+				unsigned long rx = (x & s) > 0;
+				unsigned long ry = (y & s) > 0;
+				d += s * s * ((3 * rx) ^ ry);
+				// Rotazione del quadrante
+				if ( ry == 0 ) {
+					if ( rx == 1 ) {
+						x = s-1 - (x & (s-1));
+						y = s-1 - (y & (s-1));
+					}
+					swap(x, y);
+				}
+			}
+			return d;
+		}
+
+		template <typename KERNEL>
+		unsigned long BasePolygonalMesh<KERNEL>::mortonKey( unsigned long x, unsigned long y ) {
+			unsigned long d(0);
+			for (unsigned int b = 0; b < 16; ++b)
+				d |= ((x >> b) & 1UL) << (2*b) | ((y >> b) & 1UL) << (2*b+1);
+			return d;
+		}
 	}
 }
 
@@ -46,6 +46,8 @@ namespace ConservationLaw2D {
 				// Imposta la posizione del vertice
 				/*! \brief Imposta le coordinate \f$ (x,y) \f$ del vertice */
 				void setPosition(const real_t x, const real_t y) { x_ = x; y_ = y; }
+				/*! \brief Restituisce l'indice del vertice nella mesh */
+				size_t getId(void) const { return id_; }
 				
 				// CIRCOLATORI
 				/*! \brief Circolatore sui vertici adiacenti al vertice dato */
@@ -72,6 +74,8 @@ namespace ConservationLaw2D {
 				// DATA
 				// Coordinate
 				real_t x_, y_;
+				// Indice nella mesh
+				size_t id_;
 				// Lista HEdge per vertici degeneri
 				vector<hedge_ptr> hedges_;
 		};
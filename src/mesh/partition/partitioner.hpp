@@ -0,0 +1,581 @@
+#ifndef _MESH_PARTITIONER_HPP
+#define _MESH_PARTITIONER_HPP
+
+#include <vector>
+#include <queue>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <cstdlib>
+
+namespace ConservationLaw2D {
+	namespace Mesh {
+
+		using namespace std;
+
+		/*! \brief Metodi di partizione della mesh */
+		enum PartitionMethod {
+			/*! \brief Bisezione ricorsiva sulle coordinate dei baricentri */
+			PARTITION_RCB,
+			/*! \brief Bisezione ricorsiva multilivello del grafo duale con raffinamento */
+			PARTITION_MULTILEVEL
+		};
+
+		template <typename MESH>
+		/*! \class Partitioner
+			\brief Partizione dei poligoni della mesh in parti di peso bilanciato
+
+			Lavora sul grafo duale (un nodo per poligono, un arco per ogni coppia di half-edge gemelli).
+			Con PARTITION_RCB le parti sono ottenute dividendo ricorsivamente i baricentri lungo la
+			direzione piu' lunga del loro bounding box, alla mediana pesata; con PARTITION_MULTILEVEL ogni
+			bisezione contrae il grafo (accoppiamento sugli archi piu' pesanti), divide il grafo piu'
+			piccolo facendo crescere una regione da piu' semi e riporta la divisione sui livelli piu' fini
+			migliorandola con spostamenti alla Fiduccia-Mattheyses, per ridurre i lati tagliati.
+			Con k parti non potenza di due le bisezioni dividono il peso in proporzione al numero di parti.
+
+			I pesi per cella (di default 1) possono essere, per esempio, il costo misurato della cella
+			o il numero di lati di bordo (setBoundaryWeights()). Il risultato e' il vettore delle parti
+			e, per ogni parte, la lista delle sue celle in ordine crescente di indice: l'ordinamento della
+			mesh (reorder()) si conserva all'interno delle parti.
+			\warning Gli indici sono quelli correnti dei poligoni (getId()): dopo reorder() o refine()
+			il partizionatore va ricostruito */
+		class Partitioner {
+			public:
+				/*! \brief Costruttore, costruisce il grafo duale e i baricentri */
+				Partitioner( MESH& mesh );
+
+				/*! \brief Imposta il peso di ogni cella (non negativo) */
+				void setWeights( const vector<double>& w );
+				/*! \brief Peso di ogni cella pari a \f$ w_c + n_b w_f \f$, con \f$ n_b \f$ numero di lati di bordo
+				\param[in] cell Peso della cella
+				\param[in] face Peso di ogni lato di bordo */
+				void setBoundaryWeights( double cell, double face );
+				/*! \brief Divide la mesh in nparts parti
+				\param[in] nparts Numero di parti
+				\param[in] method Metodo (PARTITION_RCB o PARTITION_MULTILEVEL) */
+				void partition( size_t nparts, PartitionMethod method = PARTITION_MULTILEVEL );
+
+				/*! \brief Numero di parti */
+				size_t nParts( void ) const { return nparts_; }
+				/*! \brief Parte di ogni cella */
+				const vector<int>& part( void ) const { return part_; }
+				/*! \brief Celle raggruppate per parte */
+				const vector<size_t>& order( void ) const { return order_; }
+				/*! \brief Prima posizione in order() delle celle della parte k */
+				size_t begin( size_t k ) const { return start_[k]; }
+				/*! \brief Posizione in order() successiva all'ultima cella della parte k */
+				size_t end( size_t k ) const { return start_[k+1]; }
+				/*! \brief Peso della parte k */
+				double partWeight( size_t k ) const;
+				/*! \brief Numero di lati tra celle di parti diverse */
+				size_t edgeCut( void ) const;
+				/*! \brief Rapporto tra il peso massimo di una parte e il peso medio */
+				double imbalance( void ) const;
+
+			private:
+				// Grafo in formato CSR con pesi dei nodi e degli archi
+				struct Graph {
+					vector<size_t> xadj, adj;
+					vector<double> ewgt, vwgt;
+					size_t n( void ) const { return xadj.size()-1; }
+				};
+				// Bisezioni ricorsive sulle celle date, parti da first a first+k-1
+				void recurseRCB( vector<size_t>& cells, size_t k, int first );
+				void recurseGraph( vector<size_t>& cells, size_t k, int first );
+				// Sottografo indotto dalle celle date (indici locali)
+				void subgraph( const vector<size_t>& cells, Graph& g );
+				// Bisezione multilivello: side[v] = 0 per circa una frazione frac del peso
+				void bisect( const Graph& g, double frac, vector<char>& side );
+				// Contrazione con accoppiamento sugli archi piu' pesanti
+				void coarsen( const Graph& g, Graph& c, vector<size_t>& cmap );
+				// Bisezione del grafo piu' piccolo facendo crescere una regione da piu' semi
+				void initialBisection( const Graph& g, double frac, double tol, vector<char>& side ) const;
+				// Raffinamento alla Fiduccia-Mattheyses con vincolo di bilanciamento
+				static void refine( const Graph& g, double frac, double tol, vector<char>& side );
+				// Peso degli archi tagliati
+				static double cut( const Graph& g, const vector<char>& side );
+				// Tolleranza sul peso della parte 0
+				static double tolerance( const Graph& g );
+
+				MESH& mesh_;
+				Graph graph_;
+				vector<double> cx_, cy_;
+				vector<int> part_;
+				vector<size_t> order_, start_, local_;
+				size_t nparts_;
+				// Generatore pseudo-casuale (congruenziale) per l'ordine di visita: risultati ripetibili
+				unsigned long seed_;
+		};
+
+		// ===========
+		// DEFINITIONS
+		// ===========
+
+		template <typename MESH>
+		Partitioner<MESH>::Partitioner( MESH& mesh ):mesh_(mesh),nparts_(0),seed_(1) {
+			typedef typename MESH::polygon_ptr polygon_ptr;
+			typedef typename MESH::hedge_ptr hedge_ptr;
+			const size_t np = mesh_.nP();
+			graph_.xadj.assign(1, 0);
+			graph_.adj.clear();
+			cx_.resize(np); cy_.resize(np);
+			for (size_t i = 0; i < np; ++i) {
+				polygon_ptr p = mesh_.p(i);
+				hedge_ptr e0 = &(*p->beginE()), e = e0;
+				size_t n(0);
+				cx_[i] = cy_[i] = 0;
+				do {
+					cx_[i] += e->vertexS().x();
+					cy_[i] += e->vertexS().y();
+					if ( !e->isBoundary() )
+						graph_.adj.push_back(e->polygonR().getId());
+					++n;
+					e = &(e->getNextHEdge());
+				} while ( e != e0 );
+				cx_[i] /= n;
+				cy_[i] /= n;
+				graph_.xadj.push_back(graph_.adj.size());
+			}
+			graph_.ewgt.assign(graph_.adj.size(), 1.0);
+			graph_.vwgt.assign(np, 1.0);
+		}
+
+		template <typename MESH>
+		void Partitioner<MESH>::setWeights( const vector<double>& w ) {
+			if ( w.size() != mesh_.nP() || *min_element(w.begin(), w.end()) < 0 ) {
+				std::cerr << "Error: partition weights must be one non negative value per cell!" << std::endl;
+				exit(1);
+			}
+			graph_.vwgt = w;
+		}
+
+		template <typename MESH>
+		void Partitioner<MESH>::setBoundaryWeights( double cell, double face ) {
+			vector<double> w(mesh_.nP());
+			for (size_t i = 0; i < mesh_.nP(); ++i) {
+				// Lati del poligono meno i lati interni (archi del grafo)
+				size_t n(0);
+				typename MESH::hedge_ptr e0 = &(*mesh_.p(i)->beginE()), e = e0;
+				do { ++n; e = &(e->getNextHEdge()); } while ( e != e0 );
+				w[i] = cell + face*( n - (graph_.xadj[i+1]-graph_.xadj[i]) );
+			}
+			setWeights(w);
+		}
+
+		template <typename MESH>
+		void Partitioner<MESH>::partition( size_t nparts, PartitionMethod method ) {
+			const size_t np = mesh_.nP();
+			nparts_ = max(nparts, size_t(1));
+			part_.assign(np, 0);
+			local_.assign(np, 0);
+			seed_ = 1;
+			vector<size_t> cells(np);
+			for (size_t i = 0; i < np; ++i) cells[i] = i;
+			if ( method == PARTITION_RCB )
+				recurseRCB(cells, nparts_, 0);
+			else
+				recurseGraph(cells, nparts_, 0);
+			// Celle raggruppate per parte (ordinamento per conteggio, stabile)
+			start_.assign(nparts_+1, 0);
+			for (size_t i = 0; i < np; ++i) start_[part_[i]+1]++;
+			for (size_t k = 0; k < nparts_; ++k) start_[k+1] += start_[k];
+			order_.resize(np);
+			vector<size_t> fill(start_.begin(), start_.end()-1);
+			for (size_t i = 0; i < np; ++i) order_[fill[part_[i]]++] = i;
+		}
+
+		template <typename MESH>
+		double Partitioner<MESH>::partWeight( size_t k ) const {
+			double w(0);
+			for (size_t i = start_[k]; i < start_[k+1]; ++i) w += graph_.vwgt[order_[i]];
+			return w;
+		}
+
+		template <typename MESH>
+		size_t Partitioner<MESH>::edgeCut( void ) const {
+			size_t c(0);
+			for (size_t v = 0; v < graph_.n(); ++v)
+				for (size_t j = graph_.xadj[v]; j < graph_.xadj[v+1]; ++j)
+					if ( part_[v] != part_[graph_.adj[j]] ) ++c;
+			return c/2;
+		}
+
+		template <typename MESH>
+		double Partitioner<MESH>::imbalance( void ) const {
+			double wmax(0), wtot(0);
+			for (size_t k = 0; k < nparts_; ++k) {
+				const double w = partWeight(k);
+				wmax = max(wmax, w);
+				wtot += w;
+			}
+			return wtot > 0 ? wmax*nparts_/wtot : 1.0;
+		}
+
+		template <typename MESH>
+		void Partitioner<MESH>::recurseRCB( vector<size_t>& cells, size_t k, int first ) {
+			if ( k == 1 || cells.size() <= 1 ) {
+				for (size_t i = 0; i < cells.size(); ++i) part_[cells[i]] = first;
+				return;
+			}
+			const size_t k0 = k/2;
+			// Direzione piu' lunga del bounding box dei baricentri
+			double xmin(cx_[cells[0]]), xmax(xmin), ymin(cy_[cells[0]]), ymax(ymin), wtot(0);
+			for (size_t i = 0; i < cells.size(); ++i) {
+				xmin = min(xmin, cx_[cells[i]]); xmax = max(xmax, cx_[cells[i]]);
+				ymin = min(ymin, cy_[cells[i]]); ymax = max(ymax, cy_[cells[i]]);
+				wtot += graph_.vwgt[cells[i]];
+			}
+			const vector<double>& coord = ( xmax-xmin >= ymax-ymin ) ? cx_ : cy_;
+			vector< pair<double,size_t> > key(cells.size());
+			for (size_t i = 0; i < cells.size(); ++i) key[i] = make_pair(coord[cells[i]], cells[i]);
+			sort(key.begin(), key.end());
+			// Mediana pesata: la prima parte prende k0/k del peso
+			const double target = wtot*k0/k;
+			size_t m(0);
+			double w(0);
+			while ( m < key.size() && w + 0.5*graph_.vwgt[key[m].second] <= target )
+				w += graph_.vwgt[key[m++].second];
+			m = max(size_t(1), min(m, key.size()-1));
+			vector<size_t> c0(m), c1(key.size()-m);
+			for (size_t i = 0; i < key.size(); ++i) {
+				if ( i < m ) c0[i] = key[i].second;
+				else c1[i-m] = key[i].second;
+			}
+			vector<size_t>().swap(cells);
+			recurseRCB(c0, k0, first);
+			recurseRCB(c1, k-k0, first+int(k0));
+		}
+
+		template <typename MESH>
+		void Partitioner<MESH>::recurseGraph( vector<size_t>& cells, size_t k, int first ) {
+			if ( k == 1 || cells.size() <= 1 ) {
+				for (size_t i = 0; i < cells.size(); ++i) part_[cells[i]] = first;
+				return;
+			}
+			const size_t k0 = k/2;
+			vector<char> side;
+			{
+				Graph g;
+				subgraph(cells, g);
+				bisect(g, double(k0)/k, side);
+			}
+			vector<size_t> c0, c1;
+			for (size_t i = 0; i < cells.size(); ++i) {
+				if ( side[i] == 0 ) c0.push_back(cells[i]);
+				else c1.push_back(cells[i]);
+			}
+			vector<size_t>().swap(cells);
+			recurseGraph(c0, k0, first);
+			recurseGraph(c1, k-k0, first+int(k0));
+		}
+
+		template <typename MESH>
+		void Partitioner<MESH>::subgraph( const vector<size_t>& cells, Graph& g ) {
+			// Indice locale + 1 delle celle dell'insieme, 0 per le altre
+			for (size_t i = 0; i < cells.size(); ++i) local_[cells[i]] = i+1;
+			g.xadj.assign(1, 0);
+			g.adj.clear(); g.ewgt.clear();
+			g.vwgt.resize(cells.size());
+			for (size_t i = 0; i < cells.size(); ++i) {
+				const size_t v = cells[i];
+				g.vwgt[i] = graph_.vwgt[v];
+				for (size_t j = graph_.xadj[v]; j < graph_.xadj[v+1]; ++j) {
+					const size_t u = local_[graph_.adj[j]];
+					if ( u == 0 ) continue;
+					g.adj.push_back(u-1);
+					g.ewgt.push_back(graph_.ewgt[j]);
+				}
+				g.xadj.push_back(g.adj.size());
+			}
+			for (size_t i = 0; i < cells.size(); ++i) local_[cells[i]] = 0;
+		}
+
+		template <typename MESH>
+		double Partitioner<MESH>::tolerance( const Graph& g ) {
+			double wtot(0), wmax(0);
+			for (size_t v = 0; v < g.n(); ++v) {
+				wtot += g.vwgt[v];
+				wmax = max(wmax, g.vwgt[v]);
+			}
+			// 0.5% del peso, ma almeno un nodo (sui livelli contratti i nodi sono pesanti)
+			return max(0.005*wtot, wmax);
+		}
+
+		template <typename MESH>
+		void Partitioner<MESH>::bisect( const Graph& g, double frac, vector<char>& side ) {
+			// Livelli contratti: levels[0] = g
+			vector<const Graph*> levels(1, &g);
+			vector<Graph*> owned;
+			vector< vector<size_t> > cmaps;
+			while ( levels.back()->n() > 100 ) {
+				Graph* c = new Graph;
+				vector<size_t> cmap;
+				coarsen(*levels.back(), *c, cmap);
+				// Contrazione ferma (per esempio grafo a stella): mi fermo
+				if ( c->n() > 0.9*levels.back()->n() ) {
+					delete c;
+					break;
+				}
+				owned.push_back(c);
+				levels.push_back(c);
+				cmaps.push_back(vector<size_t>());
+				cmaps.back().swap(cmap);
+			}
+			// Bisezione del grafo piu' piccolo
+			vector<char> s;
+			initialBisection(*levels.back(), frac, tolerance(*levels.back()), s);
+			// Proiezione sui livelli piu' fini e raffinamento
+			for (size_t l = levels.size()-1; l > 0; --l) {
+				const vector<size_t>& cmap = cmaps[l-1];
+				vector<char> fine(cmap.size());
+				for (size_t v = 0; v < cmap.size(); ++v) fine[v] = s[cmap[v]];
+				s.swap(fine);
+				refine(*levels[l-1], frac, tolerance(*levels[l-1]), s);
+			}
+			side.swap(s);
+			for (size_t i = 0; i < owned.size(); ++i) delete owned[i];
+		}
+
+		template <typename MESH>
+		void Partitioner<MESH>::coarsen( const Graph& g, Graph& c, vector<size_t>& cmap ) {
+			const size_t n = g.n();
+			const size_t UNMATCHED = size_t(-1);
+			// Ordine di visita casuale
+			vector<size_t> perm(n);
+			for (size_t v = 0; v < n; ++v) perm[v] = v;
+			for (size_t v = n; v > 1; --v) {
+				seed_ = (seed_*1103515245UL + 12345UL) % 2147483648UL;
+				swap(perm[v-1], perm[seed_ % v]);
+			}
+			// Accoppio ogni nodo con il vicino libero collegato dall'arco piu' pesante
+			vector<size_t> match(n, UNMATCHED);
+			cmap.assign(n, 0);
+			size_t nc(0);
+			for (size_t i = 0; i < n; ++i) {
+				const size_t v = perm[i];
+				if ( match[v] != UNMATCHED ) continue;
+				size_t best = v;
+				double wbest = -1;
+				for (size_t j = g.xadj[v]; j < g.xadj[v+1]; ++j) {
+					const size_t u = g.adj[j];
+					if ( match[u] == UNMATCHED && u != v && g.ewgt[j] > wbest ) {
+						best = u;
+						wbest = g.ewgt[j];
+					}
+				}
+				match[v] = best;
+				match[best] = v;
+				cmap[v] = cmap[best] = nc++;
+			}
+			// Grafo contratto: archi paralleli sommati, archi interni alla coppia eliminati
+			c.xadj.assign(1, 0);
+			c.adj.clear(); c.ewgt.clear();
+			c.vwgt.assign(nc, 0);
+			vector<size_t> pos(nc, UNMATCHED);
+			// Nodi fini di ogni nodo contratto
+			vector<size_t> first(nc, UNMATCHED), second(nc, UNMATCHED);
+			for (size_t v = 0; v < n; ++v) {
+				if ( first[cmap[v]] == UNMATCHED ) first[cmap[v]] = v;
+				else second[cmap[v]] = v;
+			}
+			for (size_t cv = 0; cv < nc; ++cv) {
+				const size_t start = c.adj.size();
+				for (int m = 0; m < 2; ++m) {
+					const size_t v = ( m == 0 ) ? first[cv] : second[cv];
+					if ( v == UNMATCHED ) continue;
+					c.vwgt[cv] += g.vwgt[v];
+					for (size_t j = g.xadj[v]; j < g.xadj[v+1]; ++j) {
+						const size_t cu = cmap[g.adj[j]];
+						if ( cu == cv ) continue;
+						if ( pos[cu] == UNMATCHED || pos[cu] < start ) {
+							pos[cu] = c.adj.size();
+							c.adj.push_back(cu);
+							c.ewgt.push_back(g.ewgt[j]);
+						} else {
+							c.ewgt[pos[cu]] += g.ewgt[j];
+						}
+					}
+				}
+				c.xadj.push_back(c.adj.size());
+			}
+		}
+
+		template <typename MESH>
+		void Partitioner<MESH>::initialBisection( const Graph& g, double frac, double tol, vector<char>& side ) const {
+			const size_t n = g.n();
+			double wtot(0);
+			for (size_t v = 0; v < n; ++v) wtot += g.vwgt[v];
+			const double target = frac*wtot;
+			// Semi: il nodo piu' lontano (in salti) dal nodo 0 e alcuni nodi equispaziati negli indici
+			vector<size_t> seeds;
+			{
+				vector<size_t> dist(n, size_t(-1)), queue(1, 0);
+				dist[0] = 0;
+				for (size_t h = 0; h < queue.size(); ++h)
+					for (size_t j = g.xadj[queue[h]]; j < g.xadj[queue[h]+1]; ++j)
+						if ( dist[g.adj[j]] == size_t(-1) ) {
+							dist[g.adj[j]] = dist[queue[h]] + 1;
+							queue.push_back(g.adj[j]);
+						}
+				seeds.push_back(queue.back());
+			}
+			for (size_t t = 0; t < 7 && t < n; ++t) seeds.push_back((t*n)/7);
+			double bestCut(-1), bestViol(0);
+			for (size_t t = 0; t < seeds.size(); ++t) {
+				// Regione 0 cresciuta dal seme aggiungendo il nodo di frontiera con guadagno massimo
+				vector<char> s(n, 1);
+				vector<double> gain(n, 0);
+				for (size_t v = 0; v < n; ++v)
+					for (size_t j = g.xadj[v]; j < g.xadj[v+1]; ++j) gain[v] -= g.ewgt[j];
+				priority_queue< pair<double,size_t> > front;
+				front.push(make_pair(gain[seeds[t]], seeds[t]));
+				double w0(0);
+				size_t next(0);
+				while ( w0 < target ) {
+					size_t v = n;
+					while ( !front.empty() ) {
+						const pair<double,size_t> top = front.top();
+						front.pop();
+						if ( s[top.second] == 1 && top.first == gain[top.second] ) {
+							v = top.second;
+							break;
+						}
+					}
+					// Frontiera vuota (grafo non connesso): prendo il primo nodo libero
+					if ( v == n ) {
+						while ( next < n && s[next] == 0 ) ++next;
+						if ( next == n ) break;
+						v = next;
+					}
+					if ( w0 + g.vwgt[v] > target + tol && w0 > 0 ) break;
+					s[v] = 0;
+					w0 += g.vwgt[v];
+					for (size_t j = g.xadj[v]; j < g.xadj[v+1]; ++j) {
+						const size_t u = g.adj[j];
+						if ( s[u] == 0 ) continue;
+						gain[u] += 2*g.ewgt[j];
+						front.push(make_pair(gain[u], u));
+					}
+				}
+				refine(g, frac, tol, s);
+				double ws(0);
+				for (size_t v = 0; v < n; ++v) if ( s[v] == 0 ) ws += g.vwgt[v];
+				const double viol = max(0.0, fabs(ws-target)-tol), c = cut(g, s);
+				if ( bestCut < 0 || viol < bestViol || (viol == bestViol && c < bestCut) ) {
+					bestCut = c;
+					bestViol = viol;
+					side.swap(s);
+				}
+			}
+		}
+
+		template <typename MESH>
+		void Partitioner<MESH>::refine( const Graph& g, double frac, double tol, vector<char>& side ) {
+			const size_t n = g.n();
+			double wtot(0), w0(0);
+			for (size_t v = 0; v < n; ++v) {
+				wtot += g.vwgt[v];
+				if ( side[v] == 0 ) w0 += g.vwgt[v];
+			}
+			const double target = frac*wtot;
+			// Al massimo tanti spostamenti senza miglioramenti prima di fermare un passaggio
+			const size_t limit = max(size_t(50), n/50);
+			vector<double> gain(n);
+			vector<char> locked(n);
+			vector<size_t> moves;
+			for (int pass = 0; pass < 8; ++pass) {
+				// Guadagno dello spostamento: peso degli archi verso l'altra parte meno quelli interni
+				priority_queue< pair<double,size_t> > queue[2];
+				for (size_t v = 0; v < n; ++v) {
+					gain[v] = 0;
+					bool boundary = false;
+					for (size_t j = g.xadj[v]; j < g.xadj[v+1]; ++j) {
+						if ( side[g.adj[j]] != side[v] ) {
+							gain[v] += g.ewgt[j];
+							boundary = true;
+						} else {
+							gain[v] -= g.ewgt[j];
+						}
+					}
+					if ( boundary ) queue[int(side[v])].push(make_pair(gain[v], v));
+				}
+				std::fill(locked.begin(), locked.end(), 0);
+				moves.clear();
+				double c = cut(g, side);
+				double bestCut = c, bestViol = max(0.0, fabs(w0-target)-tol);
+				const double cut0 = bestCut, viol0 = bestViol;
+				size_t bestMoves(0), stall(0);
+				for (;;) {
+					// Nodo valido con guadagno massimo per ogni parte
+					size_t cand[2] = { n, n };
+					for (int sd = 0; sd < 2; ++sd) {
+						while ( !queue[sd].empty() ) {
+							const pair<double,size_t> top = queue[sd].top();
+							if ( !locked[top.second] && side[top.second] == sd && top.first == gain[top.second] ) {
+								cand[sd] = top.second;
+								break;
+							}
+							queue[sd].pop();
+						}
+					}
+					// Scelta: se sbilanciato, dalla parte troppo pesante; altrimenti il guadagno migliore
+					// tra gli spostamenti che restano nella tolleranza
+					int from = -1;
+					if ( w0 > target + tol ) from = 0;
+					else if ( w0 < target - tol ) from = 1;
+					else {
+						for (int sd = 0; sd < 2; ++sd) {
+							const size_t v = cand[sd];
+							if ( v == n ) continue;
+							const double w0new = ( sd == 0 ) ? w0 - g.vwgt[v] : w0 + g.vwgt[v];
+							if ( fabs(w0new - target) > tol ) continue;
+							if ( from < 0 || gain[v] > gain[cand[from]] ) from = sd;
+						}
+					}
+					if ( from < 0 || cand[from] == n ) break;
+					const size_t v = cand[from];
+					queue[from].pop();
+					// Sposto v
+					side[v] = char(1-from);
+					w0 += ( from == 0 ) ? -g.vwgt[v] : g.vwgt[v];
+					c -= gain[v];
+					locked[v] = 1;
+					moves.push_back(v);
+					gain[v] = -gain[v];
+					for (size_t j = g.xadj[v]; j < g.xadj[v+1]; ++j) {
+						const size_t u = g.adj[j];
+						gain[u] += ( side[u] == side[v] ) ? -2*g.ewgt[j] : 2*g.ewgt[j];
+						if ( !locked[u] ) queue[int(side[u])].push(make_pair(gain[u], u));
+					}
+					const double viol = max(0.0, fabs(w0-target)-tol);
+					if ( viol < bestViol || (viol == bestViol && c < bestCut) ) {
+						bestCut = c;
+						bestViol = viol;
+						bestMoves = moves.size();
+						stall = 0;
+					} else if ( ++stall > limit ) {
+						break;
+					}
+				}
+				// Annullo gli spostamenti successivi al migliore
+				for (size_t m = moves.size(); m > bestMoves; --m) {
+					const size_t v = moves[m-1];
+					w0 += ( side[v] == 0 ) ? -g.vwgt[v] : g.vwgt[v];
+					side[v] = char(1-side[v]);
+				}
+				if ( !(bestViol < viol0 || bestCut < cut0) ) break;
+			}
+		}
+
+		template <typename MESH>
+		double Partitioner<MESH>::cut( const Graph& g, const vector<char>& side ) {
+			double c(0);
+			for (size_t v = 0; v < g.n(); ++v)
+				for (size_t j = g.xadj[v]; j < g.xadj[v+1]; ++j)
+					if ( side[v] != side[g.adj[j]] ) c += g.ewgt[j];
+			return 0.5*c;
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,270 @@
+#ifndef _MESH_POINTLOCATOR_HPP
+#define _MESH_POINTLOCATOR_HPP
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+namespace ConservationLaw2D {
+	namespace Mesh {
+
+		using namespace std;
+
+		template <typename MESH>
+		/*! \class PointLocator
+			\brief Localizzazione di punti sui poligoni della mesh
+
+			Griglia uniforme sui bounding box dei poligoni (in formato CSR: per ogni cella
+			della griglia la lista dei poligoni che la intersecano) e copia compatta dei vertici
+			e dei vicini di ogni poligono, per non seguire i puntatori della mesh durante le ricerche.
+			Oltre alla ricerca sulla griglia sono disponibili la ricerca per cammino lungo i lati
+			a partire da un poligono vicino e il poligono piu' vicino per i punti fuori dalla mesh.
+			\warning I poligoni devono essere convessi e orientati in senso antiorario.
+			Gli indici restituiti sono quelli correnti dei poligoni (getId()): dopo reorder() o refine()
+			il localizzatore va ricostruito con build()
+		*/
+		class PointLocator {
+			public:
+				/*! \brief Tipo di dato per numeri reali, per esempio \c double o \c float */
+				typedef typename MESH::real_t	real_t;
+				/*! \brief Indice restituito se il punto non e' in nessun poligono */
+				enum { NOPOLYGON = -1 };
+
+				/*! \brief Costruttore, costruisce la griglia
+				\param[in] mesh Mesh
+				\param[in] density Numero di celle della griglia per poligono */
+				PointLocator( MESH& mesh, real_t density = 1.0 ):mesh_(mesh),density_(density) { build(); }
+
+				/*! \brief Ricostruisce la griglia e la copia dei poligoni */
+				void build( void );
+
+				/*! \brief Vero se il punto e' nel poligono (bordo compreso)
+				\param[in] p Indice del poligono */
+				inline bool contains( size_t p, real_t x, real_t y ) const;
+				/*! \brief Restituisce il poligono che contiene il punto, NOPOLYGON se fuori dalla mesh */
+				inline size_t locate( real_t x, real_t y ) const;
+				/*! \brief Ricerca per cammino lungo i lati a partire dal poligono \c hint: conveniente
+				per punti vicini al precedente; se il cammino esce dalla mesh si usa la griglia */
+				inline size_t locate( real_t x, real_t y, size_t hint ) const;
+				/*! \brief Restituisce il poligono che contiene il punto o, se il punto e' fuori dalla
+				mesh, quello con il baricentro piu' vicino */
+				inline size_t nearest( real_t x, real_t y ) const;
+				/*! \brief Localizza un insieme di punti: ogni ricerca parte dal risultato della
+				precedente, quindi punti ordinati (per esempio lungo una linea) costano pochi passi
+				\param[in] x Ascisse dei punti
+				\param[in] y Ordinate dei punti
+				\param[out] ids Poligoni trovati
+				\param[in] fallback Se vero, per i punti fuori dalla mesh restituisce il poligono piu' vicino */
+				void locate( const vector<real_t>& x, const vector<real_t>& y, vector<size_t>& ids, bool fallback = false ) const;
+
+				/*! \brief Restituisce il numero di celle della griglia lungo x */
+				size_t nBinsX( void ) const { return nx_; }
+				/*! \brief Restituisce il numero di celle della griglia lungo y */
+				size_t nBinsY( void ) const { return ny_; }
+
+			private:
+				// Cella della griglia contenente la coordinata (limitata alla griglia)
+				inline size_t binX( real_t x ) const;
+				inline size_t binY( real_t y ) const;
+				// Lato del poligono piu' violato dal punto (-1 se il punto e' dentro)
+				inline int outsideEdge( size_t p, real_t x, real_t y ) const;
+
+				MESH&			mesh_;
+				real_t			density_;
+				// Griglia
+				real_t			xmin_, ymin_, dx_, dy_, tol_;
+				size_t			nx_, ny_;
+				vector<size_t>	binStart_, binList_;
+				// Vertici e vicini dei poligoni: il lato k va dal vertice k al k+1
+				vector<size_t>	polyStart_, polyNb_;
+				vector<real_t>	polyX_, polyY_;
+				// Baricentri
+				vector<real_t>	cx_, cy_;
+		};
+
+		// ===========
+		// DEFINITIONS
+		// ===========
+
+		template <typename MESH>
+		void PointLocator<MESH>::build( void ) {
+			typedef typename MESH::polygon_ptr polygon_ptr;
+			typedef typename MESH::hedge_ptr hedge_ptr;
+			const size_t np = mesh_.nP();
+			// Copia dei vertici e dei vicini
+			polyStart_.assign(1, 0);
+			polyX_.clear(); polyY_.clear(); polyNb_.clear();
+			cx_.resize(np); cy_.resize(np);
+			xmin_ = ymin_ = 0;
+			real_t xmax(0), ymax(0);
+			for (size_t i = 0; i < np; ++i) {
+				polygon_ptr p = mesh_.p(i);
+				hedge_ptr e0 = &(*p->beginE()), e = e0;
+				size_t n(0);
+				cx_[i] = cy_[i] = 0;
+				do {
+					real_t x = e->vertexS().x(), y = e->vertexS().y();
+					polyX_.push_back(x);
+					polyY_.push_back(y);
+					polyNb_.push_back( e->isBoundary() ? size_t(NOPOLYGON) : e->polygonR().getId() );
+					cx_[i] += x;
+					cy_[i] += y;
+					if ( (i == 0 && n == 0) || x < xmin_ ) xmin_ = x;
+					if ( (i == 0 && n == 0) || x > xmax ) xmax = x;
+					if ( (i == 0 && n == 0) || y < ymin_ ) ymin_ = y;
+					if ( (i == 0 && n == 0) || y > ymax ) ymax = y;
+					++n;
+					e = &(e->getNextHEdge());
+				} while ( e != e0 );
+				cx_[i] /= n;
+				cy_[i] /= n;
+				polyStart_.push_back(polyX_.size());
+			}
+			// Griglia con circa density celle per poligono, celle quasi quadrate
+			const real_t w = max(xmax-xmin_, real_t(1e-30)), h = max(ymax-ymin_, real_t(1e-30));
+			const real_t nbins = max(real_t(1), density_*np);
+			nx_ = max(size_t(1), size_t(ceil(sqrt(nbins*w/h))));
+			ny_ = max(size_t(1), size_t(ceil(nbins/nx_)));
+			dx_ = w/nx_;
+			dy_ = h/ny_;
+			tol_ = 1e-12*max(w,h)*max(w,h);
+			// Conteggio e riempimento delle liste (due passate)
+			binStart_.assign(nx_*ny_+1, 0);
+			for (int pass = 0; pass < 2; ++pass) {
+				if ( pass == 1 ) {
+					for (size_t b = 0; b < nx_*ny_; ++b) binStart_[b+1] += binStart_[b];
+					binList_.resize(binStart_[nx_*ny_]);
+				}
+				vector<size_t> fill(binStart_.begin(), binStart_.end()-1);
+				for (size_t i = 0; i < np; ++i) {
+					real_t bx0 = polyX_[polyStart_[i]], bx1 = bx0, by0 = polyY_[polyStart_[i]], by1 = by0;
+					for (size_t k = polyStart_[i]+1; k < polyStart_[i+1]; ++k) {
+						bx0 = min(bx0, polyX_[k]); bx1 = max(bx1, polyX_[k]);
+						by0 = min(by0, polyY_[k]); by1 = max(by1, polyY_[k]);
+					}
+					for (size_t j = binY(by0); j <= binY(by1); ++j)
+						for (size_t k = binX(bx0); k <= binX(bx1); ++k) {
+							if ( pass == 0 )
+								binStart_[j*nx_+k+1]++;
+							else
+								binList_[fill[j*nx_+k]++] = i;
+						}
+				}
+			}
+		}
+
+		template <typename MESH>
+		inline size_t PointLocator<MESH>::binX( real_t x ) const {
+			real_t f = (x-xmin_)/dx_;
+			return ( f <= 0 ) ? 0 : min( size_t(f), nx_-1 );
+		}
+
+		template <typename MESH>
+		inline size_t PointLocator<MESH>::binY( real_t y ) const {
+			real_t f = (y-ymin_)/dy_;
+			return ( f <= 0 ) ? 0 : min( size_t(f), ny_-1 );
+		}
+
+		template <typename MESH>
+		inline int PointLocator<MESH>::outsideEdge( size_t p, real_t x, real_t y ) const {
+			const size_t k0 = polyStart_[p], k1 = polyStart_[p+1];
+			int worst(-1);
+			real_t wval(-tol_);
+			for (size_t k = k0; k < k1; ++k) {
+				const size_t kn = ( k+1 < k1 ) ? k+1 : k0;
+				// Prodotto vettoriale (lato) x (punto - vertice): negativo se il punto e' a destra del lato
+				real_t c = (polyX_[kn]-polyX_[k])*(y-polyY_[k]) - (polyY_[kn]-polyY_[k])*(x-polyX_[k]);
+				if ( c < wval ) {
+					wval = c;
+					worst = int(k-k0);
+				}
+			}
+			return worst;
+		}
+
+		template <typename MESH>
+		inline bool PointLocator<MESH>::contains( size_t p, real_t x, real_t y ) const {
+			return outsideEdge(p, x, y) < 0;
+		}
+
+		template <typename MESH>
+		inline size_t PointLocator<MESH>::locate( real_t x, real_t y ) const {
+			if ( x < xmin_ || y < ymin_ || x > xmin_+nx_*dx_ || y > ymin_+ny_*dy_ )
+				return size_t(NOPOLYGON);
+			const size_t b = binY(y)*nx_ + binX(x);
+			for (size_t k = binStart_[b]; k < binStart_[b+1]; ++k)
+				if ( contains(binList_[k], x, y) )
+					return binList_[k];
+			return size_t(NOPOLYGON);
+		}
+
+		template <typename MESH>
+		inline size_t PointLocator<MESH>::locate( real_t x, real_t y, size_t hint ) const {
+			if ( hint >= cx_.size() )
+				return locate(x, y);
+			// Attraversa il lato piu' violato finche' il punto non e' dentro; il numero di passi
+			// e' limitato per non girare a vuoto attorno a poligoni degeneri
+			size_t p = hint;
+			const size_t maxsteps = 4*(nx_+ny_) + 16;
+			for (size_t step = 0; step < maxsteps; ++step) {
+				int k = outsideEdge(p, x, y);
+				if ( k < 0 )
+					return p;
+				size_t nb = polyNb_[polyStart_[p]+k];
+				if ( nb == size_t(NOPOLYGON) )
+					break;
+				p = nb;
+			}
+			return locate(x, y);
+		}
+
+		template <typename MESH>
+		inline size_t PointLocator<MESH>::nearest( real_t x, real_t y ) const {
+			size_t p = locate(x, y);
+			if ( p != size_t(NOPOLYGON) )
+				return p;
+			// Anelli di celle sempre piu' grandi attorno alla cella del punto (proiettato sulla griglia):
+			// le celle dell'anello r+1 distano almeno r*min(dx,dy) dal punto
+			const long bx = long(binX(x)), by = long(binY(y));
+			const real_t d = min(dx_, dy_);
+			real_t best(-1);
+			const long rmax = long(max(nx_, ny_));
+			for (long r = 0; r <= rmax; ++r) {
+				for (long j = by-r; j <= by+r; ++j) {
+					if ( j < 0 || j >= long(ny_) ) continue;
+					const long step = ( j == by-r || j == by+r ) ? 1 : 2*r;
+					for (long i = bx-r; i <= bx+r; i += max(step, 1L)) {
+						if ( i < 0 || i >= long(nx_) ) continue;
+						const size_t b = size_t(j)*nx_ + size_t(i);
+						for (size_t k = binStart_[b]; k < binStart_[b+1]; ++k) {
+							const size_t q = binList_[k];
+							const real_t dist = (cx_[q]-x)*(cx_[q]-x) + (cy_[q]-y)*(cy_[q]-y);
+							if ( best < 0 || dist < best ) {
+								best = dist;
+								p = q;
+							}
+						}
+					}
+				}
+				if ( best >= 0 && best <= (r*d)*(r*d) )
+					break;
+			}
+			return p;
+		}
+
+		template <typename MESH>
+		void PointLocator<MESH>::locate( const vector<real_t>& x, const vector<real_t>& y, vector<size_t>& ids, bool fallback ) const {
+			ids.resize(x.size());
+			size_t hint = size_t(NOPOLYGON);
+			for (size_t i = 0; i < x.size(); ++i) {
+				size_t p = ( hint == size_t(NOPOLYGON) ) ? locate(x[i], y[i]) : locate(x[i], y[i], hint);
+				if ( p == size_t(NOPOLYGON) && fallback )
+					p = nearest(x[i], y[i]);
+				ids[i] = p;
+				hint = p;
+			}
+		}
+	}
+}
+
+#endif
@@ -8,10 +8,6 @@
 #include <Eigen/Core>
 #include <cmath>
 
-// Dimensione dello spazio di stato
-// [p, u, v]
-#define DIMENSION 3
-
 
 namespace ConservationLaw2D {
 	namespace Model {
@@ -23,13 +19,15 @@ namespace ConservationLaw2D {
 		
 			public:
 				// Defininzioni vettori
+				/*! \brief Dimensione dello spazio di stato \f$ (p, u, v) \f$ */
+				enum { DIM = 3 };
 				// Vettore per la soluzione
 				/*! \brief Tipo di dato reale, per esempio \c float o \c double */
 				typedef T	real_t;
 				/*! \brief Tipo per i vettori contenenti la soluzione */
-				typedef Eigen::Matrix<T, DIMENSION, 1>	SolType;
+				typedef Eigen::Matrix<T, DIM, 1>	SolType;
 				/*! \brief Tipo per le matrici contenenti il flusso \f$ m \times 2 \f$ */
-				typedef Eigen::Matrix<T, DIMENSION, 2>	FluxType;
+				typedef Eigen::Matrix<T, DIM, 2>	FluxType;
 				/*! \brief Costruttore del modello
 				\param[in] rho0 Densità del gas nello stato non perturbato
 				\param[in] K0 Modulo di elasticità lineare */
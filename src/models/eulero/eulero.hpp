@@ -8,10 +8,6 @@
 #include <Eigen/Core>
 #include <cmath>
 
-// Dimensione dello spazio di stato
-// [rho, rho u, rho v, rho e]
-#define DIMENSION 4
-
 namespace ConservationLaw2D {
 	/*! \namespace Model
 	\brief Namespace che contiene le varie tipologie di modelli */
@@ -24,13 +20,17 @@ namespace ConservationLaw2D {
 		
 			public:
 				// Defininzioni vettori
+				/*! \brief Dimensione dello spazio di stato \f$ (\rho, \rho u, \rho v, \rho e) \f$ */
+				enum { DIM = 4 };
 				// Vettore per la soluzione
 				/*! \brief Tipo di dato reale, per esempio \c float o \c double */
 				typedef T	real_t;
 				/*! \brief Tipo per i vettori contenenti la soluzione */
-				typedef Eigen::Matrix<T, DIMENSION, 1>	SolType;
+				typedef Eigen::Matrix<T, DIM, 1>	SolType;
 				/*! \brief Tipo per le matrici contenenti il flusso \f$ m \times 2 \f$ */
-				typedef Eigen::Matrix<T, DIMENSION, 2>	FluxType;
+				typedef Eigen::Matrix<T, DIM, 2>	FluxType;
+				/*! \brief Numero di valori nella cache per cella (vedi CellCache) */
+				enum { NCACHE = 8 };
 				/*! \brief Costruttore del modello */
 				/*! \param[in] gamma Costante \f$ \gamma \f$ del gas */
 				Eulero( real_t gamma ):GAMMA(gamma) {}
@@ -75,6 +75,23 @@ namespace ConservationLaw2D {
 					return w;
 				}
 				
+				/*! \brief Calcola una volta per cella le grandezze usate dai flussi numerici
+				\param[in] q Stato in variabili conservate
+				\param[out] w \f$ (\rho, u, v, p, c, H, \sqrt{\rho}, \rho e) \f$ */
+				inline void CellCache( const SolType& q, real_t* w ) const {
+					const real_t ir = 1.0/q[0];
+					const real_t u = q[1]*ir, v = q[2]*ir;
+					const real_t p = (GAMMA-1)*( q[3]-0.5*q[0]*(u*u+v*v) );
+					w[0] = q[0];
+					w[1] = u;
+					w[2] = v;
+					w[3] = p;
+					w[4] = sqrt( GAMMA*p*ir );
+					w[5] = ( q[3]+p )*ir;
+					w[6] = sqrt( q[0] );
+					w[7] = q[3];
+				}
+				
 				// Controlla se lo stato e' consistente
 				/*! \brief Controlla che lo stato del sistema sia consistente, cioè \f$ \rho > 0 \f$ e \f$ p > 0 \f$  */
 				inline bool ConsistentState( const SolType& q ) const {
@@ -4,6 +4,8 @@
 // Flusso di Godunov
 // Problema di Riemann risolto con approssimazione HLLC
 
+#include <solvers/fluxes/faceblock.hpp>
+
 namespace ConservationLaw2D {
 	namespace NumericalFlux {
 		
@@ -76,9 +78,112 @@ namespace ConservationLaw2D {
 					FFlux[2] = Flux[1]*ny + Flux[2]*nx;
 					return FFlux;
 				}
+
+				/*! \brief Resistuisce il flusso numerico su un blocco di lati
+				
+				Stesso schema di operator(), con le scelte sulle velocita' SL, S* e SR
+				trasformate in selezioni per essere vettorizzato lungo i lati del blocco. */
+				CONSLAW2D_TARGET_CLONES
+				void block( FaceBlock<real_t,4>& b ) const {
+					const real_t g = model.gamma();
+					for (int k = 0; k < FaceBlock<real_t,4>::Width; ++k) {
+						const real_t nx = b.nx[k], ny = b.ny[k];
+						// Stati nel sistema ruotato
+						const real_t rl = b.ql[0][k], rr = b.qr[0][k];
+						const real_t ml = b.ql[1][k]*nx + b.ql[2][k]*ny;
+						const real_t mr = b.qr[1][k]*nx + b.qr[2][k]*ny;
+						const real_t tl = - b.ql[1][k]*ny + b.ql[2][k]*nx;
+						const real_t tr = - b.qr[1][k]*ny + b.qr[2][k]*nx;
+						const real_t el = b.ql[3][k], er = b.qr[3][k];
+						// Variabili primitive ed entalpia
+						const real_t ul = ml/rl, vl = tl/rl, ur = mr/rr, vr = tr/rr;
+						const real_t pl = (g-1)*( el - 0.5*rl*(ul*ul+vl*vl) );
+						const real_t pr = (g-1)*( er - 0.5*rr*(ur*ur+vr*vr) );
+						const real_t Hl = (el+pl)/rl, Hr = (er+pr)/rr;
+						real_t F[4];
+						solve(g, rl, ul, vl, pl, Hl, sqrt(rl), el, rr, ur, vr, pr, Hr, sqrt(rr), er, F);
+						// Torno alle variabili cartesiane
+						b.flux[0][k] = F[0];
+						b.flux[1][k] = F[1]*nx - F[2]*ny;
+						b.flux[2][k] = F[1]*ny + F[2]*nx;
+						b.flux[3][k] = F[3];
+					}
+				}
+
+				/*! \brief Resistuisce il flusso numerico su un blocco di lati, partendo dalle
+				grandezze per cella gia' calcolate (vedi Model::Eulero::CellCache) */
+				CONSLAW2D_TARGET_CLONES
+				void block( CachedFaceBlock<real_t,4,MODEL::NCACHE>& b ) const {
+					const real_t g = model.gamma();
+					for (int k = 0; k < CachedFaceBlock<real_t,4,MODEL::NCACHE>::Width; ++k) {
+						const real_t nx = b.nx[k], ny = b.ny[k];
+						// Velocita' nel sistema ruotato
+						const real_t ul =   b.wl[1][k]*nx + b.wl[2][k]*ny;
+						const real_t vl = - b.wl[1][k]*ny + b.wl[2][k]*nx;
+						const real_t ur =   b.wr[1][k]*nx + b.wr[2][k]*ny;
+						const real_t vr = - b.wr[1][k]*ny + b.wr[2][k]*nx;
+						real_t F[4];
+						solve(g, b.wl[0][k], ul, vl, b.wl[3][k], b.wl[5][k], b.wl[6][k], b.wl[7][k],
+						         b.wr[0][k], ur, vr, b.wr[3][k], b.wr[5][k], b.wr[6][k], b.wr[7][k], F);
+						// Torno alle variabili cartesiane
+						b.flux[0][k] = F[0];
+						b.flux[1][k] = F[1]*nx - F[2]*ny;
+						b.flux[2][k] = F[1]*ny + F[2]*nx;
+						b.flux[3][k] = F[3];
+					}
+				}
 			private:
+				// Flusso nel sistema ruotato dalle variabili primitive (rho, u, v, p), entalpia,
+				// radice della densita' ed energia per unita' di volume dei due stati
+				static CONSLAW2D_ALWAYS_INLINE void solve( const real_t g,
+						const real_t rl, const real_t ul, const real_t vl, const real_t pl,
+						const real_t Hl, const real_t srhol, const real_t el,
+						const real_t rr, const real_t ur, const real_t vr, const real_t pr,
+						const real_t Hr, const real_t srhor, const real_t er,
+						real_t* F ) {
+					// Stati e flussi nel sistema ruotato
+					const real_t ml = rl*ul, mr = rr*ur, tl = rl*vl, tr = rr*vr;
+					const real_t FL0 = ml, FL1 = ml*ul+pl, FL2 = ml*vl, FL3 = (el+pl)*ul;
+					const real_t FR0 = mr, FR1 = mr*ur+pr, FR2 = mr*vr, FR3 = (er+pr)*ur;
+					// Medie di ROE e stime alla Davis-Einfeldt-Roe di SL e SR
+					const real_t isum = 1.0/(srhol+srhor);
+					const real_t uROE = ( srhor*ur+srhol*ul )*isum;
+					const real_t vROE = ( srhor*vr+srhol*vl )*isum;
+					const real_t HROE = ( srhor*Hr+srhol*Hl )*isum;
+					const real_t cROE = sqrt( (g-1)*( HROE-0.5*(uROE*uROE+vROE*vROE) ) );
+					const real_t SL = uROE-cROE, SR = uROE+cROE;
+					// Zona Ustar
+					const real_t dl = rl*(SL-ul), dr = rr*(SR-ur);
+					const real_t Sstar = (pr-pl+ml*(SL-ul)-mr*(SR-ur))/(dl-dr);
+					const real_t sl = dl/(SL-Sstar), sr = dr/(SR-Sstar);
+					const real_t ql3 = sl*( el/rl+(Sstar-ul)*(Sstar+pl/dl) );
+					const real_t qr3 = sr*( er/rr+(Sstar-ur)*(Sstar+pr/dr) );
+					// Flussi HLLC a sinistra e a destra dell'onda di contatto
+					const real_t GL0 = FL0 + SL*(sl-rl), GL1 = FL1 + SL*(sl*Sstar-ml);
+					const real_t GL2 = FL2 + SL*(sl*vl-tl), GL3 = FL3 + SL*(ql3-el);
+					const real_t GR0 = FR0 + SR*(sr-rr), GR1 = FR1 + SR*(sr*Sstar-mr);
+					const real_t GR2 = FR2 + SR*(sr*vr-tr), GR3 = FR3 + SR*(qr3-er);
+					// Selezione della regione che contiene x/t = 0
+					const bool left = Sstar >= 0;
+					const bool outL = SL >= 0, outR = SR < 0;
+					F[0] = outL ? FL0 : ( left ? GL0 : ( outR ? FR0 : GR0 ) );
+					F[1] = outL ? FL1 : ( left ? GL1 : ( outR ? FR1 : GR1 ) );
+					F[2] = outL ? FL2 : ( left ? GL2 : ( outR ? FR2 : GR2 ) );
+					F[3] = outL ? FL3 : ( left ? GL3 : ( outR ? FR3 : GR3 ) );
+				}
+				
 				MODEL& model;
 		};
+
+		/*! \brief Kernel vettoriale per GodunovHLLC */
+		template <typename MODEL>
+		struct BlockFlux< GodunovHLLC<MODEL> > {
+			enum { Cached = 1 };
+			template <typename T>
+			static inline void eval( const GodunovHLLC<MODEL>& f, FaceBlock<T,4>& b ) { f.block(b); }
+			template <typename T>
+			static inline void eval( const GodunovHLLC<MODEL>& f, CachedFaceBlock<T,4,MODEL::NCACHE>& b ) { f.block(b); }
+		};
 	}
 }
 
@@ -4,6 +4,9 @@
 // Flusso di Godunov
 // Problema di Riemann risolto con approssimazione di Roe
 
+#include <solvers/fluxes/faceblock.hpp>
+#include <models/eulero/eulero.hpp>
+
 namespace ConservationLaw2D {
 	namespace NumericalFlux {
 		
@@ -111,9 +114,135 @@ namespace ConservationLaw2D {
 					FFlux[2] = Flux[1]*ny + Flux[2]*nx;
 					return FFlux;
 				}
+
+				/*! \brief Resistuisce il flusso numerico su un blocco di lati
+				
+				Stesso schema di operator(), scritto senza salti (le scelte sul segno
+				degli autovalori e l'entropy fix diventano selezioni) per essere
+				vettorizzato lungo i lati del blocco. */
+				CONSLAW2D_TARGET_CLONES
+				void block( FaceBlock<real_t,4>& b ) const {
+					const real_t g = model.gamma();
+					for (int k = 0; k < FaceBlock<real_t,4>::Width; ++k) {
+						const real_t nx = b.nx[k], ny = b.ny[k];
+						// Stati nel sistema ruotato
+						const real_t rl = b.ql[0][k], rr = b.qr[0][k];
+						const real_t ml = b.ql[1][k]*nx + b.ql[2][k]*ny;
+						const real_t mr = b.qr[1][k]*nx + b.qr[2][k]*ny;
+						const real_t tl = - b.ql[1][k]*ny + b.ql[2][k]*nx;
+						const real_t tr = - b.qr[1][k]*ny + b.qr[2][k]*nx;
+						const real_t el = b.ql[3][k], er = b.qr[3][k];
+						// Variabili primitive, entalpia e celerita'
+						const real_t ul = ml/rl, vl = tl/rl, ur = mr/rr, vr = tr/rr;
+						const real_t pl = (g-1)*( el - 0.5*rl*(ul*ul+vl*vl) );
+						const real_t pr = (g-1)*( er - 0.5*rr*(ur*ur+vr*vr) );
+						const real_t Hl = (el+pl)/rl, Hr = (er+pr)/rr;
+						const real_t cl = sqrt(g*pl/rl), cr = sqrt(g*pr/rr);
+						real_t F[4];
+						solve(g, rl, ul, vl, pl, cl, Hl, sqrt(rl), el, rr, ur, vr, pr, cr, Hr, sqrt(rr), er, F);
+						// Torno alle variabili cartesiane
+						b.flux[0][k] = F[0];
+						b.flux[1][k] = F[1]*nx - F[2]*ny;
+						b.flux[2][k] = F[1]*ny + F[2]*nx;
+						b.flux[3][k] = F[3];
+					}
+				}
+
+				/*! \brief Resistuisce il flusso numerico su un blocco di lati, partendo dalle
+				grandezze per cella gia' calcolate (vedi Model::Eulero::CellCache) */
+				CONSLAW2D_TARGET_CLONES
+				void block( CachedFaceBlock<real_t,4,MODEL::NCACHE>& b ) const {
+					const real_t g = model.gamma();
+					for (int k = 0; k < CachedFaceBlock<real_t,4,MODEL::NCACHE>::Width; ++k) {
+						const real_t nx = b.nx[k], ny = b.ny[k];
+						// Velocita' nel sistema ruotato
+						const real_t ul =   b.wl[1][k]*nx + b.wl[2][k]*ny;
+						const real_t vl = - b.wl[1][k]*ny + b.wl[2][k]*nx;
+						const real_t ur =   b.wr[1][k]*nx + b.wr[2][k]*ny;
+						const real_t vr = - b.wr[1][k]*ny + b.wr[2][k]*nx;
+						real_t F[4];
+						solve(g, b.wl[0][k], ul, vl, b.wl[3][k], b.wl[4][k], b.wl[5][k], b.wl[6][k], b.wl[7][k],
+						         b.wr[0][k], ur, vr, b.wr[3][k], b.wr[4][k], b.wr[5][k], b.wr[6][k], b.wr[7][k], F);
+						// Torno alle variabili cartesiane
+						b.flux[0][k] = F[0];
+						b.flux[1][k] = F[1]*nx - F[2]*ny;
+						b.flux[2][k] = F[1]*ny + F[2]*nx;
+						b.flux[3][k] = F[3];
+					}
+				}
 			private:
+				// Flusso nel sistema ruotato dalle variabili primitive (rho, u, v, p), celerita',
+				// entalpia, radice della densita' ed energia per unita' di volume dei due stati
+				static CONSLAW2D_ALWAYS_INLINE void solve( const real_t g,
+						const real_t rl, const real_t ul, const real_t vl, const real_t pl,
+						const real_t cl, const real_t Hl, const real_t srhol, const real_t el,
+						const real_t rr, const real_t ur, const real_t vr, const real_t pr,
+						const real_t cr, const real_t Hr, const real_t srhor, const real_t er,
+						real_t* F ) {
+					// Flussi nel sistema ruotato
+					const real_t ml = rl*ul, mr = rr*ur;
+					const real_t FL0 = ml, FL1 = ml*ul+pl, FL2 = ml*vl, FL3 = (el+pl)*ul;
+					const real_t FR0 = mr, FR1 = mr*ur+pr, FR2 = mr*vr, FR3 = (er+pr)*ur;
+					// Medie di ROE
+					const real_t rhoM = srhol*srhor;
+					const real_t isum = 1.0/(srhol+srhor);
+					const real_t uM = ( srhol*ul+srhor*ur )*isum;
+					const real_t vM = ( srhol*vl+srhor*vr )*isum;
+					const real_t HM = ( srhol*Hl+srhor*Hr )*isum;
+					const real_t C2M = (g-1)*( HM - 0.5*( uM*uM + vM*vM ) );
+					const real_t CM = sqrt(C2M);
+					const real_t l0 = uM-CM, l3 = uM+CM;
+					const real_t alpha0 = 0.5/C2M*((pr-pl)-rhoM*CM*(ur-ul));
+					const real_t alpha3 = 0.5/C2M*((pr-pl)+rhoM*CM*(ur-ul));
+					// Autovettori K0 e K3
+					const real_t K01 = uM-CM, K03 = HM-uM*CM;
+					const real_t K31 = uM+CM, K33 = HM+uM*CM;
+					// Entropy fix: onda di rarefazione transonica a sinistra
+					real_t rhoStar = rl + alpha0;
+					real_t uStar = (rl*ul + alpha0*(uM-CM))/rhoStar;
+					real_t pStar = (g-1)*(el+alpha0*K03-0.5*rhoStar*uStar*uStar);
+					const real_t l1L = ul-cl;
+					const real_t l1R = uStar-sqrt(g*pStar/rhoStar);
+					const bool fixL = (l1L < 0) && (l1R > 0);
+					// Entropy fix: onda di rarefazione transonica a destra
+					rhoStar = rr - alpha3;
+					uStar = (rr*ur + alpha3*(uM+CM))/rhoStar;
+					pStar = (g-1)*(er-alpha3*K33-0.5*rhoStar*uStar*uStar);
+					const real_t l4L = uStar+sqrt(g*pStar/rhoStar);
+					const real_t l4R = ur+cr;
+					const bool fixR = (l4L < 0) && (l4R > 0);
+					// Coefficienti davanti a K0 (flusso sinistro) e K3 (flusso destro):
+					// tutte le alternative sono calcolate e poi selezionate
+					const real_t fixcL = l1L*((l1R-l0)/(l1R-l1L))*alpha0;
+					const real_t fixcR = l4R*((l3-l4L)/(l4R-l4L))*alpha3;
+					const real_t roecL = alpha0*l0, roecR = alpha3*l3;
+					const real_t cL = fixL ? fixcL : roecL;
+					const real_t cR = fixR ? fixcR : roecR;
+					const real_t wL = (l0 >= 0 && !fixL) ? 0.0 : cL;
+					const real_t wR = (l3 < 0 && !fixR) ? 0.0 : cR;
+					// Flusso sinistro (eventualmente corretto) o destro
+					const bool left = !fixR && ( fixL || l0 >= 0 || uM >= 0 );
+					const real_t GL0 = FL0 + wL, GL1 = FL1 + wL*K01, GL2 = FL2 + wL*vM, GL3 = FL3 + wL*K03;
+					const real_t GR0 = FR0 - wR, GR1 = FR1 - wR*K31, GR2 = FR2 - wR*vM, GR3 = FR3 - wR*K33;
+					F[0] = left ? GL0 : GR0;
+					F[1] = left ? GL1 : GR1;
+					F[2] = left ? GL2 : GR2;
+					F[3] = left ? GL3 : GR3;
+				}
+				
 				MODEL& model;
 		};
+
+		/*! \brief Kernel vettoriale per GodunovRoe (solo Eulero: GodunovRoe e' specializzato anche per altri modelli) */
+		template <typename R>
+		struct BlockFlux< GodunovRoe< Model::Eulero<R> > > {
+			typedef Model::Eulero<R> MODEL;
+			enum { Cached = 1 };
+			template <typename T>
+			static inline void eval( const GodunovRoe<MODEL>& f, FaceBlock<T,4>& b ) { f.block(b); }
+			template <typename T>
+			static inline void eval( const GodunovRoe<MODEL>& f, CachedFaceBlock<T,4,MODEL::NCACHE>& b ) { f.block(b); }
+		};
 	}
 }
 
@@ -0,0 +1,106 @@
+#ifndef EULERO_HYBRID_HPP
+#define EULERO_HYBRID_HPP
+
+// Flusso ibrido
+// Flusso economico nelle zone regolari, flusso accurato vicino alle discontinuita'
+
+#include <algorithm>
+#include <cmath>
+#include <solvers/fluxes/faceblock.hpp>
+#include <models/eulero/fluxes/rusanov.hpp>
+#include <models/eulero/fluxes/godunovHLLC.hpp>
+
+namespace ConservationLaw2D {
+	namespace NumericalFlux {
+
+		/*! \class Hybrid
+		\brief Funtore per flusso numerico ibrido per il modello di Eulero
+
+		Un sensore sul salto relativo di pressione e densita' attraverso il lato sceglie
+		il flusso \c SHARP (per esempio HLLC o Roe) vicino a urti e discontinuita' di contatto
+		e il flusso \c CHEAP (per esempio Rusanov) altrove. Con i flussi a blocchi il solutore
+		divide i lati per tipo e valuta ogni gruppo con il proprio kernel vettoriale. */
+		template <typename MODEL, typename CHEAP = Rusanov<MODEL>, typename SHARP = GodunovHLLC<MODEL> >
+		class Hybrid {
+
+			typedef typename MODEL::real_t		real_t;
+			typedef typename MODEL::SolType		SolType;
+			public:
+				/*! \brief Tipo del flusso usato nelle zone regolari */
+				typedef CHEAP	CheapFlux;
+				/*! \brief Tipo del flusso usato vicino alle discontinuita' */
+				typedef SHARP	SharpFlux;
+				/*! \brief Costruttore, prende in ingresso referenza al modello usato
+				\param[in] m Modello
+				\param[in] tol Salto relativo di pressione o densita' oltre il quale si usa \c SHARP */
+				Hybrid(MODEL& m, real_t tol = 0.05):model(m),cheap_(m),sharp_(m),tol_(tol) {}
+
+				/*! \brief Imposta la soglia del sensore */
+				void setThreshold( real_t tol ) { tol_ = tol; }
+				/*! \brief Restituisce il flusso usato nelle zone regolari */
+				const CHEAP& cheap(void) const { return cheap_; }
+				/*! \brief Restituisce il flusso usato vicino alle discontinuita' */
+				const SHARP& sharp(void) const { return sharp_; }
+
+				/*! \brief Sensore: vero se il lato attraversa una discontinuita'
+				\param[in] ql Stato del sistema a sinistra del lato
+				\param[in] qr Stato del sistema a destra del lato */
+				inline bool isSharp(const SolType& ql, const SolType& qr) const {
+					const real_t pl = model.P(ql), pr = model.P(qr);
+					const real_t dp = std::fabs(pr-pl), dr = std::fabs(qr[0]-ql[0]);
+					return ( dp > tol_*std::min(pl,pr) ) || ( dr > tol_*std::min(ql[0],qr[0]) );
+				}
+
+				/*! \brief Resistuisce il flusso numerico
+				\param[in] ql Stato del sistema a sinistra del lato
+				\param[in] qr Stato del sistema a destra del lato
+				\param[in] nx Prima componente della normale al lato
+				\param[in] ny Seconda componente della normale al lato
+				\return Flusso numerico \c SHARP o \c CHEAP secondo il sensore */
+				inline SolType operator()(const SolType& ql, const SolType& qr, const real_t nx, const real_t ny) const {
+					return isSharp(ql, qr) ? sharp_(ql, qr, nx, ny) : cheap_(ql, qr, nx, ny);
+				}
+			private:
+				MODEL& model;
+				CHEAP cheap_;
+				SHARP sharp_;
+				real_t tol_;
+		};
+
+		/*! \brief Il flusso ibrido divide i lati per tipo */
+		template <typename MODEL, typename CHEAP, typename SHARP>
+		struct HybridFlux< Hybrid<MODEL,CHEAP,SHARP> > { enum { value = 1 }; };
+
+		/*! \brief Kernel per un blocco misto (ripiego quando i lati non sono divisi per tipo):
+		calcola entrambi i flussi e seleziona lato per lato */
+		template <typename MODEL, typename CHEAP, typename SHARP>
+		struct BlockFlux< Hybrid<MODEL,CHEAP,SHARP> > {
+			enum { Cached = 0 };
+			template <typename T, int DIM>
+			static inline void eval( const NumericalFlux::Hybrid<MODEL,CHEAP,SHARP>& f, FaceBlock<T,DIM>& b ) {
+				typedef Eigen::Matrix<T, DIM, 1> SolType;
+				typedef FaceBlock<T,DIM> Block;
+				bool sharp[Block::Width];
+				SolType ql, qr;
+				for (int k = 0; k < Block::Width; ++k) {
+					for (int i = 0; i < DIM; ++i) {
+						ql[i] = b.ql[i][k];
+						qr[i] = b.qr[i][k];
+					}
+					sharp[k] = f.isSharp(ql, qr);
+				}
+				BlockFlux<CHEAP>::eval(f.cheap(), b);
+				T flux[DIM][Block::Width];
+				for (int i = 0; i < DIM; ++i)
+					for (int k = 0; k < Block::Width; ++k)
+						flux[i][k] = b.flux[i][k];
+				BlockFlux<SHARP>::eval(f.sharp(), b);
+				for (int i = 0; i < DIM; ++i)
+					for (int k = 0; k < Block::Width; ++k)
+						b.flux[i][k] = sharp[k] ? b.flux[i][k] : flux[i][k];
+			}
+		};
+	}
+}
+
+#endif
@@ -3,6 +3,8 @@
 
 // Flusso approssimato di Rusanov
 
+#include <solvers/fluxes/faceblock.hpp>
+
 namespace ConservationLaw2D {
 	namespace NumericalFlux {
 		
@@ -51,9 +53,85 @@ namespace ConservationLaw2D {
 					FFlux[2] = Flux[1]*ny + Flux[2]*nx;
 					return FFlux;
 				}
+
+				/*! \brief Resistuisce il flusso numerico su un blocco di lati (kernel vettoriale) */
+				CONSLAW2D_TARGET_CLONES
+				void block( FaceBlock<real_t,4>& b ) const {
+					const real_t g = model.gamma();
+					for (int k = 0; k < FaceBlock<real_t,4>::Width; ++k) {
+						const real_t nx = b.nx[k], ny = b.ny[k];
+						// Stati nel sistema ruotato
+						const real_t rl = b.ql[0][k], rr = b.qr[0][k];
+						const real_t ml = b.ql[1][k]*nx + b.ql[2][k]*ny;
+						const real_t mr = b.qr[1][k]*nx + b.qr[2][k]*ny;
+						const real_t tl = - b.ql[1][k]*ny + b.ql[2][k]*nx;
+						const real_t tr = - b.qr[1][k]*ny + b.qr[2][k]*nx;
+						const real_t el = b.ql[3][k], er = b.qr[3][k];
+						// Variabili primitive e celerita'
+						const real_t ul = ml/rl, vl = tl/rl, ur = mr/rr, vr = tr/rr;
+						const real_t pl = (g-1)*( el - 0.5*rl*(ul*ul+vl*vl) );
+						const real_t pr = (g-1)*( er - 0.5*rr*(ur*ur+vr*vr) );
+						real_t F[4];
+						solve(rl, ul, vl, pl, sqrt(g*pl/rl), el, rr, ur, vr, pr, sqrt(g*pr/rr), er, F);
+						// Torno alle variabili cartesiane
+						b.flux[0][k] = F[0];
+						b.flux[1][k] = F[1]*nx - F[2]*ny;
+						b.flux[2][k] = F[1]*ny + F[2]*nx;
+						b.flux[3][k] = F[3];
+					}
+				}
+
+				/*! \brief Resistuisce il flusso numerico su un blocco di lati, partendo dalle
+				grandezze per cella gia' calcolate (vedi Model::Eulero::CellCache) */
+				CONSLAW2D_TARGET_CLONES
+				void block( CachedFaceBlock<real_t,4,MODEL::NCACHE>& b ) const {
+					for (int k = 0; k < CachedFaceBlock<real_t,4,MODEL::NCACHE>::Width; ++k) {
+						const real_t nx = b.nx[k], ny = b.ny[k];
+						// Velocita' nel sistema ruotato
+						const real_t ul =   b.wl[1][k]*nx + b.wl[2][k]*ny;
+						const real_t vl = - b.wl[1][k]*ny + b.wl[2][k]*nx;
+						const real_t ur =   b.wr[1][k]*nx + b.wr[2][k]*ny;
+						const real_t vr = - b.wr[1][k]*ny + b.wr[2][k]*nx;
+						real_t F[4];
+						solve(b.wl[0][k], ul, vl, b.wl[3][k], b.wl[4][k], b.wl[7][k],
+						      b.wr[0][k], ur, vr, b.wr[3][k], b.wr[4][k], b.wr[7][k], F);
+						// Torno alle variabili cartesiane
+						b.flux[0][k] = F[0];
+						b.flux[1][k] = F[1]*nx - F[2]*ny;
+						b.flux[2][k] = F[1]*ny + F[2]*nx;
+						b.flux[3][k] = F[3];
+					}
+				}
 			private:
+				// Flusso nel sistema ruotato dalle variabili primitive (rho, u, v, p), celerita'
+				// ed energia per unita' di volume dei due stati
+				static CONSLAW2D_ALWAYS_INLINE void solve(
+						const real_t rl, const real_t ul, const real_t vl, const real_t pl, const real_t cl, const real_t el,
+						const real_t rr, const real_t ur, const real_t vr, const real_t pr, const real_t cr, const real_t er,
+						real_t* F ) {
+					const real_t ml = rl*ul, mr = rr*ur, tl = rl*vl, tr = rr*vr;
+					const real_t sl = fabs(ul) + cl;
+					const real_t sr = fabs(ur) + cr;
+					const real_t Splus = (sl > sr) ? sl : sr;
+					// NumericalFlux = (FR + FL)/2 - Splus*(qr-ql)/2
+					F[0] = 0.5*( ml + mr ) - 0.5*Splus*( rr - rl );
+					F[1] = 0.5*( ml*ul+pl + mr*ur+pr ) - 0.5*Splus*( mr - ml );
+					F[2] = 0.5*( ml*vl + mr*vr ) - 0.5*Splus*( tr - tl );
+					F[3] = 0.5*( (el+pl)*ul + (er+pr)*ur ) - 0.5*Splus*( er - el );
+				}
+				
 				MODEL& model;
 		};
+
+		/*! \brief Kernel vettoriale per Rusanov */
+		template <typename MODEL>
+		struct BlockFlux< Rusanov<MODEL> > {
+			enum { Cached = 1 };
+			template <typename T>
+			static inline void eval( const Rusanov<MODEL>& f, FaceBlock<T,4>& b ) { f.block(b); }
+			template <typename T>
+			static inline void eval( const Rusanov<MODEL>& f, CachedFaceBlock<T,4,MODEL::NCACHE>& b ) { f.block(b); }
+		};
 	}
 }
 
@@ -0,0 +1,99 @@
+#ifndef SHALLOWWATER_GODUNOV_HLL_HPP
+#define SHALLOWWATER_GODUNOV_HLL_HPP
+
+// Flusso di Godunov per le onde in acqua bassa
+// Problema di Riemann risolto con approssimazione HLL, con fronti asciutti
+
+#include <models/shallowwater/shallowwater.hpp>
+#include <algorithm>
+#include <cmath>
+
+namespace ConservationLaw2D {
+	namespace NumericalFlux {
+
+		template <typename MODEL> class GodunovHLL;
+
+		// GodunovHLL
+		/*! \class GodunovHLL< Model::ShallowWater<T,BATHYMETRY> >
+		\brief Funtore per flusso numerico HLL per il modello di onde in acqua bassa
+
+		Velocita' delle onde alla Einfeldt (Toro, cap. 10); se uno dei due stati e' asciutto
+		si usano le velocita' esatte del fronte \f$ u \pm 2c \f$. Con la batimetria il flusso e'
+		calcolato sugli stati della ricostruzione idrostatica.
+		\warning Con la batimetria il flusso non e' antisimmetrico: va usato con il ciclo
+		sulle celle del solutore, non con i flussi a blocchi */
+		template <typename T, bool BATHYMETRY>
+		class GodunovHLL< Model::ShallowWater<T,BATHYMETRY> > {
+
+			typedef Model::ShallowWater<T,BATHYMETRY>	MODEL;
+			typedef typename MODEL::real_t		real_t;
+			typedef typename MODEL::SolType		SolType;
+			public:
+				/*! \brief Costruttore, prende in ingresso referenza al modello usato */
+				GodunovHLL(MODEL& m):model(m) {}
+
+				/*! \brief Resistuisce il flusso numerico
+				\param[in] ql Stato del sistema a sinistra del lato
+				\param[in] qr Stato del sistema a destra del lato
+				\param[in] nx Prima componente della normale al lato
+				\param[in] ny Seconda componente della normale al lato
+				\return Flusso numerico nella direzione normale, con approssimazione HLL */
+				inline SolType operator()(const SolType& ql, const SolType& qr, const real_t nx, const real_t ny) const {
+					// Ricostruzione idrostatica (stati invariati senza batimetria)
+					SolType qls, qrs;
+					const real_t dp = model.HydrostaticReconstruction(ql, qr, qls, qrs);
+					// Variabili nel sistema ruotato: altezza, velocita' normale e tangente
+					const real_t hl = qls[0], hr = qrs[0];
+					const real_t unl =   model.U(qls)*nx + model.V(qls)*ny;
+					const real_t utl = - model.U(qls)*ny + model.V(qls)*nx;
+					const real_t unr =   model.U(qrs)*nx + model.V(qrs)*ny;
+					const real_t utr = - model.U(qrs)*ny + model.V(qrs)*nx;
+					const real_t cl = model.C(qls), cr = model.C(qrs);
+					const bool dryl = model.Dry(qls), dryr = model.Dry(qrs);
+					SolType FFlux = SolType::Zero();
+					if ( !(dryl && dryr) ) {
+						// Velocita' delle onde
+						real_t SL, SR;
+						if ( dryl ) {
+							SL = unr - 2*cr;
+							SR = unr + cr;
+						} else if ( dryr ) {
+							SL = unl - cl;
+							SR = unl + 2*cl;
+						} else {
+							const real_t us = 0.5*(unl+unr) + cl - cr;
+							const real_t cs = 0.5*(cl+cr) + 0.25*(unl-unr);
+							SL = std::min(unl - cl, us - cs);
+							SR = std::max(unr + cr, us + cs);
+						}
+						// Flussi e stati nel sistema ruotato
+						const real_t FL[3] = { hl*unl, hl*unl*unl + 0.5*MODEL::Gravity()*hl*hl, hl*unl*utl };
+						const real_t FR[3] = { hr*unr, hr*unr*unr + 0.5*MODEL::Gravity()*hr*hr, hr*unr*utr };
+						const real_t QL[3] = { hl, hl*unl, hl*utl };
+						const real_t QR[3] = { hr, hr*unr, hr*utr };
+						real_t Flux[3];
+						for (int i = 0; i < 3; ++i) {
+							if ( SL >= 0 )
+								Flux[i] = FL[i];
+							else if ( SR <= 0 )
+								Flux[i] = FR[i];
+							else
+								Flux[i] = (SR*FL[i] - SL*FR[i] + SL*SR*(QR[i]-QL[i]))/(SR-SL);
+						}
+						// Torno alle variabili cartesiane
+						FFlux[0] = Flux[0];
+						FFlux[1] = Flux[1]*nx - Flux[2]*ny;
+						FFlux[2] = Flux[1]*ny + Flux[2]*nx;
+					}
+					// Termine di pressione della ricostruzione idrostatica
+					FFlux[1] += dp*nx;
+					FFlux[2] += dp*ny;
+					return FFlux;
+				}
+			private:
+				MODEL& model;
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef SHALLOWWATER_GODUNOV_ROE_HPP
+#define SHALLOWWATER_GODUNOV_ROE_HPP
+
+// Flusso di Godunov per le onde in acqua bassa
+// Problema di Riemann risolto con linearizzazione di Roe
+
+#include <models/shallowwater/shallowwater.hpp>
+#include <models/shallowwater/fluxes/godunovHLL.hpp>
+#include <algorithm>
+#include <cmath>
+
+namespace ConservationLaw2D {
+	namespace NumericalFlux {
+
+		template <typename MODEL> class GodunovRoe;
+
+		// GodunovRoe
+		/*! \class GodunovRoe< Model::ShallowWater<T,BATHYMETRY> >
+		\brief Funtore per flusso numerico di Roe per il modello di onde in acqua bassa
+
+		Correzione entropica di Harten-Hyman sulle onde acustiche. Sui fronti asciutti
+		e nelle forti rarefazioni la linearizzazione di Roe non conserva la positivita' dell'altezza:
+		se uno dei due stati (ricostruiti) e' asciutto o lo stato intermedio di Roe e' quasi
+		asciutto si usa il flusso HLL.
+		\warning Con la batimetria il flusso non e' antisimmetrico: va usato con il ciclo
+		sulle celle del solutore, non con i flussi a blocchi */
+		template <typename T, bool BATHYMETRY>
+		class GodunovRoe< Model::ShallowWater<T,BATHYMETRY> > {
+
+			typedef Model::ShallowWater<T,BATHYMETRY>	MODEL;
+			typedef typename MODEL::real_t		real_t;
+			typedef typename MODEL::SolType		SolType;
+			public:
+				/*! \brief Costruttore, prende in ingresso referenza al modello usato */
+				GodunovRoe(MODEL& m):model(m),hll_(m) {}
+
+				/*! \brief Resistuisce il flusso numerico
+				\param[in] ql Stato del sistema a sinistra del lato
+				\param[in] qr Stato del sistema a destra del lato
+				\param[in] nx Prima componente della normale al lato
+				\param[in] ny Seconda componente della normale al lato
+				\return Flusso numerico nella direzione normale, con linearizzazione di Roe */
+				inline SolType operator()(const SolType& ql, const SolType& qr, const real_t nx, const real_t ny) const {
+					// Ricostruzione idrostatica (stati invariati senza batimetria)
+					SolType qls, qrs;
+					const real_t dp = model.HydrostaticReconstruction(ql, qr, qls, qrs);
+					// Fronte asciutto
+					if ( model.Dry(qls) || model.Dry(qrs) )
+						return hll_(ql, qr, nx, ny);
+					// Variabili nel sistema ruotato: altezza, velocita' normale e tangente
+					const real_t hl = qls[0], hr = qrs[0];
+					const real_t unl =   model.U(qls)*nx + model.V(qls)*ny;
+					const real_t utl = - model.U(qls)*ny + model.V(qls)*nx;
+					const real_t unr =   model.U(qrs)*nx + model.V(qrs)*ny;
+					const real_t utr = - model.U(qrs)*ny + model.V(qrs)*nx;
+					const real_t cl = model.C(qls), cr = model.C(qrs);
+					// Medie di Roe
+					const real_t sl = sqrt(hl), sr = sqrt(hr);
+					const real_t hm = 0.5*(hl+hr);
+					const real_t um = (sl*unl + sr*unr)/(sl+sr);
+					const real_t vm = (sl*utl + sr*utr)/(sl+sr);
+					const real_t cm = sqrt(MODEL::Gravity()*hm);
+					// Intensita' delle onde
+					const real_t dh = hr - hl;
+					const real_t dqn = hr*unr - hl*unl;
+					const real_t dqt = hr*utr - hl*utl;
+					const real_t a1 = ( (um+cm)*dh - dqn )/(2*cm);
+					const real_t a2 = dqt - vm*dh;
+					const real_t a3 = ( dqn - (um-cm)*dh )/(2*cm);
+					// Stato intermedio quasi asciutto (forte rarefazione, per esempio dietro uno spigolo):
+					// la linearizzazione non conserva la positivita', uso HLL
+					if ( hl + a1 <= 0.1*std::min(hl,hr) )
+						return hll_(ql, qr, nx, ny);
+					// Autovalori con correzione entropica
+					real_t l1 = fabs(um-cm), l2 = fabs(um), l3 = fabs(um+cm);
+					const real_t d1 = std::max(real_t(0), std::max((um-cm)-(unl-cl), (unr-cr)-(um-cm)));
+					const real_t d3 = std::max(real_t(0), std::max((um+cm)-(unl+cl), (unr+cr)-(um+cm)));
+					if ( l1 < d1 ) l1 = 0.5*(l1*l1/d1 + d1);
+					if ( l3 < d3 ) l3 = 0.5*(l3*l3/d3 + d3);
+					// Flusso nel sistema ruotato
+					real_t Flux[3];
+					Flux[0] = 0.5*( hl*unl + hr*unr
+						- l1*a1 - l3*a3 );
+					Flux[1] = 0.5*( hl*unl*unl + 0.5*MODEL::Gravity()*hl*hl + hr*unr*unr + 0.5*MODEL::Gravity()*hr*hr
+						- l1*a1*(um-cm) - l3*a3*(um+cm) );
+					Flux[2] = 0.5*( hl*unl*utl + hr*unr*utr
+						- l1*a1*vm - l2*a2 - l3*a3*vm );
+					// Torno alle variabili cartesiane
+					SolType FFlux = SolType::Zero();
+					FFlux[0] = Flux[0];
+					FFlux[1] = Flux[1]*nx - Flux[2]*ny + dp*nx;
+					FFlux[2] = Flux[1]*ny + Flux[2]*nx + dp*ny;
+					return FFlux;
+				}
+			private:
+				MODEL& model;
+				GodunovHLL<MODEL> hll_;
+		};
+	}
+}
+
+#endif
@@ -7,95 +7,155 @@
 // Libreria EIGEN per l'Algebra
 #include <Eigen/Core>
 #include <cmath>
-
-// Dimensione dello spazio di stato
-// [h, h*u, h*v]
-#define DIMENSION 3
-#define GRAVITY 9.81
+#include <algorithm>
 
 namespace ConservationLaw2D {
 	namespace Model {
-		
-		template <typename T>
+
+		template <typename T, bool BATHYMETRY = false>
 		/*! \class ShallowWater
-		\brief Modello per le equazioni di onde in acque basse */
+		\brief Modello per le equazioni di onde in acque basse
+
+		Con \c BATHYMETRY = \c true lo stato ha una quarta componente, la quota del fondo \f$ z \f$,
+		con flusso nullo: viene assegnata dalle condizioni iniziali e resta costante. I flussi
+		dedicati (NumericalFlux::GodunovHLL, NumericalFlux::GodunovRoe) usano la ricostruzione
+		idrostatica (vedi HydrostaticReconstruction) per preservare il lago in quiete.
+
+		Le celle con altezza minore o uguale a dryTolerance() sono asciutte: la velocita' e' nulla. */
 		class ShallowWater {
-		
+
 			public:
 				// Defininzioni vettori
+				/*! \brief Dimensione dello stato \f$ (h, hu, hv) \f$, con la quota del fondo se \c BATHYMETRY */
+				enum { DIM = 3 + (BATHYMETRY ? 1 : 0) };
+				/*! \brief Indice della quota del fondo nello stato (solo se \c BATHYMETRY) */
+				enum { BOTTOM = 3 };
 				// Vettore per la soluzione
 				/*! \brief Tipo di dato reale, per esempio \c float o \c double */
 				typedef T	real_t;
 				/*! \brief Tipo per i vettori contenenti la soluzione */
-				typedef Eigen::Matrix<T, DIMENSION, 1>	SolType;
+				typedef Eigen::Matrix<T, DIM, 1>	SolType;
 				/*! \brief Tipo per le matrici contenenti il flusso \f$ m \times 2 \f$ */
-				typedef Eigen::Matrix<T, DIMENSION, 2>	FluxType;
-				
-				/*! \brief Costruttore del modello */
-				ShallowWater() {}
-				
+				typedef Eigen::Matrix<T, DIM, 2>	FluxType;
+				/*! \brief Accelerazione di gravita' \f$ g \f$ */
+				static inline real_t Gravity( void ) { return real_t(9.81); }
+
+				/*! \brief Costruttore del modello
+				\param[in] hdry Altezza sotto la quale una cella e' considerata asciutta */
+				ShallowWater( real_t hdry = 1e-8 ):hdry_(hdry) {}
+
+				/*! \brief Imposta l'altezza sotto la quale una cella e' considerata asciutta */
+				void setDryTolerance( real_t hdry ) { hdry_ = hdry; }
+				/*! \brief Restituisce l'altezza sotto la quale una cella e' considerata asciutta */
+				inline real_t dryTolerance(void) const { return hdry_; }
+
+				// Accesso variabili
+				/*! \brief Restituisce l'altezza \f$ h \f$ */
+				inline real_t H( const SolType& q ) const { return q[0]; }
+				/*! \brief Vero se la cella e' asciutta */
+				inline bool Dry( const SolType& q ) const { return q[0] <= hdry_; }
+				/*! \brief Restituisce la prima componente della velocità, \f$ u \f$ (nulla se asciutto) */
+				inline real_t U( const SolType& q ) const { return Dry(q) ? 0 : q[1]/q[0]; }
+				/*! \brief Restituisce la seconda componente della velocità, \f$ v \f$ (nulla se asciutto) */
+				inline real_t V( const SolType& q ) const { return Dry(q) ? 0 : q[2]/q[0]; }
+				/*! \brief Restituisce la celerita' \f$ c = \sqrt{g h} \f$ */
+				inline real_t C( const SolType& q ) const { return sqrt( Gravity()*std::max(q[0],real_t(0)) ); }
+				/*! \brief Restituisce la quota del fondo \f$ z \f$ (nulla senza batimetria) */
+				inline real_t Z( const SolType& q ) const { return BATHYMETRY ? q[BOTTOM] : 0; }
+
 				// Flusso in direzione normale
 				/*! \brief Restituisce il flusso esatto  */
 				inline FluxType Flux( const SolType& q ) const {
 					FluxType Flux = FluxType::Zero();
+					const real_t u = U(q), v = V(q);
 					// F(q)
 					Flux(0,0) = q[1];
-					Flux(1,0) = q[1]*q[1]/q[0] + 0.5*GRAVITY*q[0]*q[0];
-					Flux(2,0) = q[1]*q[2]/q[0];
+					Flux(1,0) = q[1]*u + 0.5*Gravity()*q[0]*q[0];
+					Flux(2,0) = q[1]*v;
 					// G(q)
 					Flux(0,1) = q[2];
-					Flux(1,1) = q[1]*q[2]/q[0];
-					Flux(2,1) = q[2]*q[2]/q[0] + 0.5*GRAVITY*q[0]*q[0];
+					Flux(1,1) = q[2]*u;
+					Flux(2,1) = q[2]*v + 0.5*Gravity()*q[0]*q[0];
 
 					return Flux;
 				}
-				
+
 				// Variabili primitive <-> Variabili conservate
-				/*! \brief Restituisce la soluzione nelle variabili conservate \f$ (\rho,\rho u, \rho v) \f$  */
+				/*! \brief Restituisce la soluzione nelle variabili conservate \f$ (h, h u, h v) \f$  */
 				inline SolType PrimitiveToConservative( const SolType& w ) const {
-					SolType q = SolType::Zero();
+					SolType q = w;
 					q[0] = w[0];
 					q[1] = w[0]*w[1];
 					q[2] = w[0]*w[2];
 					return q;
 				}
-				
-				/*! \brief Restituisce la soluzione nelle variabili primitive \f$ (\rho, u, v) \f$  */
+
+				/*! \brief Restituisce la soluzione nelle variabili primitive \f$ (h, u, v) \f$  */
 				inline SolType ConservativeToPrimitive( const SolType& q ) const {
-					SolType w = SolType::Zero();
+					SolType w = q;
 					w[0] = q[0];
-					w[1] = q[1]/q[0];
-					w[2] = q[2]/q[0];
+					w[1] = U(q);
+					w[2] = V(q);
 					return w;
 				}
-				
+
 				// Controlla se lo stato e' consistente
-				/*! \brief Controlla che lo stato del sistema sia consistente, cioè se \f$ \rho > 0 \f$  */
+				/*! \brief Controlla che lo stato del sistema sia consistente, cioè se \f$ h \geq 0 \f$  */
 				inline bool ConsistentState( const SolType& q ) const {
-					// Densita' deve essere positiva!
-					return ( q[0] > 0 );
+					// Altezza non negativa (zero sulle celle asciutte)
+					return ( q[0] >= 0 );
 				}
-				
+
 				// Massimo autovalore
-				/*! \brief Restituisce il massimo autovalore  */
-				inline real_t MaxLambda( const SolType& q ) {
-					return pow(q[1]/q[0],2) + pow(q[2]/q[0],2) + sqrt(GRAVITY*q[0]);
+				/*! \brief Restituisce il massimo autovalore in modulo, \f$ |\mathbf{u}| + c \f$ */
+				inline real_t MaxLambda( const SolType& q ) const {
+					const real_t u = U(q), v = V(q);
+					return sqrt(u*u + v*v) + C(q);
 				}
-				
+
 				// Autovalori
 				/*! \brief Restituisce gli autovalori del flusso esatto */
 				inline SolType EigenValues( const SolType& q, const real_t nx, const real_t ny ) const {
 					SolType Eig = SolType::Zero();
-					real_t U = q[1]/q[0];
-					real_t V = q[2]/q[0];
-					real_t C = sqrt(GRAVITY*q[0]);
-					
-					Eig[0] = U*nx + V*ny;
-					Eig[1] = U*nx + V*ny - C;
-					Eig[2] = U*nx + V*ny + C;
+					real_t Un = U(q)*nx + V(q)*ny;
+					real_t Cq = C(q);
+
+					Eig[0] = Un;
+					Eig[1] = Un - Cq;
+					Eig[2] = Un + Cq;
 
 					return Eig;
 				}
+
+				// Ricostruzione idrostatica (Audusse et al., 2004)
+				/*! \brief Ricostruisce gli stati ai due lati del lato rispetto alla quota
+				\f$ z^* = \max(z_l, z_r) \f$: \f$ h^* = \max(0, h + z - z^*) \f$ con la velocita' invariata.
+				Il flusso della cella a sinistra e' quello calcolato sugli stati ricostruiti piu'
+				il termine di pressione restituito, lungo la normale.
+				Senza batimetria gli stati restano invariati.
+				\param[in] ql Stato del sistema a sinistra del lato
+				\param[in] qr Stato del sistema a destra del lato
+				\param[out] qls Stato ricostruito a sinistra
+				\param[out] qrs Stato ricostruito a destra
+				\return Termine di pressione \f$ \frac{g}{2} (h_l^2 - h_l^{*2}) \f$ */
+				inline real_t HydrostaticReconstruction( const SolType& ql, const SolType& qr, SolType& qls, SolType& qrs ) const {
+					qls = ql;
+					qrs = qr;
+					if ( !BATHYMETRY )
+						return 0;
+					const real_t zs = std::max(Z(ql), Z(qr));
+					const real_t hl = std::max(real_t(0), ql[0] + Z(ql) - zs);
+					const real_t hr = std::max(real_t(0), qr[0] + Z(qr) - zs);
+					qls[0] = hl;
+					qls[1] = hl*U(ql);
+					qls[2] = hl*V(ql);
+					qrs[0] = hr;
+					qrs[1] = hr*U(qr);
+					qrs[2] = hr*V(qr);
+					return 0.5*Gravity()*(ql[0]*ql[0] - hl*hl);
+				}
+			private:
+				real_t hdry_;
 		};
 
 	}
@@ -3,10 +3,41 @@
 
 // Libreria per la Mesh
 #include <solvers/finitevolume/mesh_finitevolume_traits.hpp>
+// Blocchi di lati per i flussi vettoriali
+#include <solvers/fluxes/faceblock.hpp>
+// Sonde e linee di campionamento
+#include <solvers/finitevolume/monitor.hpp>
+// Soluzione in array contigui
+#include <solvers/finitevolume/solutionbuffer.hpp>
+// Thread con affinita' ai core per il ciclo sulle celle
+#include <solvers/finitevolume/threadteam.hpp>
+// Riduzioni deterministiche (passo temporale, integrali)
+#include <solvers/finitevolume/reduction.hpp>
+// Stato corrente in memoria condivisa per i visualizzatori esterni
+#include <solvers/finitevolume/livefeed.hpp>
+// Storia in memoria scritta attorno agli eventi
+#include <solvers/finitevolume/history.hpp>
+// Regione di interesse per i frame
+#include <solvers/finitevolume/region.hpp>
+// Frame incrementali
+#include <solvers/finitevolume/deltaframes.hpp>
+// Frame nello stesso processo, per l'analisi in linea
+#include <solvers/finitevolume/framestream.hpp>
+// Formato dei frame per gnuplot
+#include <solvers/finitevolume/gnuplotwriter.hpp>
+// Decomposizione del dominio (solo con CONSLAW2D_MPI)
+#include <solvers/finitevolume/decomposition.hpp>
+#include <mesh/partition/partitioner.hpp>
 #include <cmath>
 #include <iostream>
 #include <string>
+#include <vector>
+#include <algorithm>
+#include <functional>
 #include <iomanip>
+#include <fstream>
+#include <limits>
+#include <sstream>
 
 namespace ConservationLaw2D {
 	/*! \namespace Solver
@@ -14,14 +45,25 @@ namespace ConservationLaw2D {
 	namespace Solver {
 		using namespace std;
 		/*! \class FiniteVolume
-		\brief Solutore a Volumi Finiti per leggi di conservazione 2d */
-		template <typename MODEL, typename NUMFLUX>
+		\brief Solutore a Volumi Finiti per leggi di conservazione 2d
+
+		Il parametro \c STORE e' il tipo reale con cui vengono memorizzate la soluzione
+		e la geometria della mesh. Con \c STORE = \c float e un modello in \c double si ottiene
+		la precisione mista: stato in singola precisione, flussi e residui in doppia.
+
+		La soluzione non e' memorizzata nei poligoni ma in due buffer del solutore
+		(vedi Solver::SolutionBuffer) indicizzati con l'id del poligono, con disposizione \c LAYOUT
+		(Solver::AoS o Solver::SoA): a ogni passo lo stato corrente e quello precedente vengono
+		scambiati senza copie. */
+		template <typename MODEL, typename NUMFLUX, typename STORE = typename MODEL::real_t, int LAYOUT = AoS>
 		class FiniteVolume {
 		
 			private:
 				typedef typename MODEL::real_t							real_t;
 				typedef typename MODEL::SolType							SolType;
-				typedef typename Mesh::DefaultTraits<real_t,SolType>	Traits;
+				// Tipo per la soluzione memorizzata
+				typedef Eigen::Matrix<STORE, SolType::RowsAtCompileTime, 1>	StoreType;
+				typedef typename Mesh::DefaultTraits<STORE>			Traits;
 			public:
 				// Mesh
 				/*! \brief Mesh specifica per volumi finiti */
@@ -29,6 +71,8 @@ namespace ConservationLaw2D {
 			private:
 				// Puntatori
 				typedef typename FVMesh::polygon_ptr		polygon_ptr;
+				typedef typename FVMesh::vertex_ptr			vertex_ptr;
+				typedef typename FVMesh::hedge_ptr			hedge_ptr;
 				// Iteratori
 				typedef typename FVMesh::polygon_it			p_it;
 				typedef typename FVMesh::vertex_it			v_it;
@@ -37,24 +81,59 @@ namespace ConservationLaw2D {
 				typedef typename FVMesh::Vertex::PolygonCirculator	vp_cit;
 				typedef typename FVMesh::Polygon::HEdgeCirculator	he_cit;
 				typedef typename FVMesh::Polygon::VertexCirculator	pv_cit;
-				// Condizioni iniziali e termine sorgente
+				// Condizioni iniziali e termine sorgente: funzioni o oggetti con stato (vedi Solver::Registry)
 				// [in ingresso x, y e colore]
-				typedef SolType (*INITCOND)( size_t, real_t, real_t );
+				typedef std::function<SolType( size_t, real_t, real_t )> INITCOND;
 				// [in ingresso x, y, t e colore]
-				typedef SolType (*BOUNDARYCOND)( SolType&, size_t, real_t, real_t, real_t, real_t, real_t );
+				typedef std::function<SolType( SolType&, size_t, real_t, real_t, real_t, real_t, real_t )> BOUNDARYCOND;
 				// [in ingresso x, y, t e colore]
-				typedef SolType (*SOURCE)( const SolType&, size_t, real_t, real_t, real_t );
+				typedef std::function<SolType( const SolType&, size_t, real_t, real_t, real_t )> SOURCE;
 				
 				// Valuta rhs del poligono dato
 				inline SolType RHS( const polygon_ptr ) const;
+				// Conversione tra precisione di memorizzazione e di calcolo
+				static inline SolType load( const StoreType& q ) { return q.template cast<real_t>(); }
+				static inline StoreType store( const SolType& q ) { return q.template cast<STORE>(); }
+				// Dimensione dello spazio di stato
+				enum { DIM = SolType::RowsAtCompileTime };
+				// Soluzione su tutte le celle
+				typedef SolutionBuffer<STORE,DIM,LAYOUT>		Buffer;
+				// Blocco di lati per i flussi vettoriali
+				typedef NumericalFlux::FaceBlock<real_t,DIM>	Block;
+				// Cella con numero di lati N fissato a compile time: vicini e geometria dei lati
+				template <int N>
+				struct FixedCell {
+					// Indice del poligono adiacente (NOPOLYGON sui lati di bordo)
+					size_t nb[N];
+					real_t len[N], nx[N], ny[N];
+					// Lato, per le condizioni al bordo
+					hedge_ptr e[N];
+				};
+				enum { NOPOLYGON = -1 };
+				// Valuta rhs di una cella con N lati (ciclo sui lati srotolato dal compilatore)
+				template <int N>
+				inline SolType RHSFixed( const FixedCell<N>&, const polygon_ptr ) const;
 
 			public:
+				/*! \brief Vista in sola lettura dello stato (vedi stream()) */
+				typedef FrameView<MODEL,FVMesh,Buffer>		View;
 				/*! \brief Costruttore del solutore 
 				 \param[in] model Referenza al modello di problema
 				 \param[in] mesh Referenza alla mesh
 				*/
 				FiniteVolume( MODEL& model, FVMesh& mesh )
-					:model_(model),mesh_(mesh),NumFlux(model),cflmax_(0.0),hmax_(0.0),currtime_(0.0) {};
+					:model_(model),mesh_(mesh),NumFlux(model),cflmax_(0.0),hmax_(0.0),dt_(0.0),currtime_(0.0),
+					tracking_(false),trackingTol_(0.0),batched_(false),cached_(false),triangular_(false),
+					linear_(false),linDt_(0.0),nsteps_(0),stages_(1),nthreads_(1),pin_(false),
+					rkWeight_(0.0),rkPrev_(0),geometryReady_(false),quiet_(false),feedEvery_(1),feedSlots_(3),
+					historyCapacity_(0),historyPost_(0),historyEvery_(1),spikeFactor_(0.0),spikeWindow_(20),
+					deltaKeyframe_(10),stopTime_(std::numeric_limits<real_t>::max())
+#ifdef CONSLAW2D_MPI
+					,distributed_(false)
+#endif
+					{};
+				/*! \brief Distruttore: scrive la finestra di un evento ancora aperto (vedi finishHistory()) */
+				~FiniteVolume() { finishHistory(); }
 				
 				// Impostazioni
 				/*! \brief Imposta il massimo CFL */
@@ -67,11 +146,197 @@ namespace ConservationLaw2D {
 				void setSource ( SOURCE s ) { Source = s; }
 				/*! \brief Imposta la directory nella quale sara' salvata la soluzione */
 				void setDirectory ( const string& dir ) { datadir_ = dir; }
+				/*! \brief Attiva il tracciamento delle celle attive
+				\param[in] on Se vero aggiorna solo le celle perturbate e i loro vicini
+				\param[in] tol Variazione relativa sotto la quale una cella e' considerata ferma
+				\warning Va chiamato prima di init() */
+				void setActivityTracking ( bool on, real_t tol = 1e-12 ) { tracking_ = on; trackingTol_ = tol; }
+				/*! \brief Calcola i flussi una sola volta per lato, a blocchi vettoriali (vedi NumericalFlux::BlockFlux)
+				\warning Va chiamato prima di init(); non si combina con il tracciamento delle celle attive */
+				void setBatchedFluxes ( bool on ) { batched_ = on; }
+				/*! \brief Con i flussi a blocchi, calcola una volta per cella le grandezze usate
+				dai flussi (variabili primitive, celerita', entalpia, ...) prima del ciclo sui lati
+				\warning Ha effetto solo con setBatchedFluxes(); richiede un flusso con kernel per NumericalFlux::CachedFaceBlock */
+				void setPrimitiveCache ( bool on ) { cached_ = on; }
+				/*! \brief Per modelli lineari (es. Model::LinearAcoustics con flusso di Godunov):
+				il passo temporale viene assemblato una volta in una matrice sparsa a blocchi DIM x DIM
+				(una riga di blocchi per cella) e ogni passo diventa un prodotto matrice-vettore
+				\warning Flusso numerico e condizioni al bordo devono essere affini nello stato e le
+				condizioni al bordo indipendenti dal tempo; il passo temporale viene calcolato una volta */
+				void setLinearOperator ( bool on ) { linear_ = on; }
+				/*! \brief Imposta l'integratore in tempo: 1 Eulero esplicito, 2 e 3 Runge-Kutta SSP
+				(Shu-Osher) del secondo e del terzo ordine. Lo stato al passo precedente degli stadi
+				intermedi e' in un buffer di appoggio, senza allocazioni dopo il primo passo
+				\warning Non si combina con il tracciamento delle celle attive e con l'operatore lineare */
+				void setTimeIntegrator ( size_t stages ) { stages_ = stages; }
+				/*! \brief Esegue il ciclo sulle celle con piu' thread (vedi Solver::ThreadTeam): ogni thread
+				aggiorna un intervallo contiguo di celle e inizializza per primo (first touch) le proprie parti
+				della soluzione, dei buffer di appoggio e della geometria dei triangoli, che finiscono cosi'
+				nella memoria del suo nodo NUMA. init() stampa la disposizione scelta
+				\param[in] n Numero di thread
+				\param[in] pin Fissa ogni thread a un core, a blocchi sui nodi NUMA
+				\warning Va chiamato prima di init(); solo con il ciclo sulle celle (non si combina con
+				flussi a blocchi, tracciamento, operatore lineare ed esecuzione distribuita). Conviene
+				rinumerare la mesh (reorder()) perche' gli intervalli siano regioni compatte */
+				void setThreads ( size_t n, bool pin = true ) { nthreads_ = max(n, size_t(1)); pin_ = pin; }
+				/*! \brief La geometria della mesh e' gia' calcolata: init() non chiama init_geom() e il solutore
+				non modifica la mesh, che puo' essere condivisa tra solutori in thread diversi (vedi Solver::MeshCache)
+				\warning Va chiamato prima di init() */
+				void setGeometryReady ( bool on ) { geometryReady_ = on; }
+				/*! \brief Non stampa messaggi sullo standard output (intestazione di init(), disposizione
+				dei thread, assemblaggio dell'operatore lineare), per i programmi che lo usano come canale */
+				void setQuiet ( bool on ) { quiet_ = on; }
+#ifdef CONSLAW2D_MPI
+				/*! \brief Esecuzione distribuita: ogni processo aggiorna le proprie celle (vedi Solver::Decomposition),
+				lo scambio delle celle fantasma e' sovrapposto al calcolo delle celle interne e il passo
+				temporale e' il minimo su tutti i processi
+				\param[in] on Attiva l'esecuzione distribuita
+				\param[in] comm Comunicatore
+				\warning Va chiamato prima di init(); solo con il ciclo sulle celle (non si combina con
+				flussi a blocchi, tracciamento, operatore lineare e sonde). I buffer contengono solo le celle
+				del processo e le fantasma (vedi Decomposition::local()): getSol() e framegrab() sono validi
+				solo nel processo root dopo gatherSolution(), framegrabVTU() in ogni processo */
+				void setDistributed ( bool on, MPI_Comm comm = MPI_COMM_WORLD ) { distributed_ = on; decomp_.setComm(comm); }
+				/*! \brief Imposta il processo proprietario di ogni cella (di default partizione multilevel del grafo duale, vedi Mesh::Partitioner) */
+				void setPartition ( const vector<int>& part ) { partition_ = part; }
+				/*! \brief Raccoglie nel processo root la soluzione di tutte le celle, indicizzata con l'id
+				del poligono: il processo root prosegue come esecuzione seriale sull'intera mesh
+				\warning Conclude l'esecuzione distribuita: gli altri processi non possono avanzare */
+				void gatherSolution ( int root = 0 ) {
+					Buffer all;
+					decomp_.gather(q_, all, root);
+					if ( decomp_.rank() != root ) return;
+					q_.swap(all);
+					q0_ = q_;
+					pool_.resize(mesh_.nP());
+					distributed_ = false;
+				}
+				/*! \brief Restituisce la decomposizione del dominio */
+				const Decomposition<FVMesh,STORE,DIM>& getDecomposition ( void ) const { return decomp_; }
+#endif
+				/*! \brief Registra le variabili primitive nelle sonde e lungo le linee su file
+				(vedi Solver::Monitor): un campione all'inizializzazione e poi ogni \c every passi
+				\param[in] filename Nome del file (nella directory corrente, non in quella dei frame)
+				\param[in] every Numero di passi tra due campioni
+				\param[in] binary Formato binario invece di CSV
+				\param[in] capacity Numero di campioni nel buffer in memoria
+				\warning Sonde e linee vanno aggiunte prima di init() */
+				void setMonitor ( const string& filename, size_t every = 1, bool binary = false, size_t capacity = 1024 ) {
+					monitor_.open(filename, every, binary, capacity);
+				}
+				/*! \brief Aggiunge una sonda nel punto (x,y) */
+				void addProbe ( real_t x, real_t y ) { monitor_.addProbe(x, y); }
+				/*! \brief Aggiunge il segmento da (x0,y0) a (x1,y1) campionato con n punti */
+				void addLine ( real_t x0, real_t y0, real_t x1, real_t y1, size_t n ) {
+					vector<real_t> vx(2), vy(2);
+					vx[0] = x0; vx[1] = x1;
+					vy[0] = y0; vy[1] = y1;
+					monitor_.addPolyline(vx, vy, n);
+				}
+				/*! \brief Aggiunge una linea spezzata campionata con n punti equispaziati */
+				void addPolyline ( const vector<real_t>& vx, const vector<real_t>& vy, size_t n ) { monitor_.addPolyline(vx, vy, n); }
+				/*! \brief Attende che i campioni delle sonde siano scritti su file */
+				void flushMonitor ( void ) { monitor_.flush(); }
+				/*! \brief Pubblica lo stato in memoria condivisa POSIX (vedi Solver::LiveFeed): all'inizializzazione
+				e poi ogni \c every passi, senza I/O e senza mai attendere i lettori
+				\param[in] name Nome del segmento (es. "/sodproblem")
+				\param[in] every Numero di passi tra due pubblicazioni
+				\param[in] slots Copie dello stato nell'anello
+				\warning Va chiamato prima di init(); non si combina con l'esecuzione distribuita */
+				void setLiveFeed ( const string& name, size_t every = 1, size_t slots = 3 ) {
+					feedName_ = name;
+					feedEvery_ = max(every, size_t(1));
+					feedSlots_ = slots;
+				}
+				/*! \brief Tiene in memoria le ultime \c capacity istantanee (stato in \c float, vedi Solver::History)
+				e le scrive su file solo attorno agli eventi: una sonda che attraversa una soglia (addProbeTrigger()),
+				un picco del residuo (setResidualTrigger()) o uno stato non fisico (ConsistentState() falso,
+				sempre attivo). Ogni evento produce i file \c eventEE_KKKK.dat nel formato di framegrab()
+				(non interpolato) e una riga in \c events.txt nella directory dei frame
+				\param[in] capacity Istantanee nella finestra scritta a ogni evento
+				\param[in] post Istantanee della finestra dopo l'evento
+				\param[in] every Passi tra due istantanee
+				\warning Va chiamato prima di init(); la scrittura richiede una mesh di triangoli; non si combina
+				con l'esecuzione distribuita */
+				void setHistory ( size_t capacity, size_t post = 0, size_t every = 1 ) {
+					historyCapacity_ = capacity;
+					historyPost_ = post;
+					historyEvery_ = every;
+				}
+				/*! \brief Evento quando la variabile primitiva \c component nel punto (x,y) attraversa
+				la soglia, in un verso o nell'altro (vedi setHistory())
+				\warning Va chiamato prima di init() */
+				void addProbeTrigger ( real_t x, real_t y, int component, real_t threshold ) {
+					triggerProbes_.addProbe(x, y);
+					triggerComponent_.push_back(component);
+					triggerThreshold_.push_back(threshold);
+				}
+				/*! \brief Evento quando il residuo (norma L1 pesata con l'area della variazione delle variabili
+				conservate tra due istantanee, diviso per il tempo trascorso) supera \c factor volte la media
+				dei \c window precedenti (vedi setHistory())
+				\warning Va chiamato prima di init() */
+				void setResidualTrigger ( real_t factor, size_t window = 20 ) { spikeFactor_ = factor; spikeWindow_ = window; }
+				/*! \brief Scrive la finestra di un evento avvenuto meno di \c post istantanee prima della fine,
+				con le istantanee raccolte fino a qui (chiamato anche dal distruttore)
+				\return Vero se e' stata scritta una finestra */
+				bool finishHistory ( void ) {
+					if ( !history_.pending() )
+						return false;
+					flushHistory();
+					return true;
+				}
+				/*! \brief Numero di finestre di eventi scritte */
+				size_t getEventCount ( void ) const { return history_.events(); }
+				/*! \brief Restituisce la regione di interesse di framegrabRegion(), per impostarne filtri,
+				campi e decimazione
+				\warning Va impostata prima di init(), che calcola le liste di celle */
+				Region<FVMesh,real_t>& getRegion ( void ) { return region_; }
+				/*! \brief Imposta i frame incrementali di framegrabDelta() (vedi Solver::DeltaFrameWriter)
+				\param[in] tol Tolleranza assoluta per variabile primitiva (un solo valore: la stessa per tutte)
+				\param[in] keyframe Frame tra due frame completi (0: solo il primo)
+				\warning Va chiamato prima di init() */
+				void setDeltaFrames ( const vector<real_t>& tol, size_t keyframe = 10 ) {
+					deltaTol_.assign(tol.begin(), tol.end());
+					deltaKeyframe_ = keyframe;
+				}
 				// Accesso
 				/*! \brief Restituisce il tempo corrente */
 				real_t getCurrTime(void) { return currtime_; }
 				/*! \brief Restituisce il passo temporale corrente */
 				real_t getCurrDt(void) { return dt_; }
+				/*! \brief Restituisce il numero di chiamate a timestep() dall'inizializzazione */
+				size_t getStep(void) const { return nsteps_; }
+				/*! \brief Restituisce lo stato (variabili conservate) dell'i-esimo poligono */
+				SolType getSol(size_t i) const { return load(q_[i]); }
+				/*! \brief Restituisce il flusso numerico, per impostarne i parametri */
+				NUMFLUX& getNumFlux(void) { return NumFlux; }
+				/*! \brief Con un flusso ibrido e i flussi a blocchi, frazione dei lati interni
+				valutati con il flusso accurato nell'ultimo passo */
+				real_t getSharpFraction(void) const { return faceL_.empty() ? 0.0 : real_t(sharpFaces_.size())/faceL_.size(); }
+				/*! \brief Calcola l'integrale sul dominio delle variabili conservate (massa, quantita' di moto,
+				energia, ...): somme a coppie su blocchi fissi di celle combinati con un albero fisso, lo
+				stesso risultato bit per bit con qualsiasi numero di thread (vedi Solver::Reduction)
+				\warning Nell'esecuzione distribuita i contributi dei processi sono sommati con MPI_Allreduce:
+				il risultato non e' riproducibile al variare del numero di processi */
+				SolType getTotals(void);
+				/*! \brief Restituisce il gruppo di thread del ciclo sulle celle */
+				const ThreadTeam& getThreadTeam(void) const { return team_; }
+				/*! \brief Restituisce il numero di celle aggiornate nell'ultimo passo */
+				size_t getActiveCount(void) const { return tracking_ ? activeList_.size() : mesh_.nP(); }
+				/*! \brief Vista dello stato corrente, senza copie: valida fino al passo successivo
+				\param[in] index Posizione nella lista dei tempi richiesti (vedi stream()) */
+				View view(size_t index = 0) const { return View(model_, mesh_, q_, currtime_, nsteps_, index); }
+				/*! \brief Flusso di frame ai tempi dati: ogni frame fa avanzare il solutore fino al tempo
+				richiesto e restituisce una vista dello stato (vedi Solver::FrameStream e, per l'analisi
+				su un altro thread, Solver::FrameAnalysis)
+				\code
+				for (auto& frame : solver.stream(times))
+					analyse(frame.time(), frame.primitive(0));
+				\endcode */
+				FrameStream<FiniteVolume> stream(const vector<double>& times) { return FrameStream<FiniteVolume>(*this, times); }
+				/*! \brief Esegue passi temporali fino al tempo t, accorciando l'ultimo per arrivarci
+				\warning Con l'operatore lineare il passo e' fisso: si arriva al primo tempo non minore di t */
+				void advanceTo(real_t t);
 				
 				// Inizializza il solutore
 				/*! \brief Inizializza il solutore */
@@ -80,13 +345,82 @@ namespace ConservationLaw2D {
 				/*! \brief Esegue un passo temporale */
 				void timestep();
 			private:
+				// Avanza la soluzione di un passo con il percorso scelto in init()
+				void advance();
+				// Passo di Eulero esplicito dallo stato corrente, che diventa quello precedente
+				void stage();
+				// Interpola la soluzione nei punti del monitor e registra un campione
+				void record();
+				// Crea il segmento condiviso con i baricentri delle celle
+				void openFeed();
+				// Istantanea nella storia, controllo degli eventi e scrittura della finestra
+				void recordHistory();
+				void flushHistory();
+				// Stato non fisico: scrive la finestra che porta all'errore e termina
+				void badState();
 				void updateTimestep();
+				// Passo temporale massimo sulle celle cells[b..e) (tutte le celle se cells e' nullo);
+				// lo stato della cella i-esima e' nella posizione i dei buffer
+				real_t maxTimestep( const size_t* cells, size_t b, size_t e ) const;
+				// Lavoro del thread t: passo temporale, passo di Eulero, combinazione degli stadi,
+				// geometria dei triangoli sul suo intervallo di celle
+				void timestepThread( size_t t );
+				void totalsThread( size_t t );
+				void stageThread( size_t t );
+				void combineThread( size_t t );
+				void fixedCellsThread( size_t t );
+				// Passo temporale sulle sole celle attive
+				void timestepActive();
+				// Costruisce l'insieme delle celle attive
+				void updateActiveSet();
+				// Aggiunge la cella alla lista delle attive, se non c'e' gia'
+				inline void markActive( size_t c ) {
+					if ( activeMark_[c] ) return;
+					activeMark_[c] = 1;
+					activeList_.push_back(c);
+				}
+				// Passo temporale con flussi per lati a blocchi
+				void timestepBatched();
+				// Passo temporale sulle celle [b,e) con N lati
+				template <int N>
+				void timestepFixed( const FixedCell<N>*, size_t, size_t );
+				// Assembla l'operatore del passo temporale per i modelli lineari
+				void assembleLinear();
+				// Passo temporale come prodotto matrice-vettore
+				void timestepLinear();
+				template <int N> struct Int2Type { enum { value = N }; };
+				// Flussi a blocchi dagli stati conservati (lati divisi per tipo con un flusso ibrido)
+				void sweepFaces( Int2Type<0> );
+				void sweepFaces( Int2Type<1> );
+				// Lati interni (tutti o quelli della lista) e lati di bordo con il flusso dato
+				template <typename FLUX>
+				void sweepInterior( const FLUX&, const vector<size_t>* );
+				template <typename FLUX>
+				void sweepBoundary( const FLUX& );
+				// Flussi a blocchi dalla cache per cella (solo se il flusso la supporta)
+				void sweepCachedFaces( Int2Type<0> );
+				void sweepCachedFaces( Int2Type<1> );
 			public:
 				/*! \brief Salva un frame della soluzione
 				\param[in] id Id del frame
 				\param[in] gnuplot Tipologia del plot (GNUPLOT, MATLAB o ALTRO)
 				\param[in] interpolated Dati interpolati ai vertici */
 				void framegrab(size_t const, bool, bool) const;
+				/*! \brief Salva un frame della soluzione (variabili primitive per cella) in formato VTK:
+				un file \c .vtu per processo con le proprie celle e l'indice \c .pvtu scritto dal primo processo
+				\param[in] id Id del frame */
+				void framegrabVTU(size_t const) const;
+				/*! \brief Salva un frame della sola regione di interesse (vedi getRegion()) nel file
+				\c regionNNNN.dat: senza decimazione i triangoli della regione nel formato di framegrab()
+				(non interpolato), con la decimazione una riga "x y valori" per riquadro (righe della
+				griglia separate da una riga vuota, per gnuplot). Solo le componenti scelte con
+				Region::setFields() */
+				void framegrabRegion(size_t const) const;
+				/*! \brief Salva un frame incrementale nel file \c deltaNNNN.bin: solo le celle le cui variabili
+				primitive sono cambiate oltre la tolleranza dall'ultimo frame scritto (vedi setDeltaFrames());
+				i frame si ricostruiscono con Solver::DeltaFrameReader
+				\return Numero di celle scritte */
+				size_t framegrabDelta(size_t const);
 
 			private:
 				// Modello
@@ -102,6 +436,83 @@ namespace ConservationLaw2D {
 				// Altro
 				real_t cflmax_, hmax_, dt_, currtime_;
 				string datadir_;
+				// Tracciamento delle celle attive
+				bool tracking_;
+				real_t trackingTol_;
+				// Celle da aggiornare, celle cambiate all'ultimo passo e celle di bordo
+				vector<size_t> activeList_, changedList_, boundaryList_;
+				vector<char> activeMark_;
+				// Flussi a blocchi: lati interni (poligoni e geometria), lati di bordo e residui
+				bool batched_;
+				vector<size_t> faceL_, faceR_;
+				vector<real_t> faceLen_, faceNx_, faceNy_;
+				vector<hedge_ptr> bfaces_;
+				vector<real_t> residual_;
+				// Lati interni divisi per tipo (flusso ibrido)
+				vector<size_t> cheapFaces_, sharpFaces_;
+				// Cache per cella delle grandezze usate dai flussi
+				bool cached_;
+				vector<real_t, Eigen::aligned_allocator<real_t> > cache_;
+				// Mesh di soli triangoli: vicini e lati di ogni cella in array di dimensione fissa
+				bool triangular_;
+				vector< FixedCell<3>, FirstTouchAllocator< FixedCell<3> > > tri_;
+				// Operatore lineare a blocchi DIM x DIM (BSR): q^{n+1}_i = sum_j A_ij q^n_j + b_i, con
+				// i blocchi A_ij della cella i (per righe) in linBlock_[linStart_[i]..linStart_[i+1]) e
+				// le celle j in linCol_
+				bool linear_;
+				real_t linDt_;
+				vector<size_t> linStart_, linCol_;
+				vector<real_t> linBlock_, linAffine_;
+				// Sonde e linee di campionamento
+				size_t nsteps_;
+				Monitor<FVMesh,real_t,DIM> monitor_;
+				vector<real_t> monitorValues_;
+				// Soluzione corrente e al passo precedente, buffer per gli stadi intermedi
+				Buffer q_, q0_;
+				SolutionPool<Buffer> pool_;
+				size_t stages_;
+				// Thread del ciclo sulle celle
+				size_t nthreads_;
+				bool pin_;
+				ThreadTeam team_;
+				std::function<void(size_t)> timestepJob_, stageJob_, combineJob_;
+				// Riduzioni per blocchi: passo temporale e integrali delle variabili conservate
+				Reduction<real_t> dtReduce_, totalsReduce_;
+				// Stadio Runge-Kutta in corso: q = w q^n + (1-w) q
+				real_t rkWeight_;
+				const Buffer* rkPrev_;
+				// Geometria calcolata da chi ha letto la mesh
+				bool geometryReady_, quiet_;
+				// Stato in memoria condivisa
+				string feedName_;
+				size_t feedEvery_, feedSlots_;
+				LiveFeed feed_;
+				// Storia in memoria e sonde degli eventi (valore al campione precedente)
+				size_t historyCapacity_, historyPost_, historyEvery_;
+				History history_;
+				Monitor<FVMesh,real_t,DIM> triggerProbes_;
+				vector<int> triggerComponent_;
+				vector<real_t> triggerThreshold_, triggerLast_;
+				real_t spikeFactor_;
+				size_t spikeWindow_;
+				// Regione di interesse dei frame
+				Region<FVMesh,real_t> region_;
+				// Frame incrementali e variabili primitive nella numerazione originale
+				vector<double> deltaTol_;
+				size_t deltaKeyframe_;
+				// Tempo da non superare nel passo (vedi advanceTo())
+				real_t stopTime_;
+				DeltaFrameWriter delta_;
+				vector<double> deltaW_;
+#ifdef CONSLAW2D_MPI
+				// Esecuzione distribuita
+				bool distributed_;
+				vector<int> partition_;
+				Decomposition<FVMesh,STORE,DIM> decomp_;
+				// Passo di Eulero sulle celle del processo, con lo scambio delle celle fantasma
+				void stageDistributed();
+				SolType RHSLocal( const polygon_ptr p ) const;
+#endif
 		};
 		
 		
@@ -109,34 +520,200 @@ namespace ConservationLaw2D {
 		//  IMPLEMENTAZIONE  //
 		///////////////////////
 		
-		template <typename MODEL,typename NUMFLUX>
-		void FiniteVolume<MODEL,NUMFLUX>::init() {
+		template <typename MODEL, typename NUMFLUX, typename STORE, int LAYOUT>
+		void FiniteVolume<MODEL,NUMFLUX,STORE,LAYOUT>::init() {
 			// Aggiorno Hmax e inizializzo la soluzione
-			std::cout << "============================= " << std::endl;
-			std::cout << "Init Finite Volume Solver ... " << std::endl;
-			std::cout << "============================= " << std::endl;
+			if ( !quiet_ ) {
+				std::cout << "============================= " << std::endl;
+				std::cout << "Init Finite Volume Solver ... " << std::endl;
+				std::cout << "============================= " << std::endl;
+			}
 			// Inizializzo la geometria per la mesh
-			mesh_.init_geom();
+			if ( !geometryReady_ )
+				mesh_.init_geom();
+			if ( stages_ < 1 || stages_ > 3 || (stages_ > 1 && (tracking_ || linear_)) ) {
+				std::cerr << "Unsupported time integrator with " << stages_ << " stages" << std::endl;
+				exit(1);
+			}
+			// Gruppo di thread: ogni thread inizializza per primo le celle che aggiornera'
+			const bool threaded = ( nthreads_ > 1 );
+			if ( threaded && (tracking_ || batched_ || linear_
+#ifdef CONSLAW2D_MPI
+				|| distributed_
+#endif
+				) ) {
+				std::cerr << "Threaded run supports only the cell loop" << std::endl;
+				exit(1);
+			}
+			team_.start(nthreads_, threaded && pin_);
+			dtReduce_.setup(mesh_.nP());
+			totalsReduce_.setup(mesh_.nP(), DIM);
+			timestepJob_ = std::bind(&FiniteVolume::timestepThread, this, std::placeholders::_1);
+			stageJob_ = std::bind(&FiniteVolume::stageThread, this, std::placeholders::_1);
+			combineJob_ = std::bind(&FiniteVolume::combineThread, this, std::placeholders::_1);
+			// Celle nei buffer: tutte, o solo proprie e fantasma di un processo (numerazione locale)
+			size_t ncells = mesh_.nP();
+#ifdef CONSLAW2D_MPI
+			if ( distributed_ ) {
+				if ( tracking_ || batched_ || linear_ || monitor_.active() ) {
+					std::cerr << "Distributed run supports only the cell loop" << std::endl;
+					exit(1);
+				}
+				int size;
+				MPI_Comm_size(MPI_COMM_WORLD, &size);
+				if ( partition_.empty() ) {
+					// Stesso risultato su tutti i processi: la partizione e' deterministica
+					Mesh::Partitioner<FVMesh> partitioner(mesh_);
+					partitioner.partition(size, Mesh::PARTITION_MULTILEVEL);
+					partition_ = partitioner.part();
+				}
+				decomp_.build(mesh_, partition_);
+				std::cout << "Rank " << decomp_.rank() << ": " << decomp_.owned().size() << " cells ("
+					<< decomp_.border().size() << " on the partition border), " << decomp_.nGhosts() << " ghosts" << std::endl;
+				ncells = decomp_.nLocal();
+			}
+#endif
+			q_.resize(ncells, team_);
+			q0_.resize(ncells, team_);
+			pool_.resize(ncells, &team_);
 			hmax_ = 0.0;
 			for (p_it p = mesh_.p_begin(); p != mesh_.p_end(); ++p) {
-				hmax_ = max( hmax_, (*p)->diam() );
-				(*p)->sol = model_.PrimitiveToConservative(InitialCondition((*p)->getColor(),(*p)->cx(),(*p)->cy()));
+				hmax_ = max( hmax_, real_t((*p)->diam()) );
+				size_t c = (*p)->getId();
+#ifdef CONSLAW2D_MPI
+				// Solo le celle del processo: le fantasma arrivano dallo scambio
+				if ( distributed_ ) {
+					c = decomp_.local(c);
+					if ( c >= decomp_.owned().size() ) continue;
+				}
+#endif
+				q_.set(c, store(model_.PrimitiveToConservative(InitialCondition((*p)->getColor(),(*p)->cx(),(*p)->cy()))));
+			}
+			// Il tracciamento aggiorna solo le celle attive: i due stati devono coincidere sulle altre
+			// (copia elemento per elemento, le pagine restano dove le ha messe il first touch)
+			q0_ = q_;
+			// Nuova simulazione dalle condizioni iniziali: tempo da zero e operatore lineare di
+			// un'inizializzazione precedente (altra mesh o altro passo) riassemblato al primo passo
+			currtime_ = 0.0;
+			linDt_ = 0.0;
+			linStart_.clear();
+			linCol_.clear();
+			linBlock_.clear();
+			linAffine_.clear();
+			if ( tracking_ ) {
+				// Al primo passo tutte le celle sono attive
+				activeList_.clear();
+				changedList_.clear();
+				boundaryList_.clear();
+				activeMark_.assign(mesh_.nP(), 0);
+				for (p_it p = mesh_.p_begin(); p != mesh_.p_end(); ++p) {
+					activeList_.push_back((*p)->getId());
+					changedList_.push_back((*p)->getId());
+					// Le celle di bordo restano sempre attive (condizioni al bordo dipendenti dal tempo)
+					he_cit e = (*p)->beginE();
+					do {
+						if ( e->isBoundary() ) {
+							boundaryList_.push_back((*p)->getId());
+							break;
+						}
+						++e;
+					} while ( e != (*p)->beginE() );
+				}
+			}
+			if ( batched_ ) {
+				// Ogni lato interno compare una sola volta
+				faceL_.clear(); faceR_.clear();
+				faceLen_.clear(); faceNx_.clear(); faceNy_.clear();
+				bfaces_.clear();
+				for (e_it e = mesh_.he_begin(); e != mesh_.he_end(); ++e) {
+					if ( (*e)->isBoundary() ) {
+						bfaces_.push_back(*e);
+					} else if ( (*e)->getId() < (*e)->getTwinHEdge().getId() ) {
+						faceL_.push_back((*e)->polygonL().getId());
+						faceR_.push_back((*e)->polygonR().getId());
+						faceLen_.push_back((*e)->length());
+						faceNx_.push_back((*e)->nx());
+						faceNy_.push_back((*e)->ny());
+					}
+				}
+				residual_.assign(mesh_.nP()*DIM, 0.0);
+			}
+			// Percorso specializzato per i triangoli, scelto in automatico
+#ifdef CONSLAW2D_MPI
+			triangular_ = mesh_.isTriangular() && !batched_ && !distributed_;
+#else
+			triangular_ = mesh_.isTriangular() && !batched_;
+#endif
+			tri_.clear();
+			if ( triangular_ ) {
+				// Elementi non inizializzati: li scrive per primo il thread che li usera'
+				tri_.resize(mesh_.nP());
+				team_.run(std::bind(&FiniteVolume::fixedCellsThread, this, std::placeholders::_1));
+			}
+			if ( threaded && !quiet_ ) {
+				const size_t cellBytes = sizeof(STORE)*( LAYOUT == AoS ? DIM : 1 );
+				team_.report(std::cout, q_.data(), mesh_.nP(), cellBytes);
+			}
+			// Sonde: celle e pesi calcolati una volta, primo campione con le condizioni iniziali
+			nsteps_ = 0;
+			if ( monitor_.active() ) {
+				monitor_.resolve(mesh_);
+				record();
+			}
+			if ( !feedName_.empty() )
+				openFeed();
+			// Storia: prima istantanea con le condizioni iniziali
+			if ( historyCapacity_ > 0 ) {
+#ifdef CONSLAW2D_MPI
+				if ( distributed_ ) {
+					std::cerr << "History is not supported in a distributed run" << std::endl;
+					exit(1);
+				}
+#endif
+				history_.setup(mesh_.nP(), DIM, historyCapacity_, historyPost_, historyEvery_);
+				if ( spikeFactor_ > 0 ) history_.setSpike(spikeFactor_, spikeWindow_);
+				triggerProbes_.resolve(mesh_);
+				triggerLast_.clear();
+				recordHistory();
+			}
+			if ( region_.configured() )
+				region_.resolve(mesh_);
+			if ( !deltaTol_.empty() ) {
+				delta_.setup(mesh_.nP(), DIM, deltaTol_, deltaKeyframe_);
+				deltaW_.resize(mesh_.nP()*DIM);
 			}
 		}
+
+		template <typename MODEL, typename NUMFLUX, typename STORE, int LAYOUT>
+		void FiniteVolume<MODEL,NUMFLUX,STORE,LAYOUT>::openFeed( void ) {
+#ifdef CONSLAW2D_MPI
+			if ( distributed_ ) {
+				std::cerr << "Live feed is not supported in a distributed run" << std::endl;
+				exit(1);
+			}
+#endif
+			if ( !feed_.open(feedName_, mesh_.nP(), DIM, sizeof(STORE), LAYOUT, feedSlots_) ) {
+				std::cerr << "Cannot create shared memory segment " << LiveFeed::shmName(feedName_) << std::endl;
+				exit(1);
+			}
+			for (size_t i = 0; i < mesh_.nP(); ++i)
+				feed_.setCentroid(i, mesh_.p(i)->cx(), mesh_.p(i)->cy());
+			feed_.publish(nsteps_, currtime_, dt_, q_.data());
+		}
 		
-		template <typename MODEL,typename NUMFLUX>
-		inline typename MODEL::SolType FiniteVolume<MODEL,NUMFLUX>::RHS( const polygon_ptr p ) const {
+		template <typename MODEL, typename NUMFLUX, typename STORE, int LAYOUT>
+		inline typename MODEL::SolType FiniteVolume<MODEL,NUMFLUX,STORE,LAYOUT>::RHS( const polygon_ptr p ) const {
 			// Valuto il flusso attraverso i bordi
 			SolType Flux = SolType::Zero();
 			// Stato a sinistra
-			SolType qlstate = p->sol0;
+			SolType qlstate = load(q0_[p->getId()]);
 			// Stato a destra
 			SolType qrstate;
 			he_cit e = p->beginE();
 			do {
 				if ( !e->isBoundary() ) {
 					// Lato interno
-					qrstate = e->polygonR().sol0;
+					qrstate = load(q0_[e->polygonR().getId()]);
 				} else {
 					// Lato di bordo
 					SolType wl = model_.ConservativeToPrimitive(qlstate);
@@ -153,38 +730,887 @@ namespace ConservationLaw2D {
 			return (SourceTerm - Flux) / p->area();
 		}
 
-		template <typename MODEL, typename NUMFLUX>
-		inline void FiniteVolume<MODEL,NUMFLUX>::timestep( void ) {
-			// Salvo la soluzione al passo precedente e calcolo maxLambda
-			updateTimestep();
-			for (p_it p = mesh_.p_begin(); p != mesh_.p_end(); ++p) {
-				(*p)->sol0 = (*p)->sol;
-				if ( !model_.ConsistentState((*p)->sol0) ) {
-					std::cerr << "Bad state solution! Maybe too high CFL number ..." << std::endl;
-					exit(1);
+		template <typename MODEL, typename NUMFLUX, typename STORE, int LAYOUT>
+		template <int N>
+		inline typename MODEL::SolType FiniteVolume<MODEL,NUMFLUX,STORE,LAYOUT>::RHSFixed( const FixedCell<N>& c, const polygon_ptr p ) const {
+			// Valuto il flusso attraverso i bordi
+			SolType Flux = SolType::Zero();
+			// Stato a sinistra
+			SolType qlstate = load(q0_[p->getId()]);
+			// Stato a destra
+			SolType qrstate;
+			// N e' una costante: il ciclo viene srotolato
+			for (int j = 0; j < N; ++j) {
+				if ( c.nb[j] != size_t(NOPOLYGON) ) {
+					// Lato interno
+					qrstate = load(q0_[c.nb[j]]);
+				} else {
+					// Lato di bordo
+					hedge_ptr e = c.e[j];
+					SolType wl = model_.ConservativeToPrimitive(qlstate);
+					SolType wr = BoundaryCondition(wl,e->getColor(),e->xm(),e->ym(),e->nx(),e->ny(),currtime_);
+					qrstate = model_.PrimitiveToConservative(wr);
 				}
+				Flux += c.len[j] * NumFlux(qlstate, qrstate, c.nx[j], c.ny[j]);
+			}
+			// Sommo e divido per l'area
+			return (SolType::Zero() - Flux) / p->area();
+		}
+
+		template <typename MODEL, typename NUMFLUX, typename STORE, int LAYOUT>
+		template <int N>
+		inline void FiniteVolume<MODEL,NUMFLUX,STORE,LAYOUT>::timestepFixed( const FixedCell<N>* cells, size_t b, size_t e ) {
+			// Itero sulle celle, nell'ordine dei poligoni
+			for (size_t i = b; i < e; ++i) {
+				polygon_ptr p = mesh_.p(i);
+				q_.set(i, store(load(q0_[i]) + dt_ * RHSFixed(cells[i], p)));
+			}
+		}
+
+		template <typename MODEL, typename NUMFLUX, typename STORE, int LAYOUT>
+		void FiniteVolume<MODEL,NUMFLUX,STORE,LAYOUT>::fixedCellsThread( size_t t ) {
+			const size_t b = team_.first(t, mesh_.nP()), last = team_.last(t, mesh_.nP());
+			for (size_t i = b; i < last; ++i) {
+				polygon_ptr p = mesh_.p(i);
+				FixedCell<3>& c = tri_[p->getId()];
+				// Stesso ordine dei lati del circolatore, per avere gli stessi risultati di RHS
+				he_cit e = p->beginE();
+				for (int j = 0; j < 3; ++j, ++e) {
+					c.nb[j] = e->isBoundary() ? size_t(NOPOLYGON) : e->polygonR().getId();
+					c.len[j] = e->length();
+					c.nx[j] = e->nx();
+					c.ny[j] = e->ny();
+					c.e[j] = &(*e);
+				}
+			}
+		}
+
+		template <typename MODEL, typename NUMFLUX, typename STORE, int LAYOUT>
+		inline void FiniteVolume<MODEL,NUMFLUX,STORE,LAYOUT>::timestep( void ) {
+			advance();
+			++nsteps_;
+			if ( monitor_.active() && nsteps_ % monitor_.every() == 0 )
+				record();
+			if ( feed_.active() && nsteps_ % feedEvery_ == 0 )
+				feed_.publish(nsteps_, currtime_, dt_, q_.data());
+			if ( history_.active() && nsteps_ % history_.every() == 0 )
+				recordHistory();
+		}
+
+		template <typename MODEL, typename NUMFLUX, typename STORE, int LAYOUT>
+		void FiniteVolume<MODEL,NUMFLUX,STORE,LAYOUT>::record( void ) {
+			// Combinazione dei valori primitivi delle celle con i pesi del monitor
+			monitorValues_.resize(monitor_.nPoints()*DIM);
+			for (size_t i = 0; i < monitor_.nPoints(); ++i) {
+				SolType w = SolType::Zero();
+				for (size_t k = monitor_.begin(i); k < monitor_.end(i); ++k)
+					w += monitor_.weight(k) * model_.ConservativeToPrimitive(load(q_[monitor_.cell(k)]));
+				for (int d = 0; d < DIM; ++d)
+					monitorValues_[i*DIM+d] = w[d];
+			}
+			monitor_.push(nsteps_, currtime_, monitorValues_.empty() ? 0 : &monitorValues_[0]);
+		}
+
+		template <typename MODEL, typename NUMFLUX, typename STORE, int LAYOUT>
+		inline void FiniteVolume<MODEL,NUMFLUX,STORE,LAYOUT>::advance( void ) {
+			if ( linear_ ) {
+				timestepLinear();
+				return;
+			}
+			// Calcolo maxLambda e controllo lo stato
+			updateTimestep();
+			if ( tracking_ ) {
+				timestepActive();
+				return;
+			}
+			if ( stages_ == 1 ) {
+				stage();
+				currtime_ += dt_;
+				return;
+			}
+			// Runge-Kutta SSP: q^(k) = a_k q^n + (1-a_k) (q^(k-1) + dt L(q^(k-1))), al tempo t^n + c_k dt
+			static const real_t a[2][3] = { { 0.0, 0.5, 0.0 }, { 0.0, 0.75, 1.0/3.0 } };
+			static const real_t c[2][3] = { { 0.0, 1.0, 0.0 }, { 0.0, 1.0, 0.5 } };
+			const real_t t0 = currtime_;
+			Buffer& qn = pool_.acquire();
+			stage();
+			// q^n resta nel buffer di appoggio
+			qn.swap(q0_);
+			rkPrev_ = &qn;
+			for (size_t k = 1; k < stages_; ++k) {
+				currtime_ = t0 + c[stages_-2][k]*dt_;
+				stage();
+				rkWeight_ = a[stages_-2][k];
+				team_.run(combineJob_);
+			}
+			rkPrev_ = 0;
+			pool_.release(qn);
+			currtime_ = t0 + dt_;
+		}
+
+		template <typename MODEL, typename NUMFLUX, typename STORE, int LAYOUT>
+		inline void FiniteVolume<MODEL,NUMFLUX,STORE,LAYOUT>::stage( void ) {
+			// Lo stato corrente diventa quello precedente, il nuovo stato sovrascrive tutte le celle
+			q_.swap(q0_);
+#ifdef CONSLAW2D_MPI
+			if ( distributed_ ) {
+				stageDistributed();
+				return;
+			}
+#endif
+			if ( batched_ ) {
+				timestepBatched();
+				return;
+			}
+			team_.run(stageJob_);
+		}
+
+		template <typename MODEL, typename NUMFLUX, typename STORE, int LAYOUT>
+		void FiniteVolume<MODEL,NUMFLUX,STORE,LAYOUT>::stageThread( size_t t ) {
+			const size_t b = team_.first(t, mesh_.nP()), e = team_.last(t, mesh_.nP());
+			if ( triangular_ ) {
+				timestepFixed(&tri_[0], b, e);
+				return;
 			}
 			// Itero sui poligoni
-			for (p_it p = mesh_.p_begin(); p != mesh_.p_end(); ++p) {
+			for (size_t i = b; i < e; ++i) {
+				polygon_ptr p = mesh_.p(i);
 				// Risolvo l'ODE
-				(*p)->sol = (*p)->sol0 + dt_ * RHS(*p);
+				q_.set(p->getId(), store(load(q0_[p->getId()]) + dt_ * RHS(p)));
+			}
+		}
+
+		template <typename MODEL, typename NUMFLUX, typename STORE, int LAYOUT>
+		void FiniteVolume<MODEL,NUMFLUX,STORE,LAYOUT>::combineThread( size_t t ) {
+			const size_t b = team_.first(t, q_.size()), e = team_.last(t, q_.size());
+			const real_t ak = rkWeight_;
+			for (size_t i = b; i < e; ++i)
+				q_.set(i, store(ak*load((*rkPrev_)[i]) + (1-ak)*load(q_[i])));
+		}
+		
+		template <typename MODEL, typename NUMFLUX, typename STORE, int LAYOUT>
+		inline void FiniteVolume<MODEL,NUMFLUX,STORE,LAYOUT>::timestepActive( void ) {
+			// Le celle aggiornate al passo precedente sono le uniche con stato diverso dal precedente:
+			// copio solo quelle invece di scambiare i buffer
+			for (size_t i = 0; i < activeList_.size(); ++i)
+				q0_.set(activeList_[i], q_[activeList_[i]]);
+			updateActiveSet();
+			// Itero solo sui poligoni attivi
+			for (size_t i = 0; i < activeList_.size(); ++i) {
+				polygon_ptr p = mesh_.p(activeList_[i]);
+				SolType q0 = load(q0_[p->getId()]);
+				SolType q = q0 + dt_ * ( triangular_ ? RHSFixed(tri_[p->getId()], p) : RHS(p) );
+				q_.set(p->getId(), store(q));
+				// Variazione trascurabile: la cella non perturba i vicini
+				if ( (q - q0).cwise().abs().maxCoeff() > trackingTol_ * q0.cwise().abs().maxCoeff() )
+					changedList_.push_back(activeList_[i]);
 			}
 			// Aggiorno currtime_
 			currtime_ += dt_;
 		}
-		
-		template <typename MODEL, typename NUMFLUX>
-		inline void FiniteVolume<MODEL,NUMFLUX>::updateTimestep(void) {
-			// Aggiorno il passo temporale
-			dt_ = 1e10;
-			// Calcolo dt da CFL desiderato (cflmax)
+
+		template <typename MODEL, typename NUMFLUX, typename STORE, int LAYOUT>
+		inline void FiniteVolume<MODEL,NUMFLUX,STORE,LAYOUT>::timestepBatched( void ) {
+			std::fill(residual_.begin(), residual_.end(), 0.0);
+			if ( cached_ )
+				sweepCachedFaces( Int2Type<NumericalFlux::BlockFlux<NUMFLUX>::Cached>() );
+			else
+				sweepFaces( Int2Type<NumericalFlux::HybridFlux<NUMFLUX>::value>() );
+			// Risolvo l'ODE
 			for (p_it p = mesh_.p_begin(); p != mesh_.p_end(); ++p) {
-				dt_ = min( dt_, cflmax_* (*p)->diam()/model_.MaxLambda((*p)->sol) );
+				SolType q = load(q0_[(*p)->getId()]);
+				const real_t* r = &residual_[(*p)->getId()*DIM];
+				real_t c = dt_ / (*p)->area();
+				for (int i = 0; i < DIM; ++i)
+					q[i] -= c * r[i];
+				q_.set((*p)->getId(), store(q));
+			}
+		}
+
+		template <typename MODEL, typename NUMFLUX, typename STORE, int LAYOUT>
+		void FiniteVolume<MODEL,NUMFLUX,STORE,LAYOUT>::assembleLinear( void ) {
+			if ( !quiet_ ) std::cout << "Assembling linear operator ... " << std::flush;
+			// Flusso e condizioni al bordo sono affini: li ricavo valutandoli sulla base canonica
+			SolType zero = SolType::Zero();
+			SolType unit[DIM];
+			for (int k = 0; k < DIM; ++k) {
+				unit[k] = SolType::Zero();
+				unit[k][k] = 1.0;
+			}
+			// Operatore di un passo: q^{n+1} = (I + dt L) q^n + dt b
+			linStart_.assign(1, 0);
+			linCol_.clear();
+			linBlock_.clear();
+			linAffine_.resize(mesh_.nP()*DIM);
+			// Blocchi DIM x DIM di una riga di celle: colonna (cella) e valori per righe
+			vector<size_t> cols, order;
+			vector<real_t> vals;
+			for (size_t i = 0; i < mesh_.nP(); ++i) {
+				polygon_ptr p = mesh_.p(i);
+				cols.assign(1, i);
+				vals.assign(DIM*DIM, 0.0);
+				SolType b = SolType::Zero();
+				he_cit e = p->beginE();
+				do {
+					real_t w = - dt_ * e->length() / p->area();
+					// F(ql,qr) = Al ql + Ar qr + f0
+					SolType f0 = NumFlux(zero, zero, e->nx(), e->ny());
+					real_t Al[DIM][DIM], Ar[DIM][DIM];
+					for (int k = 0; k < DIM; ++k) {
+						SolType fl = NumFlux(unit[k], zero, e->nx(), e->ny()) - f0;
+						SolType fr = NumFlux(zero, unit[k], e->nx(), e->ny()) - f0;
+						for (int r = 0; r < DIM; ++r) {
+							Al[r][k] = fl[r];
+							Ar[r][k] = fr[r];
+						}
+					}
+					b += w * f0;
+					if ( !e->isBoundary() ) {
+						// Lato interno: blocco del vicino
+						size_t j = e->polygonR().getId();
+						size_t pos = std::find(cols.begin(), cols.end(), j) - cols.begin();
+						if ( pos == cols.size() ) {
+							cols.push_back(j);
+							vals.resize(vals.size() + DIM*DIM, 0.0);
+						}
+						for (int r = 0; r < DIM; ++r)
+							for (int k = 0; k < DIM; ++k) {
+								vals[r*DIM+k] += w * Al[r][k];
+								vals[pos*DIM*DIM + r*DIM+k] += w * Ar[r][k];
+							}
+					} else {
+						// Lato di bordo: stato fantasma qr = G ql + g
+						SolType wl = model_.ConservativeToPrimitive(zero);
+						SolType g = model_.PrimitiveToConservative(BoundaryCondition(wl,e->getColor(),e->xm(),e->ym(),e->nx(),e->ny(),currtime_));
+						real_t G[DIM][DIM];
+						for (int k = 0; k < DIM; ++k) {
+							wl = model_.ConservativeToPrimitive(unit[k]);
+							SolType gk = model_.PrimitiveToConservative(BoundaryCondition(wl,e->getColor(),e->xm(),e->ym(),e->nx(),e->ny(),currtime_)) - g;
+							for (int r = 0; r < DIM; ++r)
+								G[r][k] = gk[r];
+						}
+						for (int r = 0; r < DIM; ++r) {
+							for (int k = 0; k < DIM; ++k) {
+								real_t ArG = 0.0;
+								for (int l = 0; l < DIM; ++l)
+									ArG += Ar[r][l] * G[l][k];
+								vals[r*DIM+k] += w * ( Al[r][k] + ArG );
+								b[r] += w * Ar[r][k] * g[k];
+							}
+						}
+					}
+					++e;
+				} while ( e != p->beginE() );
+				for (int r = 0; r < DIM; ++r)
+					vals[r*DIM+r] += 1.0;
+				// Blocchi con colonne crescenti
+				order.resize(cols.size());
+				for (size_t c = 0; c < cols.size(); ++c)
+					order[c] = c;
+				for (size_t c = 1; c < order.size(); ++c)
+					for (size_t c2 = c; c2 > 0 && cols[order[c2-1]] > cols[order[c2]]; --c2)
+						std::swap(order[c2-1], order[c2]);
+				for (size_t c = 0; c < order.size(); ++c) {
+					linCol_.push_back(cols[order[c]]);
+					linBlock_.insert(linBlock_.end(), vals.begin() + order[c]*DIM*DIM, vals.begin() + (order[c]+1)*DIM*DIM);
+				}
+				linStart_.push_back(linCol_.size());
+				for (int r = 0; r < DIM; ++r)
+					linAffine_[i*DIM+r] = b[r];
+			}
+			linDt_ = dt_;
+			if ( !quiet_ ) std::cout << "done (" << linCol_.size() << " blocks)" << std::endl;
+		}
+
+		template <typename MODEL, typename NUMFLUX, typename STORE, int LAYOUT>
+		inline void FiniteVolume<MODEL,NUMFLUX,STORE,LAYOUT>::timestepLinear( void ) {
+			// Assemblo l'operatore al primo passo
+			if ( linDt_ == 0.0 ) {
+				updateTimestep();
+				assembleLinear();
+			}
+			// Prodotto a blocchi direttamente tra i buffer: q^n in q0_, q^{n+1} in q_
+			q_.swap(q0_);
+			const size_t n = mesh_.nP();
+			const size_t cs = q_.cellStride(), ks = q_.componentStride();
+			const STORE* x = q0_.data();
+			STORE* y = q_.data();
+			const size_t* start = &linStart_[0];
+			const size_t* col = &linCol_[0];
+			const real_t* A = &linBlock_[0];
+			for (size_t i = 0; i < n; ++i) {
+				real_t sum[DIM];
+				for (int r = 0; r < DIM; ++r)
+					sum[r] = linAffine_[i*DIM+r];
+				for (size_t b = start[i]; b < start[i+1]; ++b) {
+					const STORE* xj = x + col[b]*cs;
+					const real_t* Ab = A + b*DIM*DIM;
+					for (int k = 0; k < DIM; ++k) {
+						const real_t xk = real_t(xj[k*ks]);
+						for (int r = 0; r < DIM; ++r)
+							sum[r] += Ab[r*DIM+k] * xk;
+					}
+				}
+				for (int r = 0; r < DIM; ++r)
+					y[i*cs + r*ks] = STORE(sum[r]);
+			}
+			// Aggiorno currtime_
+			currtime_ += dt_;
+		}
+
+		template <typename MODEL, typename NUMFLUX, typename STORE, int LAYOUT>
+		inline void FiniteVolume<MODEL,NUMFLUX,STORE,LAYOUT>::sweepFaces( Int2Type<0> ) {
+			sweepInterior(NumFlux, 0);
+			sweepBoundary(NumFlux);
+		}
+
+		template <typename MODEL, typename NUMFLUX, typename STORE, int LAYOUT>
+		inline void FiniteVolume<MODEL,NUMFLUX,STORE,LAYOUT>::sweepFaces( Int2Type<1> ) {
+			// Divido i lati interni secondo il sensore del flusso ibrido
+			cheapFaces_.clear();
+			sharpFaces_.clear();
+			for (size_t f = 0; f < faceL_.size(); ++f) {
+				if ( NumFlux.isSharp(load(q0_[faceL_[f]]), load(q0_[faceR_[f]])) )
+					sharpFaces_.push_back(f);
+				else
+					cheapFaces_.push_back(f);
 			}
+			// Ogni gruppo con il proprio kernel, senza selezioni lato per lato
+			sweepInterior(NumFlux.cheap(), &cheapFaces_);
+			sweepInterior(NumFlux.sharp(), &sharpFaces_);
+			// Pochi lati di bordo: sempre il flusso accurato
+			sweepBoundary(NumFlux.sharp());
 		}
+
+		template <typename MODEL, typename NUMFLUX, typename STORE, int LAYOUT>
+		template <typename FLUX>
+		inline void FiniteVolume<MODEL,NUMFLUX,STORE,LAYOUT>::sweepInterior( const FLUX& flux, const vector<size_t>* list ) {
+			Block b;
+			const size_t W = Block::Width;
+			const size_t nfaces = list ? list->size() : faceL_.size();
+			size_t face[Block::Width];
+			// Lati interni: flusso uscente da L ed entrante in R
+			for (size_t f0 = 0; f0 < nfaces; f0 += W) {
+				size_t n = min(W, nfaces-f0);
+				for (size_t k = 0; k < n; ++k) {
+					const size_t f = face[k] = list ? (*list)[f0+k] : f0+k;
+					SolType ql = load(q0_[faceL_[f]]);
+					SolType qr = load(q0_[faceR_[f]]);
+					for (int i = 0; i < DIM; ++i) {
+						b.ql[i][k] = ql[i];
+						b.qr[i][k] = qr[i];
+					}
+					b.nx[k] = faceNx_[f];
+					b.ny[k] = faceNy_[f];
+				}
+				b.pad(n);
+				NumericalFlux::BlockFlux<FLUX>::eval(flux, b);
+				for (size_t k = 0; k < n; ++k) {
+					const size_t f = face[k];
+					real_t* rl = &residual_[faceL_[f]*DIM];
+					real_t* rr = &residual_[faceR_[f]*DIM];
+					for (int i = 0; i < DIM; ++i) {
+						real_t F = faceLen_[f] * b.flux[i][k];
+						rl[i] += F;
+						rr[i] -= F;
+					}
+				}
+			}
+		}
+
+		template <typename MODEL, typename NUMFLUX, typename STORE, int LAYOUT>
+		template <typename FLUX>
+		inline void FiniteVolume<MODEL,NUMFLUX,STORE,LAYOUT>::sweepBoundary( const FLUX& flux ) {
+			Block b;
+			const size_t W = Block::Width;
+			// Lati di bordo: stato a destra dalle condizioni al bordo
+			for (size_t f0 = 0; f0 < bfaces_.size(); f0 += W) {
+				size_t n = min(W, bfaces_.size()-f0);
+				for (size_t k = 0; k < n; ++k) {
+					hedge_ptr e = bfaces_[f0+k];
+					SolType ql = load(q0_[e->polygonL().getId()]);
+					SolType wl = model_.ConservativeToPrimitive(ql);
+					SolType qr = model_.PrimitiveToConservative(BoundaryCondition(wl,e->getColor(),e->xm(),e->ym(),e->nx(),e->ny(),currtime_));
+					for (int i = 0; i < DIM; ++i) {
+						b.ql[i][k] = ql[i];
+						b.qr[i][k] = qr[i];
+					}
+					b.nx[k] = e->nx();
+					b.ny[k] = e->ny();
+				}
+				b.pad(n);
+				NumericalFlux::BlockFlux<FLUX>::eval(flux, b);
+				for (size_t k = 0; k < n; ++k) {
+					hedge_ptr e = bfaces_[f0+k];
+					real_t* rl = &residual_[e->polygonL().getId()*DIM];
+					for (int i = 0; i < DIM; ++i)
+						rl[i] += e->length() * b.flux[i][k];
+				}
+			}
+		}
+
+		template <typename MODEL, typename NUMFLUX, typename STORE, int LAYOUT>
+		void FiniteVolume<MODEL,NUMFLUX,STORE,LAYOUT>::sweepCachedFaces( Int2Type<0> ) {
+			std::cerr << "Numerical flux without cached kernel: use setPrimitiveCache(false)" << std::endl;
+			exit(1);
+		}
+
+		template <typename MODEL, typename NUMFLUX, typename STORE, int LAYOUT>
+		inline void FiniteVolume<MODEL,NUMFLUX,STORE,LAYOUT>::sweepCachedFaces( Int2Type<1> ) {
+			enum { NC = MODEL::NCACHE };
+			typedef NumericalFlux::CachedFaceBlock<real_t,DIM,NC> CachedBlock;
+			// Grandezze per cella, una sola volta per passo
+			cache_.resize(mesh_.nP()*NC);
+			for (p_it p = mesh_.p_begin(); p != mesh_.p_end(); ++p)
+				model_.CellCache(load(q0_[(*p)->getId()]), &cache_[(*p)->getId()*NC]);
+			CachedBlock b;
+			const size_t W = CachedBlock::Width;
+			// Lati interni: flusso uscente da L ed entrante in R
+			for (size_t f0 = 0; f0 < faceL_.size(); f0 += W) {
+				size_t n = min(W, faceL_.size()-f0);
+				for (size_t k = 0; k < n; ++k) {
+					const real_t* wl = &cache_[faceL_[f0+k]*NC];
+					const real_t* wr = &cache_[faceR_[f0+k]*NC];
+					for (int j = 0; j < NC; ++j) {
+						b.wl[j][k] = wl[j];
+						b.wr[j][k] = wr[j];
+					}
+					b.nx[k] = faceNx_[f0+k];
+					b.ny[k] = faceNy_[f0+k];
+				}
+				b.pad(n);
+				NumericalFlux::BlockFlux<NUMFLUX>::eval(NumFlux, b);
+				for (size_t k = 0; k < n; ++k) {
+					real_t* rl = &residual_[faceL_[f0+k]*DIM];
+					real_t* rr = &residual_[faceR_[f0+k]*DIM];
+					for (int i = 0; i < DIM; ++i) {
+						real_t F = faceLen_[f0+k] * b.flux[i][k];
+						rl[i] += F;
+						rr[i] -= F;
+					}
+				}
+			}
+			// Lati di bordo: cache dello stato a destra calcolata al volo
+			real_t wr[NC];
+			for (size_t f0 = 0; f0 < bfaces_.size(); f0 += W) {
+				size_t n = min(W, bfaces_.size()-f0);
+				for (size_t k = 0; k < n; ++k) {
+					hedge_ptr e = bfaces_[f0+k];
+					const real_t* wl = &cache_[e->polygonL().getId()*NC];
+					SolType wlstate = model_.ConservativeToPrimitive(load(q0_[e->polygonL().getId()]));
+					SolType qr = model_.PrimitiveToConservative(BoundaryCondition(wlstate,e->getColor(),e->xm(),e->ym(),e->nx(),e->ny(),currtime_));
+					model_.CellCache(qr, wr);
+					for (int j = 0; j < NC; ++j) {
+						b.wl[j][k] = wl[j];
+						b.wr[j][k] = wr[j];
+					}
+					b.nx[k] = e->nx();
+					b.ny[k] = e->ny();
+				}
+				b.pad(n);
+				NumericalFlux::BlockFlux<NUMFLUX>::eval(NumFlux, b);
+				for (size_t k = 0; k < n; ++k) {
+					hedge_ptr e = bfaces_[f0+k];
+					real_t* rl = &residual_[e->polygonL().getId()*DIM];
+					for (int i = 0; i < DIM; ++i)
+						rl[i] += e->length() * b.flux[i][k];
+				}
+			}
+		}
+
+		template <typename MODEL, typename NUMFLUX, typename STORE, int LAYOUT>
+		inline void FiniteVolume<MODEL,NUMFLUX,STORE,LAYOUT>::updateActiveSet( void ) {
+			// Celle di bordo e celle cambiate piu' un anello di vicini, ognuna una volta sola:
+			// il costo dipende dalle celle attive, non dalla mesh
+			activeList_.clear();
+			for (size_t i = 0; i < boundaryList_.size(); ++i)
+				markActive(boundaryList_[i]);
+			for (size_t i = 0; i < changedList_.size(); ++i) {
+				const size_t c = changedList_[i];
+				markActive(c);
+				if ( triangular_ ) {
+					const FixedCell<3>& f = tri_[c];
+					for (int j = 0; j < 3; ++j)
+						if ( f.nb[j] != size_t(NOPOLYGON) ) markActive(f.nb[j]);
+					continue;
+				}
+				polygon_ptr p = mesh_.p(c);
+				he_cit e = p->beginE();
+				do {
+					if ( !e->isBoundary() )
+						markActive(e->polygonR().getId());
+					++e;
+				} while ( e != p->beginE() );
+			}
+			changedList_.clear();
+			// Lista in ordine crescente per accessi contigui in memoria, azzerando solo i marchi impostati:
+			// una lista corta si ordina, una lunga si ricostruisce scorrendo i marchi
+			if ( activeList_.size() < activeMark_.size()/16 ) {
+				std::sort(activeList_.begin(), activeList_.end());
+				for (size_t i = 0; i < activeList_.size(); ++i)
+					activeMark_[activeList_[i]] = 0;
+				return;
+			}
+			activeList_.clear();
+			for (size_t i = 0; i < activeMark_.size(); ++i)
+				if ( activeMark_[i] ) {
+					activeList_.push_back(i);
+					activeMark_[i] = 0;
+				}
+		}
+
+		template <typename MODEL, typename NUMFLUX, typename STORE, int LAYOUT>
+		inline void FiniteVolume<MODEL,NUMFLUX,STORE,LAYOUT>::updateTimestep(void) {
+#ifdef CONSLAW2D_MPI
+			// Celle del processo, passo comune a tutti i processi
+			if ( distributed_ ) {
+				const vector<size_t>& owned = decomp_.owned();
+				dt_ = decomp_.minAll(maxTimestep(owned.empty() ? 0 : &owned[0], 0, owned.size()));
+				if ( dt_ < 0 ) badState();
+				if ( currtime_ + dt_ > stopTime_ ) dt_ = stopTime_ - currtime_;
+				return;
+			}
+#endif
+			// Minimo per blocchi, poi sull'albero dei blocchi
+			team_.run(timestepJob_);
+			dt_ = dtReduce_.min();
+			if ( dt_ < 0 ) badState();
+			// Ultimo passo prima di un tempo richiesto da advanceTo()
+			if ( currtime_ + dt_ > stopTime_ ) dt_ = stopTime_ - currtime_;
+		}
+
+		template <typename MODEL, typename NUMFLUX, typename STORE, int LAYOUT>
+		void FiniteVolume<MODEL,NUMFLUX,STORE,LAYOUT>::advanceTo( real_t t ) {
+			// Tempi uguali a meno dell'arrotondamento di currtime_ += dt_
+			const real_t eps = 1e-12 * max(real_t(1), std::abs(t));
+			stopTime_ = t;
+			while ( currtime_ < t - eps )
+				timestep();
+			stopTime_ = std::numeric_limits<real_t>::max();
+		}
+
+		template <typename MODEL, typename NUMFLUX, typename STORE, int LAYOUT>
+		void FiniteVolume<MODEL,NUMFLUX,STORE,LAYOUT>::badState( void ) {
+			std::cerr << "Bad state solution! Maybe too high CFL number ..." << std::endl;
+			if ( history_.active() ) {
+				// L'ultima istantanea della finestra e' lo stato non valido
+				float* snap = history_.push(nsteps_, currtime_);
+				for (size_t c = 0; c < mesh_.nP(); ++c)
+					for (int i = 0; i < DIM; ++i)
+						snap[c*DIM+i] = float(q_(c, i));
+				history_.trigger("inconsistent state");
+				flushHistory();
+			}
+			exit(1);
+		}
+
+		template <typename MODEL, typename NUMFLUX, typename STORE, int LAYOUT>
+		void FiniteVolume<MODEL,NUMFLUX,STORE,LAYOUT>::recordHistory( void ) {
+			// Istantanea compatta e, nella stessa passata, residuo rispetto alla precedente
+			const float* prev = history_.last();
+			const double tprev = prev ? history_.lastTime() : 0.0;
+			float* snap = history_.push(nsteps_, currtime_);
+			real_t residual(0);
+			for (size_t c = 0; c < mesh_.nP(); ++c) {
+				const real_t area = mesh_.p(c)->area();
+				for (int i = 0; i < DIM; ++i) {
+					const real_t v = q_(c, i);
+					// Con una sola istantanea prev e snap coincidono: leggo prima di scrivere
+					if ( prev ) residual += area * std::abs(v - real_t(prev[c*DIM+i]));
+					snap[c*DIM+i] = float(v);
+				}
+			}
+			if ( prev && currtime_ > tprev ) residual /= (currtime_ - tprev);
+			// Sonde: attraversamento della soglia tra due istantanee
+			const bool first = triggerLast_.empty();
+			triggerLast_.resize(triggerProbes_.nPoints());
+			for (size_t j = 0; j < triggerProbes_.nPoints(); ++j) {
+				SolType w = SolType::Zero();
+				for (size_t k = triggerProbes_.begin(j); k < triggerProbes_.end(j); ++k)
+					w += triggerProbes_.weight(k) * model_.ConservativeToPrimitive(load(q_[triggerProbes_.cell(k)]));
+				const real_t v = w[triggerComponent_[j]], thr = triggerThreshold_[j];
+				if ( !first && (triggerLast_[j] < thr) != (v < thr) ) {
+					stringstream reason;
+					reason << "probe " << j << " crossed " << thr;
+					history_.trigger(reason.str());
+				}
+				triggerLast_[j] = v;
+			}
+			if ( prev && history_.spikeActive() && history_.spike(residual) )
+				history_.trigger("residual spike");
+			if ( history_.due() )
+				flushHistory();
+		}
+
+		template <typename MODEL, typename NUMFLUX, typename STORE, int LAYOUT>
+		void FiniteVolume<MODEL,NUMFLUX,STORE,LAYOUT>::flushHistory( void ) {
+			const size_t id = history_.events();
+			// Indice degli eventi: riscritto dal primo evento della simulazione
+			std::ofstream index((datadir_ + "/events.txt").c_str(), id ? std::ios::app : std::ios::trunc);
+			index << "event " << id << " step " << history_.eventStep() << " time " << history_.eventTime()
+				<< " (" << history_.reason() << "):";
+			SolType q;
+			for (size_t k = 0; k < history_.size(); ++k) {
+				stringstream buffer;
+				buffer.fill('0');
+				buffer << datadir_ << "/event" << std::setw(2) << id << "_" << std::setw(4) << k << ".dat";
+				std::ofstream filehandle(buffer.str().c_str());
+				const float* snap = history_.data(k);
+				// Numerazione originale dei triangoli, come framegrab()
+				for (size_t i = 0; i < mesh_.nP(); ++i) {
+					polygon_ptr p = mesh_.pOrig(i);
+					for (int d = 0; d < DIM; ++d)
+						q[d] = snap[p->getId()*DIM+d];
+					writeTriangle(filehandle, p, model_.ConservativeToPrimitive(q));
+				}
+				index << " " << history_.step(k);
+			}
+			index << std::endl;
+			history_.flushed();
+		}
+
+		template <typename MODEL, typename NUMFLUX, typename STORE, int LAYOUT>
+		void FiniteVolume<MODEL,NUMFLUX,STORE,LAYOUT>::timestepThread( size_t t ) {
+			const size_t nb = dtReduce_.nBlocks();
+			for (size_t b = team_.first(t, nb); b < team_.last(t, nb); ++b)
+				dtReduce_(b) = maxTimestep(0, dtReduce_.begin(b), dtReduce_.end(b));
+		}
+
+		template <typename MODEL, typename NUMFLUX, typename STORE, int LAYOUT>
+		typename MODEL::SolType FiniteVolume<MODEL,NUMFLUX,STORE,LAYOUT>::getTotals( void ) {
+			SolType totals;
+#ifdef CONSLAW2D_MPI
+			if ( distributed_ ) {
+				// Celle del processo (le prime dei buffer), poi somma su tutti i processi
+				const vector<size_t>& owned = decomp_.owned();
+				PairwiseSum<real_t,DIM> sum;
+				for (size_t k = 0; k < owned.size(); ++k) {
+					const SolType q = real_t(mesh_.p(owned[k])->area()) * load(q_[k]);
+					sum.add(q.data());
+				}
+				for (int i = 0; i < DIM; ++i)
+					totals[i] = decomp_.sumAll(sum.value(i));
+				return totals;
+			}
+#endif
+			team_.run(std::bind(&FiniteVolume::totalsThread, this, std::placeholders::_1));
+			for (int i = 0; i < DIM; ++i)
+				totals[i] = totalsReduce_.sum(i);
+			return totals;
+		}
+
+		template <typename MODEL, typename NUMFLUX, typename STORE, int LAYOUT>
+		void FiniteVolume<MODEL,NUMFLUX,STORE,LAYOUT>::totalsThread( size_t t ) {
+			const size_t nb = totalsReduce_.nBlocks();
+			for (size_t b = team_.first(t, nb); b < team_.last(t, nb); ++b) {
+				PairwiseSum<real_t,DIM> sum;
+				for (size_t c = totalsReduce_.begin(b); c < totalsReduce_.end(b); ++c) {
+					const SolType q = real_t(mesh_.p(c)->area()) * load(q_[c]);
+					sum.add(q.data());
+				}
+				for (int i = 0; i < DIM; ++i)
+					totalsReduce_(b, i) = sum.value(i);
+			}
+		}
+
+		template <typename MODEL, typename NUMFLUX, typename STORE, int LAYOUT>
+		typename MODEL::real_t FiniteVolume<MODEL,NUMFLUX,STORE,LAYOUT>::maxTimestep( const size_t* cells, size_t b, size_t e ) const {
+			real_t dt = 1e10;
+			// Calcolo dt da CFL desiderato (cflmax), nella stessa passata controllo lo stato
+			for (size_t i = b; i < e; ++i) {
+				polygon_ptr p = mesh_.p(cells ? cells[i] : i);
+				const SolType q = load(q_[i]);
+				// Stato non fisico: segnalato con un passo negativo (vedi badState())
+				if ( !model_.ConsistentState(q) )
+					return real_t(-1);
+				dt = min( dt, cflmax_* p->diam()/model_.MaxLambda(q) );
+			}
+			return dt;
+		}
+
+#ifdef CONSLAW2D_MPI
+		template <typename MODEL, typename NUMFLUX, typename STORE, int LAYOUT>
+		void FiniteVolume<MODEL,NUMFLUX,STORE,LAYOUT>::stageDistributed( void ) {
+			// Invio le celle di bordo della partizione e ricevo le celle fantasma dello stato precedente
+			decomp_.startExchange(q0_);
+			// Nel frattempo aggiorno le celle che non hanno vicini fantasma
+			const vector<size_t>& interior = decomp_.interior();
+			for (size_t i = 0; i < interior.size(); ++i) {
+				const size_t c = decomp_.local(interior[i]);
+				q_.set(c, store(load(q0_[c]) + dt_ * RHSLocal(mesh_.p(interior[i]))));
+			}
+			decomp_.finishExchange(q0_);
+			const vector<size_t>& border = decomp_.border();
+			for (size_t i = 0; i < border.size(); ++i) {
+				const size_t c = decomp_.local(border[i]);
+				q_.set(c, store(load(q0_[c]) + dt_ * RHSLocal(mesh_.p(border[i]))));
+			}
+		}
+
+		template <typename MODEL, typename NUMFLUX, typename STORE, int LAYOUT>
+		inline typename MODEL::SolType FiniteVolume<MODEL,NUMFLUX,STORE,LAYOUT>::RHSLocal( const polygon_ptr p ) const {
+			// Come RHS(), con gli stati nella numerazione locale del processo
+			SolType Flux = SolType::Zero();
+			SolType qlstate = load(q0_[decomp_.local(p->getId())]);
+			SolType qrstate;
+			he_cit e = p->beginE();
+			do {
+				if ( !e->isBoundary() ) {
+					qrstate = load(q0_[decomp_.local(e->polygonR().getId())]);
+				} else {
+					SolType wl = model_.ConservativeToPrimitive(qlstate);
+					SolType wr = BoundaryCondition(wl,e->getColor(),e->xm(),e->ym(),e->nx(),e->ny(),currtime_);
+					qrstate = model_.PrimitiveToConservative(wr);
+				}
+				Flux += e->length() * NumFlux(qlstate, qrstate, e->nx(), e->ny());
+				++e;
+			} while ( e != p->beginE() );
+			return (SolType::Zero() - Flux) / p->area();
+		}
+#endif
 		
-		template <typename MODEL, typename NUMFLUX>
-		inline void FiniteVolume<MODEL,NUMFLUX>::framegrab( size_t const id, bool gnuplot, bool interpolated ) const {
+		template <typename MODEL, typename NUMFLUX, typename STORE, int LAYOUT>
+		void FiniteVolume<MODEL,NUMFLUX,STORE,LAYOUT>::framegrabVTU( size_t const id ) const {
+			// Celle del processo (tutte senza decomposizione)
+			int rank(0), size(1);
+			bool all(true);
+			vector<size_t> cells;
+#ifdef CONSLAW2D_MPI
+			if ( distributed_ ) {
+				rank = decomp_.rank();
+				size = decomp_.size();
+				cells = decomp_.owned();
+				all = false;
+			}
+#endif
+			if ( all )
+				for (size_t i = 0; i < mesh_.nP(); ++i) cells.push_back(i);
+			// Nomi dei file
+			stringstream base, piece;
+			base.fill('0');
+			base << "solution" << std::setw(4) << id;
+			piece << base.str() << "_p" << rank << ".vtu";
+			// Vertici delle celle con numerazione locale
+			vector<size_t> local(mesh_.nV(), size_t(NOPOLYGON)), verts, conn, offsets;
+			for (size_t i = 0; i < cells.size(); ++i) {
+				pv_cit vc = mesh_.p(cells[i])->beginV();
+				do {
+					size_t& l = local[vc->getId()];
+					if ( l == size_t(NOPOLYGON) ) {
+						l = verts.size();
+						verts.push_back(vc->getId());
+					}
+					conn.push_back(l);
+					++vc;
+				} while ( vc != mesh_.p(cells[i])->beginV() );
+				offsets.push_back(conn.size());
+			}
+			std::ofstream out((datadir_ + "/" + piece.str()).c_str());
+			out << std::setprecision(10);
+			out << "<?xml version=\"1.0\"?>" << endl;
+			out << "<VTKFile type=\"UnstructuredGrid\" version=\"0.1\" byte_order=\"LittleEndian\">" << endl;
+			out << "<UnstructuredGrid>" << endl;
+			out << "<Piece NumberOfPoints=\"" << verts.size() << "\" NumberOfCells=\"" << cells.size() << "\">" << endl;
+			out << "<Points>" << endl << "<DataArray type=\"Float64\" NumberOfComponents=\"3\" format=\"ascii\">" << endl;
+			for (size_t k = 0; k < verts.size(); ++k)
+				out << mesh_.v(verts[k])->x() << " " << mesh_.v(verts[k])->y() << " 0" << endl;
+			out << "</DataArray>" << endl << "</Points>" << endl;
+			out << "<Cells>" << endl << "<DataArray type=\"Int64\" Name=\"connectivity\" format=\"ascii\">" << endl;
+			for (size_t k = 0; k < conn.size(); ++k)
+				out << conn[k] << ( (k+1) % 16 == 0 ? "\n" : " " );
+			out << endl << "</DataArray>" << endl << "<DataArray type=\"Int64\" Name=\"offsets\" format=\"ascii\">" << endl;
+			for (size_t k = 0; k < offsets.size(); ++k)
+				out << offsets[k] << ( (k+1) % 16 == 0 ? "\n" : " " );
+			out << endl << "</DataArray>" << endl << "<DataArray type=\"UInt8\" Name=\"types\" format=\"ascii\">" << endl;
+			// VTK_POLYGON
+			for (size_t k = 0; k < cells.size(); ++k)
+				out << 7 << ( (k+1) % 16 == 0 ? "\n" : " " );
+			out << endl << "</DataArray>" << endl << "</Cells>" << endl;
+			// Variabili primitive, una componente per array, e processo proprietario
+			out << "<CellData Scalars=\"w0\">" << endl;
+			for (int d = 0; d < DIM; ++d) {
+				out << "<DataArray type=\"Float64\" Name=\"w" << d << "\" format=\"ascii\">" << endl;
+				// La k-esima cella e' nella posizione k dei buffer (anche con la numerazione locale)
+				for (size_t k = 0; k < cells.size(); ++k)
+					out << model_.ConservativeToPrimitive(load(q_[k]))[d] << endl;
+				out << "</DataArray>" << endl;
+			}
+			out << "<DataArray type=\"Int32\" Name=\"rank\" format=\"ascii\">" << endl;
+			for (size_t k = 0; k < cells.size(); ++k)
+				out << rank << ( (k+1) % 16 == 0 ? "\n" : " " );
+			out << endl << "</DataArray>" << endl << "</CellData>" << endl;
+			out << "</Piece>" << endl << "</UnstructuredGrid>" << endl << "</VTKFile>" << endl;
+			if ( rank != 0 )
+				return;
+			// Indice dei pezzi
+			std::ofstream index((datadir_ + "/" + base.str() + ".pvtu").c_str());
+			index << "<?xml version=\"1.0\"?>" << endl;
+			index << "<VTKFile type=\"PUnstructuredGrid\" version=\"0.1\" byte_order=\"LittleEndian\">" << endl;
+			index << "<PUnstructuredGrid GhostLevel=\"0\">" << endl;
+			index << "<PPoints>" << endl << "<PDataArray type=\"Float64\" NumberOfComponents=\"3\"/>" << endl << "</PPoints>" << endl;
+			index << "<PCellData Scalars=\"w0\">" << endl;
+			for (int d = 0; d < DIM; ++d)
+				index << "<PDataArray type=\"Float64\" Name=\"w" << d << "\"/>" << endl;
+			index << "<PDataArray type=\"Int32\" Name=\"rank\"/>" << endl << "</PCellData>" << endl;
+			for (int r = 0; r < size; ++r)
+				index << "<Piece Source=\"" << base.str() << "_p" << r << ".vtu\"/>" << endl;
+			index << "</PUnstructuredGrid>" << endl << "</VTKFile>" << endl;
+		}
+
+		template <typename MODEL, typename NUMFLUX, typename STORE, int LAYOUT>
+		void FiniteVolume<MODEL,NUMFLUX,STORE,LAYOUT>::framegrabRegion( size_t const id ) const {
+			if ( !region_.resolved() ) {
+				std::cerr << "Error: output region not set before init()!" << std::endl;
+				exit(1);
+			}
+			stringstream buffer;
+			buffer.fill('0');
+			buffer << datadir_ << "/region" << std::setw(4) << id << ".dat";
+			std::ofstream filehandle(buffer.str().c_str());
+			const vector<int>& fields = region_.fields();
+			if ( region_.decimation() == Region<FVMesh,real_t>::NONE ) {
+				// Solo mesh triangolari
+				assert(mesh_.isTriangular());
+				for (size_t i = 0; i < region_.nCells(); ++i) {
+					const size_t c = region_.cell(i);
+					writeTriangle(filehandle, mesh_.p(c), model_.ConservativeToPrimitive(load(q_[c])), &fields);
+				}
+				return;
+			}
+			// Riquadri: media delle variabili conservate, poi variabili primitive
+			for (size_t k = 0; k < region_.nBins(); ++k) {
+				if ( k > 0 && region_.binRow(k) != region_.binRow(k-1) )
+					filehandle << endl;
+				SolType q = SolType::Zero();
+				for (size_t j = region_.begin(k); j < region_.end(k); ++j)
+					q += region_.binWeight(j) * load(q_[region_.binCell(j)]);
+				const SolType w = model_.ConservativeToPrimitive(q);
+				filehandle << region_.binX(k) << " " << region_.binY(k);
+				if ( fields.empty() )
+					for (int i = 0; i < DIM; ++i) filehandle << " " << w[i];
+				else
+					for (size_t i = 0; i < fields.size(); ++i) filehandle << " " << w[fields[i]];
+				filehandle << endl;
+			}
+		}
+
+		template <typename MODEL, typename NUMFLUX, typename STORE, int LAYOUT>
+		size_t FiniteVolume<MODEL,NUMFLUX,STORE,LAYOUT>::framegrabDelta( size_t const id ) {
+			if ( !delta_.active() ) {
+				std::cerr << "Error: delta frames not set before init()!" << std::endl;
+				exit(1);
+			}
+			// Variabili primitive nella numerazione originale
+			for (size_t i = 0; i < mesh_.nP(); ++i) {
+				const SolType w = model_.ConservativeToPrimitive(load(q_[mesh_.pOrig(i)->getId()]));
+				for (int d = 0; d < DIM; ++d)
+					deltaW_[i*DIM+d] = w[d];
+			}
+			return delta_.write(datadir_, id, nsteps_, currtime_, &deltaW_[0]);
+		}
+
+		template <typename MODEL, typename NUMFLUX, typename STORE, int LAYOUT>
+		inline void FiniteVolume<MODEL,NUMFLUX,STORE,LAYOUT>::framegrab( size_t const id, bool gnuplot, bool interpolated ) const {
 			// Nome del file
 			stringstream buffer;
 			buffer.fill('0');
@@ -196,16 +1622,18 @@ namespace ConservationLaw2D {
 				// Interpolo in ogni caso
 				// Solo mesh triangolari
 				assert(mesh_.isTriangular());
-				for ( v_it v = mesh_.v_begin(); v != mesh_.v_end(); ++v ) {
+				// Numerazione originale dei vertici (la mesh potrebbe essere stata riordinata)
+				for ( size_t i = 0; i < mesh_.nV(); ++i ) {
+					vertex_ptr v = mesh_.vOrig(i);
 					// Interpolo dai poligoni adiacenti
 					SolType tmpsol = SolType::Zero();
 					size_t count(0);
-					vp_cit p = (*v)->beginP();
+					vp_cit p = v->beginP();
 					do {
-						tmpsol += model_.ConservativeToPrimitive(p->sol);
+						tmpsol += model_.ConservativeToPrimitive(load(q_[p->getId()]));
 						count++;
 						p++;
-					} while( p != (*v)->beginP() );
+					} while( p != v->beginP() );
 					tmpsol /= count;
 					// Output
 					filehandle << tmpsol[0] << std::endl;
@@ -214,24 +1642,12 @@ namespace ConservationLaw2D {
 			if (gnuplot) {
 				// Solo mesh triangolari
 				assert(mesh_.isTriangular());
-				// Itero su tutti i triangoli
-				for ( p_it p = mesh_.p_begin(); p != mesh_.p_end(); ++p ) {
+				// Itero su tutti i triangoli nella numerazione originale
+				for ( size_t i = 0; i < mesh_.nP(); ++i ) {
+					polygon_ptr p = mesh_.pOrig(i);
 					if (!interpolated) {
 						// Soluzione non interpolata
-						SolType sol = model_.ConservativeToPrimitive((*p)->sol);
-						stringstream strsol;
-						for (int i=0; i<sol.rows(); ++i)
-							strsol << sol[i] << " ";
-						pv_cit vc = (*p)->beginV();
-						// Vertice 1
-						filehandle << vc->x() << " " << vc->y() << " " << strsol.str() << endl;
-						vc++;
-						// Vertice 2
-						filehandle << vc->x() << " " << vc->y() << " " << strsol.str() << endl << endl;
-						vc++;
-						// Vertice 3
-						filehandle << vc->x() << " " << vc->y() << " " << strsol.str() << endl;
-						filehandle << vc->x() << " " << vc->y() << " " << strsol.str() << endl << endl << endl;
+						writeTriangle(filehandle, p, model_.ConservativeToPrimitive(load(q_[p->getId()])));
 					} else {
 						// Soluzione interpolata
 						SolType tmpsol = SolType::Zero();
@@ -240,11 +1656,11 @@ namespace ConservationLaw2D {
 						vp_cit pc;
 						stringstream strsol;
 						// Vertice 1
-						vc = (*p)->beginV();
+						vc = p->beginV();
 						count = 0.0;
 						pc = vc->beginP();
 						do {
-							tmpsol += model_.ConservativeToPrimitive(pc->sol);
+							tmpsol += model_.ConservativeToPrimitive(load(q_[pc->getId()]));
 							count++;
 							pc++;
 						} while( pc != vc->beginP() );
@@ -258,7 +1674,7 @@ namespace ConservationLaw2D {
 						count = 0.0;
 						pc = vc->beginP();
 						do {
-							tmpsol += model_.ConservativeToPrimitive(pc->sol);
+							tmpsol += model_.ConservativeToPrimitive(load(q_[pc->getId()]));
 							count++;
 							pc++;
 						} while( pc != vc->beginP() );
@@ -273,7 +1689,7 @@ namespace ConservationLaw2D {
 						count = 0.0;
 						pc = vc->beginP();
 						do {
-							tmpsol += model_.ConservativeToPrimitive(pc->sol);
+							tmpsol += model_.ConservativeToPrimitive(load(q_[pc->getId()]));
 							count++;
 							pc++;
 						} while( pc != vc->beginP() );
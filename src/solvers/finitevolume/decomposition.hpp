@@ -0,0 +1,244 @@
+#ifndef _FINITEVOLUME_DECOMPOSITION_HPP
+#define _FINITEVOLUME_DECOMPOSITION_HPP
+
+// Decomposizione del dominio per l'esecuzione distribuita (MPI)
+// Disponibile solo compilando con -DCONSLAW2D_MPI (e mpicxx)
+
+#ifdef CONSLAW2D_MPI
+
+#include <mpi.h>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+#include <cstdlib>
+
+namespace ConservationLaw2D {
+	namespace Solver {
+
+		using namespace std;
+
+		/*! \brief Tipo MPI corrispondente al tipo reale \c T */
+		template <typename T> struct MPIType;
+		template <> struct MPIType<double> { static MPI_Datatype get( void ) { return MPI_DOUBLE; } };
+		template <> struct MPIType<float> { static MPI_Datatype get( void ) { return MPI_FLOAT; } };
+
+		template <typename MESH, typename T, int DIM>
+		/*! \class Decomposition
+			\brief Decomposizione delle celle tra i processi MPI con uno strato di celle fantasma
+
+			Ogni processo legge l'intera mesh ma aggiorna solo le proprie celle. I buffer della soluzione
+			contengono solo le celle del processo e le celle fantasma, con una numerazione locale: prima
+			le celle proprie in ordine di id, poi le fantasma nell'ordine di ricezione (vedi local()).
+			I vicini sono ricavati dai lati gemelli: per ogni processo vicino si scambiano le celle di
+			bordo della partizione, ordinate per id (stesso ordine su chi invia e su chi riceve).
+
+			Le celle proprie sono divise in interne (nessun vicino fantasma) e di bordo, in modo da
+			calcolare le interne mentre lo scambio non bloccante e' in corso. */
+		class Decomposition {
+			public:
+				/*! \brief Cella assente dalla numerazione locale */
+				enum { NOCELL = -1 };
+
+				Decomposition():comm_(MPI_COMM_WORLD),rank_(0),size_(1) {}
+
+				/*! \brief Imposta il comunicatore */
+				void setComm( MPI_Comm comm ) { comm_ = comm; }
+				/*! \brief Costruisce liste di celle e di scambio
+				\param[in] mesh Mesh (uguale su tutti i processi)
+				\param[in] part Processo proprietario di ogni cella (uguale su tutti i processi) */
+				void build( MESH& mesh, const vector<int>& part );
+
+				/*! \brief Indice del processo */
+				int rank( void ) const { return rank_; }
+				/*! \brief Numero di processi */
+				int size( void ) const { return size_; }
+				/*! \brief Processo proprietario della cella c */
+				int owner( size_t c ) const { return part_[c]; }
+				/*! \brief Celle del processo, in ordine crescente */
+				const vector<size_t>& owned( void ) const { return owned_; }
+				/*! \brief Celle del processo senza vicini di altri processi */
+				const vector<size_t>& interior( void ) const { return interior_; }
+				/*! \brief Celle del processo con almeno un vicino di un altro processo */
+				const vector<size_t>& border( void ) const { return border_; }
+				/*! \brief Numero di celle fantasma */
+				size_t nGhosts( void ) const { return recvList_.size(); }
+				/*! \brief Numero di celle nei buffer del processo (proprie e fantasma) */
+				size_t nLocal( void ) const { return owned_.size() + recvList_.size(); }
+				/*! \brief Posizione della cella c nei buffer del processo (NOCELL se non e' propria ne' fantasma) */
+				size_t local( size_t c ) const { return local_[c]; }
+
+				/*! \brief Avvia lo scambio non bloccante delle celle fantasma dal buffer q (numerazione locale) */
+				template <typename BUFFER>
+				void startExchange( const BUFFER& q );
+				/*! \brief Attende la fine dello scambio e copia le celle fantasma nel buffer q (numerazione locale) */
+				template <typename BUFFER>
+				void finishExchange( BUFFER& q );
+				/*! \brief Raccoglie nel processo root le celle di tutti i processi
+				\param[in] q Buffer del processo (numerazione locale)
+				\param[out] all Nel processo root, buffer di tutte le celle indicizzato con l'id globale */
+				template <typename BUFFER>
+				void gather( const BUFFER& q, BUFFER& all, int root = 0 );
+				/*! \brief Minimo su tutti i processi */
+				double minAll( double v ) const {
+					double r;
+					MPI_Allreduce(&v, &r, 1, MPI_DOUBLE, MPI_MIN, comm_);
+					return r;
+				}
+				/*! \brief Somma su tutti i processi */
+				double sumAll( double v ) const {
+					double r;
+					MPI_Allreduce(&v, &r, 1, MPI_DOUBLE, MPI_SUM, comm_);
+					return r;
+				}
+
+			private:
+				MPI_Comm comm_;
+				int rank_, size_;
+				vector<int> part_;
+				vector<size_t> owned_, interior_, border_;
+				// Numerazione locale: posizione nei buffer di ogni cella globale
+				vector<size_t> local_;
+				// Processi vicini e liste di invio (posizioni locali) e ricezione (id globali), CSR con un intervallo per vicino
+				vector<int> nbRank_;
+				vector<size_t> sendStart_, sendList_, recvStart_, recvList_;
+				vector<T> sendBuf_, recvBuf_;
+				vector<MPI_Request> requests_;
+		};
+
+		// ===========
+		// DEFINITIONS
+		// ===========
+
+		template <typename MESH, typename T, int DIM>
+		void Decomposition<MESH,T,DIM>::build( MESH& mesh, const vector<int>& part ) {
+			typedef typename MESH::polygon_ptr polygon_ptr;
+			typedef typename MESH::Polygon::HEdgeCirculator he_cit;
+			MPI_Comm_rank(comm_, &rank_);
+			MPI_Comm_size(comm_, &size_);
+			if ( part.size() != mesh.nP() ) {
+				std::cerr << "Error: partition size differs from the number of cells!" << std::endl;
+				exit(1);
+			}
+			part_ = part;
+			owned_.clear(); interior_.clear(); border_.clear();
+			// Coppie (processo vicino, cella) da inviare e da ricevere
+			vector< pair<int,size_t> > send, recv;
+			for (size_t c = 0; c < mesh.nP(); ++c) {
+				if ( part_[c] != rank_ ) continue;
+				owned_.push_back(c);
+				polygon_ptr p = mesh.p(c);
+				bool isBorder = false;
+				he_cit e = p->beginE();
+				do {
+					if ( !e->isBoundary() ) {
+						const size_t n = e->polygonR().getId();
+						if ( part_[n] != rank_ ) {
+							isBorder = true;
+							send.push_back(make_pair(part_[n], c));
+							recv.push_back(make_pair(part_[n], n));
+						}
+					}
+					++e;
+				} while ( e != p->beginE() );
+				if ( isBorder )
+					border_.push_back(c);
+				else
+					interior_.push_back(c);
+			}
+			// Ordino per processo e per id, senza ripetizioni
+			sort(send.begin(), send.end());
+			send.erase(unique(send.begin(), send.end()), send.end());
+			sort(recv.begin(), recv.end());
+			recv.erase(unique(recv.begin(), recv.end()), recv.end());
+			nbRank_.clear();
+			sendStart_.assign(1, 0); sendList_.clear();
+			recvStart_.assign(1, 0); recvList_.clear();
+			// La relazione di vicinanza e' simmetrica: i processi delle due liste coincidono
+			for (size_t k = 0; k < send.size(); ++k) {
+				if ( nbRank_.empty() || nbRank_.back() != send[k].first ) {
+					if ( !nbRank_.empty() ) sendStart_.push_back(sendList_.size());
+					nbRank_.push_back(send[k].first);
+				}
+				sendList_.push_back(send[k].second);
+			}
+			if ( !nbRank_.empty() ) sendStart_.push_back(sendList_.size());
+			for (size_t j = 0, k = 0; j < nbRank_.size(); ++j) {
+				while ( k < recv.size() && recv[k].first == nbRank_[j] )
+					recvList_.push_back(recv[k++].second);
+				recvStart_.push_back(recvList_.size());
+			}
+			// Celle proprie nelle prime posizioni, poi le fantasma nell'ordine di ricezione
+			// (ogni cella ha un solo proprietario: le fantasma non si ripetono)
+			local_.assign(part_.size(), size_t(NOCELL));
+			for (size_t k = 0; k < owned_.size(); ++k)
+				local_[owned_[k]] = k;
+			for (size_t k = 0; k < recvList_.size(); ++k)
+				local_[recvList_[k]] = owned_.size() + k;
+			for (size_t k = 0; k < sendList_.size(); ++k)
+				sendList_[k] = local_[sendList_[k]];
+			sendBuf_.resize(sendList_.size()*DIM);
+			recvBuf_.resize(recvList_.size()*DIM);
+			requests_.resize(2*nbRank_.size());
+		}
+
+		template <typename MESH, typename T, int DIM>
+		template <typename BUFFER>
+		void Decomposition<MESH,T,DIM>::startExchange( const BUFFER& q ) {
+			const MPI_Datatype type = MPIType<T>::get();
+			for (size_t j = 0; j < nbRank_.size(); ++j) {
+				const size_t r0 = recvStart_[j], r1 = recvStart_[j+1];
+				MPI_Irecv(&recvBuf_[r0*DIM], int((r1-r0)*DIM), type, nbRank_[j], 0, comm_, &requests_[j]);
+			}
+			for (size_t j = 0; j < nbRank_.size(); ++j) {
+				const size_t s0 = sendStart_[j], s1 = sendStart_[j+1];
+				for (size_t k = s0; k < s1; ++k)
+					for (int i = 0; i < DIM; ++i)
+						sendBuf_[k*DIM+i] = q(sendList_[k], i);
+				MPI_Isend(&sendBuf_[s0*DIM], int((s1-s0)*DIM), type, nbRank_[j], 0, comm_, &requests_[nbRank_.size()+j]);
+			}
+		}
+
+		template <typename MESH, typename T, int DIM>
+		template <typename BUFFER>
+		void Decomposition<MESH,T,DIM>::finishExchange( BUFFER& q ) {
+			if ( !requests_.empty() )
+				MPI_Waitall(int(requests_.size()), &requests_[0], MPI_STATUSES_IGNORE);
+			const size_t first = owned_.size();
+			for (size_t k = 0; k < recvList_.size(); ++k)
+				for (int i = 0; i < DIM; ++i)
+					q(first+k, i) = recvBuf_[k*DIM+i];
+		}
+
+		template <typename MESH, typename T, int DIM>
+		template <typename BUFFER>
+		void Decomposition<MESH,T,DIM>::gather( const BUFFER& q, BUFFER& all, int root ) {
+			const MPI_Datatype type = MPIType<T>::get();
+			vector<T> mine(owned_.size()*DIM);
+			for (size_t k = 0; k < owned_.size(); ++k)
+				for (int i = 0; i < DIM; ++i)
+					mine[k*DIM+i] = q(k, i);
+			// Le celle di ogni processo si ricavano dalla partizione, nota a tutti
+			vector<int> counts(size_, 0), displs(size_, 0);
+			for (size_t c = 0; c < part_.size(); ++c)
+				counts[part_[c]] += DIM;
+			for (int r = 1; r < size_; ++r)
+				displs[r] = displs[r-1] + counts[r-1];
+			vector<T> recv( rank_ == root ? part_.size()*DIM : 1 );
+			MPI_Gatherv(mine.empty() ? 0 : &mine[0], int(mine.size()), type,
+				&recv[0], &counts[0], &displs[0], type, root, comm_);
+			if ( rank_ != root )
+				return;
+			all.resize(part_.size());
+			vector<int> next(displs);
+			for (size_t c = 0; c < part_.size(); ++c) {
+				for (int i = 0; i < DIM; ++i)
+					all(c, i) = recv[next[part_[c]]+i];
+				next[part_[c]] += DIM;
+			}
+		}
+	}
+}
+
+#endif
+
+#endif
@@ -0,0 +1,229 @@
+#ifndef _FINITEVOLUME_DELTAFRAMES_HPP
+#define _FINITEVOLUME_DELTAFRAMES_HPP
+
+// Frame incrementali: solo le celle cambiate dall'ultimo frame scritto, con frame completi periodici
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <iostream>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+namespace ConservationLaw2D {
+	namespace Solver {
+
+		using namespace std;
+
+		/*! \brief Intestazione di un frame incrementale (vedi DeltaFrameWriter) */
+		struct DeltaFrameHeader {
+			char magic[8];
+			// Frame, frame di riferimento (uguale a id per i frame completi), passo
+			uint64_t id, base, step;
+			// Celle, componenti per cella, celle scritte nel frame
+			uint64_t ncells, dim, count;
+			double time;
+		};
+
+		/*! \class DeltaFrameWriter
+			\brief Scrive i frame (variabili primitive per cella, numerazione originale) come differenze
+			rispetto all'ultimo frame scritto
+
+			Il writer tiene lo stato che un lettore ricostruisce dai frame gia' scritti: una cella viene
+			scritta (tutte le componenti) se almeno una componente se ne discosta piu' della tolleranza del
+			suo campo, e solo allora lo stato ricostruito viene aggiornato. L'errore del frame ricostruito
+			resta quindi entro la tolleranza, senza accumularsi da un frame all'altro. Ogni \c keyframe frame
+			(e al primo) si scrive un frame completo, da cui la ricostruzione riparte.
+
+			Un file \c deltaNNNN.bin contiene l'intestazione (DeltaFrameHeader, stringa \c "CL2DDIF"), poi
+			per un frame completo \c ncells*dim \c double, per un frame incrementale \c count indici di
+			cella (\c uint64_t) seguiti da \c count*dim \c double. */
+		class DeltaFrameWriter {
+			public:
+				DeltaFrameWriter():n_(0),dim_(0),keyframe_(0),frames_(0),last_(0) {}
+
+				/*! \brief Imposta dimensioni e tolleranze
+				\param[in] n Numero di celle
+				\param[in] dim Componenti per cella
+				\param[in] tol Tolleranza assoluta per componente (un solo valore: la stessa per tutte)
+				\param[in] keyframe Frame tra due frame completi (0: solo il primo) */
+				void setup( size_t n, size_t dim, const vector<double>& tol, size_t keyframe ) {
+					if ( tol.size() != 1 && tol.size() != dim ) {
+						std::cerr << "Error: delta frames need one tolerance or one per component!" << std::endl;
+						exit(1);
+					}
+					n_ = n;
+					dim_ = dim;
+					tol_.assign(dim, tol[0]);
+					if ( tol.size() == dim ) tol_ = tol;
+					keyframe_ = keyframe;
+					frames_ = 0;
+					ref_.assign(n*dim, 0.0);
+				}
+				/*! \brief Vero se il writer e' stato impostato */
+				bool active( void ) const { return dim_ > 0; }
+				/*! \brief Nome del file del frame id nella directory dir */
+				static string fileName( const string& dir, size_t id ) {
+					stringstream buffer;
+					buffer.fill('0');
+					buffer << dir << "/delta" << std::setw(4) << id << ".bin";
+					return buffer.str();
+				}
+				/*! \brief Scrive un frame
+				\param[in] dir Directory dei frame
+				\param[in] id Numero del frame
+				\param[in] w n*dim valori, celle contigue nella numerazione originale
+				\return Numero di celle scritte */
+				size_t write( const string& dir, size_t id, size_t step, double time, const double* w );
+
+			private:
+				size_t n_, dim_, keyframe_, frames_, last_;
+				vector<double> tol_;
+				// Stato ricostruito dai frame scritti e celle cambiate nel frame corrente
+				vector<double> ref_;
+				vector<uint64_t> cells_;
+				vector<double> values_;
+		};
+
+		/*! \class DeltaFrameReader
+			\brief Ricostruisce un frame qualsiasi scritto da DeltaFrameWriter: risale i riferimenti fino
+			al frame completo, poi applica in ordine le differenze */
+		class DeltaFrameReader {
+			public:
+				DeltaFrameReader():n_(0),dim_(0) {}
+
+				/*! \brief Legge il frame id dalla directory dir
+				\param[out] w ncells*dim valori, celle contigue nella numerazione originale
+				\param[out] step Passo del frame
+				\param[out] time Tempo del frame
+				\return Falso se un file della catena manca o non e' valido */
+				bool read( const string& dir, size_t id, vector<double>& w, size_t& step, double& time );
+				/*! \brief Numero di celle e componenti dell'ultimo frame letto */
+				size_t nCells( void ) const { return n_; }
+				size_t dim( void ) const { return dim_; }
+				/*! \brief Frame applicati nell'ultima lettura (dal frame completo) */
+				const vector<size_t>& chain( void ) const { return chain_; }
+				/*! \brief Celle scritte in ognuno dei frame applicati */
+				const vector<size_t>& counts( void ) const { return counts_; }
+
+				/*! \brief Legge l'intestazione di un frame */
+				static bool header( const string& filename, DeltaFrameHeader& h );
+
+			private:
+				size_t n_, dim_;
+				vector<size_t> chain_, counts_;
+		};
+
+		// ===========
+		// DEFINITIONS
+		// ===========
+
+		inline size_t DeltaFrameWriter::write( const string& dir, size_t id, size_t step, double time, const double* w ) {
+			const bool key = ( frames_ == 0 ) || ( keyframe_ > 0 && frames_ % keyframe_ == 0 );
+			cells_.clear();
+			values_.clear();
+			if ( key ) {
+				std::copy(w, w+n_*dim_, ref_.begin());
+			} else {
+				for (size_t c = 0; c < n_; ++c) {
+					const double* v = w + c*dim_;
+					double* r = &ref_[c*dim_];
+					size_t i = 0;
+					while ( i < dim_ && std::abs(v[i]-r[i]) <= tol_[i] ) ++i;
+					if ( i == dim_ )
+						continue;
+					cells_.push_back(c);
+					for (i = 0; i < dim_; ++i) {
+						r[i] = v[i];
+						values_.push_back(v[i]);
+					}
+				}
+			}
+			DeltaFrameHeader h;
+			std::memset(&h, 0, sizeof(h));
+			std::memcpy(h.magic, "CL2DDIF", 8);
+			h.id = id;
+			h.base = key ? id : last_;
+			h.step = step;
+			h.ncells = n_;
+			h.dim = dim_;
+			h.count = key ? n_ : cells_.size();
+			h.time = time;
+			std::ofstream out(fileName(dir, id).c_str(), std::ios::binary);
+			out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+			if ( key ) {
+				out.write(reinterpret_cast<const char*>(w), n_*dim_*sizeof(double));
+			} else if ( !cells_.empty() ) {
+				out.write(reinterpret_cast<const char*>(&cells_[0]), cells_.size()*sizeof(uint64_t));
+				out.write(reinterpret_cast<const char*>(&values_[0]), values_.size()*sizeof(double));
+			}
+			++frames_;
+			last_ = id;
+			return h.count;
+		}
+
+		inline bool DeltaFrameReader::header( const string& filename, DeltaFrameHeader& h ) {
+			std::ifstream in(filename.c_str(), std::ios::binary);
+			if ( !in.read(reinterpret_cast<char*>(&h), sizeof(h)) )
+				return false;
+			return std::strncmp(h.magic, "CL2DDIF", 8) == 0;
+		}
+
+		inline bool DeltaFrameReader::read( const string& dir, size_t id, vector<double>& w, size_t& step, double& time ) {
+			// Catena dei riferimenti fino al frame completo
+			DeltaFrameHeader h;
+			chain_.clear();
+			for (size_t k = id; ; ) {
+				if ( !header(DeltaFrameWriter::fileName(dir, k), h) )
+					return false;
+				if ( chain_.empty() ) {
+					step = h.step;
+					time = h.time;
+				}
+				chain_.push_back(k);
+				if ( h.base == k )
+					break;
+				if ( h.base > k )
+					return false;
+				k = h.base;
+			}
+			std::reverse(chain_.begin(), chain_.end());
+			counts_.clear();
+			// Frame completo e differenze in ordine
+			for (size_t j = 0; j < chain_.size(); ++j) {
+				std::ifstream in(DeltaFrameWriter::fileName(dir, chain_[j]).c_str(), std::ios::binary);
+				in.read(reinterpret_cast<char*>(&h), sizeof(h));
+				if ( j == 0 ) {
+					n_ = h.ncells;
+					dim_ = h.dim;
+					w.resize(n_*dim_);
+					in.read(reinterpret_cast<char*>(&w[0]), n_*dim_*sizeof(double));
+				} else {
+					if ( h.ncells != n_ || h.dim != dim_ )
+						return false;
+					vector<uint64_t> cells(h.count);
+					vector<double> values(h.count*dim_);
+					if ( h.count > 0 ) {
+						in.read(reinterpret_cast<char*>(&cells[0]), h.count*sizeof(uint64_t));
+						in.read(reinterpret_cast<char*>(&values[0]), values.size()*sizeof(double));
+					}
+					for (size_t c = 0; c < h.count; ++c) {
+						if ( cells[c] >= n_ )
+							return false;
+						std::copy(&values[c*dim_], &values[c*dim_]+dim_, &w[cells[c]*dim_]);
+					}
+				}
+				if ( !in )
+					return false;
+				counts_.push_back(h.count);
+			}
+			return true;
+		}
+	}
+}
+
+#endif
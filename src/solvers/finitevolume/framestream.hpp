@@ -0,0 +1,250 @@
+#ifndef _FINITEVOLUME_FRAMESTREAM_HPP
+#define _FINITEVOLUME_FRAMESTREAM_HPP
+
+// Flusso di frame nello stesso processo: il solutore avanza fino ai tempi richiesti e
+// l'analisi legge lo stato senza passare dai file
+
+#include <vector>
+#include <iterator>
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace ConservationLaw2D {
+	namespace Solver {
+
+		using namespace std;
+
+		template <typename MODEL, typename MESH, typename BUFFER>
+		/*! \class FrameView
+			\brief Vista in sola lettura dello stato del solutore, senza copie
+
+			Legge direttamente il buffer della soluzione (indici interni delle celle, come getSol()):
+			e' valida finche' il solutore non esegue un altro passo. */
+		class FrameView {
+			public:
+				/*! \brief Tipi del modello */
+				typedef MODEL							Model;
+				typedef MESH							Mesh;
+				typedef typename MODEL::real_t			real_t;
+				typedef typename MODEL::SolType			SolType;
+				enum { DIM = SolType::RowsAtCompileTime };
+
+				FrameView():model_(0),mesh_(0),q_(0),time_(0),step_(0),index_(0) {}
+				FrameView( const MODEL& model, const MESH& mesh, const BUFFER& q, real_t time, size_t step, size_t index = 0 ):
+					model_(&model),mesh_(&mesh),q_(&q),time_(time),step_(step),index_(index) {}
+
+				/*! \brief Tempo, passo e posizione nella lista dei tempi richiesti */
+				real_t time( void ) const { return time_; }
+				size_t step( void ) const { return step_; }
+				size_t index( void ) const { return index_; }
+				/*! \brief Numero di celle */
+				size_t nCells( void ) const { return q_->size(); }
+				/*! \brief Modello e mesh del solutore */
+				const MODEL& model( void ) const { return *model_; }
+				const MESH& mesh( void ) const { return *mesh_; }
+				/*! \brief Componente i (variabili conservate) della cella c */
+				real_t operator()( size_t c, int i ) const { return real_t((*q_)(c, i)); }
+				/*! \brief Variabili conservate della cella c */
+				SolType conserved( size_t c ) const { return (*q_)[c].template cast<real_t>(); }
+				/*! \brief Variabili primitive della cella c */
+				SolType primitive( size_t c ) const { return model_->ConservativeToPrimitive(conserved(c)); }
+
+			private:
+				const MODEL* model_;
+				const MESH* mesh_;
+				const BUFFER* q_;
+				real_t time_;
+				size_t step_, index_;
+		};
+
+		template <typename SOLVER>
+		/*! \class FrameStream
+			\brief Generatore di frame: a ogni richiesta il solutore avanza fino al tempo successivo
+			della lista (l'ultimo passo e' accorciato per arrivarci, vedi FiniteVolume::advanceTo())
+			e restituisce una vista dello stato (FrameView)
+
+			Si usa come intervallo (for (auto& f : solver.stream(times)) ...) oppure con next() e frame().
+			I tempi gia' superati restituiscono lo stato corrente. */
+		class FrameStream {
+			public:
+				/*! \brief Vista restituita a ogni tempo */
+				typedef typename SOLVER::View	View;
+
+				FrameStream( SOLVER& solver, const vector<double>& times ):solver_(solver),times_(times),next_(0) {}
+
+				/*! \brief Avanza al tempo successivo: falso se la lista e' finita */
+				bool next( void ) {
+					if ( next_ >= times_.size() )
+						return false;
+					solver_.advanceTo(times_[next_]);
+					view_ = solver_.view(next_);
+					++next_;
+					return true;
+				}
+				/*! \brief Vista dell'ultimo tempo raggiunto */
+				const View& frame( void ) const { return view_; }
+
+				/*! \brief Iteratore di input: l'incremento fa avanzare il solutore */
+				class iterator {
+					public:
+						typedef std::input_iterator_tag	iterator_category;
+						typedef View					value_type;
+						typedef ptrdiff_t				difference_type;
+						typedef const View*				pointer;
+						typedef const View&				reference;
+
+						explicit iterator( FrameStream* s = 0 ):s_(s) {}
+						const View& operator*( void ) const { return s_->frame(); }
+						const View* operator->( void ) const { return &s_->frame(); }
+						iterator& operator++( void ) {
+							if ( !s_->next() ) s_ = 0;
+							return *this;
+						}
+						bool operator==( const iterator& o ) const { return s_ == o.s_; }
+						bool operator!=( const iterator& o ) const { return s_ != o.s_; }
+					private:
+						FrameStream* s_;
+				};
+				/*! \brief Avanza al primo tempo */
+				iterator begin( void ) { return iterator( next() ? this : 0 ); }
+				iterator end( void ) { return iterator(); }
+
+			private:
+				SOLVER& solver_;
+				vector<double> times_;
+				size_t next_;
+				View view_;
+		};
+
+		template <typename VIEW>
+		/*! \class FrameSnapshot
+			\brief Copia dello stato di una FrameView (variabili conservate, celle contigue), con la
+			stessa interfaccia: resta valida mentre il solutore avanza */
+		class FrameSnapshot {
+			public:
+				typedef typename VIEW::Model		Model;
+				typedef typename VIEW::Mesh			Mesh;
+				typedef typename VIEW::real_t		real_t;
+				typedef typename VIEW::SolType		SolType;
+				enum { DIM = VIEW::DIM };
+
+				FrameSnapshot():model_(0),mesh_(0),time_(0),step_(0),index_(0) {}
+
+				/*! \brief Copia lo stato della vista */
+				void assign( const VIEW& v ) {
+					model_ = &v.model();
+					mesh_ = &v.mesh();
+					time_ = v.time();
+					step_ = v.step();
+					index_ = v.index();
+					data_.resize(v.nCells()*DIM);
+					for (size_t c = 0; c < v.nCells(); ++c)
+						for (int i = 0; i < DIM; ++i)
+							data_[c*DIM+i] = v(c, i);
+				}
+				real_t time( void ) const { return time_; }
+				size_t step( void ) const { return step_; }
+				size_t index( void ) const { return index_; }
+				size_t nCells( void ) const { return data_.size()/DIM; }
+				const Model& model( void ) const { return *model_; }
+				const Mesh& mesh( void ) const { return *mesh_; }
+				real_t operator()( size_t c, int i ) const { return data_[c*DIM+i]; }
+				SolType conserved( size_t c ) const {
+					SolType q;
+					for (int i = 0; i < DIM; ++i) q[i] = data_[c*DIM+i];
+					return q;
+				}
+				SolType primitive( size_t c ) const { return model_->ConservativeToPrimitive(conserved(c)); }
+
+			private:
+				const Model* model_;
+				const Mesh* mesh_;
+				real_t time_;
+				size_t step_, index_;
+				vector<real_t> data_;
+		};
+
+		template <typename VIEW>
+		/*! \class FrameAnalysis
+			\brief Analisi dei frame su un thread dedicato: submit() copia lo stato in uno degli
+			\c buffers snapshot liberi e ritorna subito, il thread chiama l'analisi sugli snapshot
+			nell'ordine di arrivo
+
+			Il solutore attende solo se tutti gli snapshot sono ancora da analizzare. L'analisi puo'
+			usare modello e mesh (costanti durante la simulazione) ma non il solutore. */
+		class FrameAnalysis {
+			public:
+				/*! \brief Copia dello stato passata all'analisi */
+				typedef FrameSnapshot<VIEW>							Snapshot;
+				typedef std::function<void( const Snapshot& )>		Callback;
+
+				FrameAnalysis( Callback analyse, size_t buffers = 2 ):analyse_(analyse),ring_(max(buffers, size_t(1))),
+					head_(0),tail_(0),waits_(0),stop_(false) {
+					thread_ = std::thread(&FrameAnalysis::worker, this);
+				}
+				~FrameAnalysis() { finish(); }
+
+				/*! \brief Copia lo stato della vista e lo accoda per l'analisi */
+				void submit( const VIEW& v ) {
+					std::unique_lock<std::mutex> lock(mutex_);
+					if ( head_ - tail_ == ring_.size() ) {
+						++waits_;
+						done_.wait(lock, [this]{ return head_ - tail_ < ring_.size(); });
+					}
+					// La posizione head_ non e' usata dal thread finche' head_ non avanza
+					lock.unlock();
+					ring_[head_ % ring_.size()].assign(v);
+					lock.lock();
+					++head_;
+					wake_.notify_one();
+				}
+				/*! \brief Attende l'analisi degli snapshot accodati e ferma il thread */
+				void finish( void ) {
+					if ( !thread_.joinable() )
+						return;
+					{
+						std::lock_guard<std::mutex> lock(mutex_);
+						stop_ = true;
+					}
+					wake_.notify_one();
+					thread_.join();
+				}
+				/*! \brief Numero di submit() che hanno atteso uno snapshot libero */
+				size_t waits( void ) const { return waits_; }
+
+			private:
+				FrameAnalysis( const FrameAnalysis& );
+				FrameAnalysis& operator=( const FrameAnalysis& );
+
+				void worker( void ) {
+					std::unique_lock<std::mutex> lock(mutex_);
+					for (;;) {
+						wake_.wait(lock, [this]{ return stop_ || tail_ < head_; });
+						if ( tail_ == head_ )
+							return;
+						const Snapshot& s = ring_[tail_ % ring_.size()];
+						lock.unlock();
+						analyse_(s);
+						lock.lock();
+						++tail_;
+						done_.notify_one();
+					}
+				}
+
+				Callback analyse_;
+				vector<Snapshot> ring_;
+				// Snapshot accodati e analizzati (contatori, lo snapshot s e' nella posizione s%buffers)
+				size_t head_, tail_, waits_;
+				bool stop_;
+				std::thread thread_;
+				std::mutex mutex_;
+				std::condition_variable wake_, done_;
+		};
+	}
+}
+
+#endif
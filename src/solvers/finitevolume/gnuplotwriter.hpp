@@ -0,0 +1,43 @@
+#ifndef _FINITEVOLUME_GNUPLOTWRITER_HPP
+#define _FINITEVOLUME_GNUPLOTWRITER_HPP
+
+// Formato dei frame non interpolati per gnuplot (splot con pm3d), comune ai solutori
+
+#include <ostream>
+#include <sstream>
+#include <vector>
+
+namespace ConservationLaw2D {
+	namespace Solver {
+
+		using namespace std;
+
+		/*! \brief Scrive i vertici di un triangolo con lo stato w della cella: righe "x y valori",
+		con le righe vuote che gnuplot usa per chiudere la superficie del triangolo
+		\param[in] p Poligono (triangolo)
+		\param[in] w Stato della cella
+		\param[in] fields Se dato e non vuoto, solo queste componenti di w */
+		template <typename POLYGON, typename SOLTYPE>
+		void writeTriangle( std::ostream& filehandle, POLYGON* p, const SOLTYPE& w, const vector<int>* fields = 0 ) {
+			stringstream strsol;
+			if ( fields && !fields->empty() )
+				for (size_t i=0; i<fields->size(); ++i)
+					strsol << w[(*fields)[i]] << " ";
+			else
+				for (int i=0; i<w.rows(); ++i)
+					strsol << w[i] << " ";
+			typename POLYGON::VertexCirculator vc = p->beginV();
+			// Vertice 1
+			filehandle << vc->x() << " " << vc->y() << " " << strsol.str() << endl;
+			vc++;
+			// Vertice 2
+			filehandle << vc->x() << " " << vc->y() << " " << strsol.str() << endl << endl;
+			vc++;
+			// Vertice 3
+			filehandle << vc->x() << " " << vc->y() << " " << strsol.str() << endl;
+			filehandle << vc->x() << " " << vc->y() << " " << strsol.str() << endl << endl << endl;
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,150 @@
+#ifndef _FINITEVOLUME_HISTORY_HPP
+#define _FINITEVOLUME_HISTORY_HPP
+
+// Storia in memoria degli ultimi stati, scritta su file solo attorno agli eventi
+
+#include <vector>
+#include <string>
+#include <algorithm>
+
+namespace ConservationLaw2D {
+	namespace Solver {
+
+		using namespace std;
+
+		/*! \class History
+			\brief Anello delle ultime \c capacity istantanee compatte della soluzione (in \c float) e stato
+			degli eventi che ne chiedono la scrittura
+
+			Un evento (trigger()) arma la scrittura: dopo altre \c post istantanee l'anello contiene la
+			finestra attorno all'evento (capacity-post istantanee fino all'evento, post dopo) e due()
+			diventa vero; chi scrive la finestra chiama poi flushed(). Gli eventi che arrivano mentre una
+			scrittura e' armata finiscono nella stessa finestra.
+
+			La classe tiene anche la media mobile del residuo per riconoscerne i picchi (spike()). */
+		class History {
+			public:
+				History():n_(0),dim_(0),capacity_(0),post_(0),every_(1),count_(0),pending_(false),remaining_(0),
+					events_(0),factor_(0),window_(0),rcount_(0) {}
+
+				/*! \brief Imposta le dimensioni dell'anello
+				\param[in] n Numero di celle
+				\param[in] dim Componenti per cella
+				\param[in] capacity Istantanee nell'anello (finestra scritta a ogni evento)
+				\param[in] post Istantanee dopo l'evento nella finestra (minore di capacity)
+				\param[in] every Passi tra due istantanee */
+				void setup( size_t n, size_t dim, size_t capacity, size_t post, size_t every ) {
+					n_ = n;
+					dim_ = dim;
+					capacity_ = capacity;
+					post_ = ( capacity > 0 ) ? min(post, capacity-1) : 0;
+					every_ = max(every, size_t(1));
+					data_.assign(capacity*n*dim, 0.0f);
+					step_.assign(capacity, 0);
+					time_.assign(capacity, 0.0);
+					count_ = 0;
+					pending_ = false;
+					events_ = 0;
+					rcount_ = 0;
+				}
+				/*! \brief Vero se l'anello e' stato impostato */
+				bool active( void ) const { return capacity_ > 0; }
+				/*! \brief Passi tra due istantanee */
+				size_t every( void ) const { return every_; }
+
+				/*! \brief Posizione della prossima istantanea (sovrascrive la piu' vecchia): va riempita con
+				n*dim valori, celle contigue */
+				float* push( size_t step, double time ) {
+					const size_t k = count_++ % capacity_;
+					step_[k] = step;
+					time_[k] = time;
+					if ( pending_ && remaining_ > 0 ) --remaining_;
+					return &data_[k*n_*dim_];
+				}
+				/*! \brief Ultima istantanea (0 se non ce ne sono) */
+				const float* last( void ) const { return count_ ? &data_[((count_-1) % capacity_)*n_*dim_] : 0; }
+				/*! \brief Passo e tempo dell'ultima istantanea */
+				size_t lastStep( void ) const { return step_[(count_-1) % capacity_]; }
+				double lastTime( void ) const { return time_[(count_-1) % capacity_]; }
+				/*! \brief Numero di istantanee nell'anello */
+				size_t size( void ) const { return min(count_, capacity_); }
+				/*! \brief k-esima istantanea dalla piu' vecchia */
+				const float* data( size_t k ) const { return &data_[slot(k)*n_*dim_]; }
+				/*! \brief Passo della k-esima istantanea dalla piu' vecchia */
+				size_t step( size_t k ) const { return step_[slot(k)]; }
+				/*! \brief Tempo della k-esima istantanea dalla piu' vecchia */
+				double time( size_t k ) const { return time_[slot(k)]; }
+
+				/*! \brief Segnala un evento all'ultima istantanea */
+				void trigger( const string& reason ) {
+					if ( pending_ ) {
+						reason_ += ", " + reason;
+						return;
+					}
+					pending_ = true;
+					remaining_ = post_;
+					reason_ = reason;
+					eventStep_ = lastStep();
+					eventTime_ = lastTime();
+				}
+				/*! \brief Vero se la finestra dell'evento e' completa e va scritta */
+				bool due( void ) const { return pending_ && remaining_ == 0; }
+				/*! \brief Vero se un evento attende la scrittura della finestra */
+				bool pending( void ) const { return pending_; }
+				/*! \brief Motivi, passo e tempo dell'evento in attesa */
+				const string& reason( void ) const { return reason_; }
+				size_t eventStep( void ) const { return eventStep_; }
+				double eventTime( void ) const { return eventTime_; }
+				/*! \brief La finestra e' stata scritta: l'anello torna in attesa di eventi */
+				void flushed( void ) { pending_ = false; ++events_; }
+				/*! \brief Numero di finestre scritte */
+				size_t events( void ) const { return events_; }
+
+				/*! \brief Imposta il riconoscimento dei picchi del residuo
+				\param[in] factor Rapporto con la media dei residui precedenti oltre il quale c'e' un picco
+				\param[in] window Numero di residui nella media */
+				void setSpike( double factor, size_t window ) {
+					factor_ = factor;
+					window_ = max(window, size_t(1));
+					residual_.assign(window_, 0.0);
+					rcount_ = 0;
+				}
+				/*! \brief Vero se il riconoscimento dei picchi e' attivo */
+				bool spikeActive( void ) const { return factor_ > 0; }
+				/*! \brief Aggiunge un residuo alla media mobile: vero se supera \c factor volte la media dei
+				\c window precedenti (solo con la media gia' piena) */
+				bool spike( double r ) {
+					bool peak = false;
+					if ( rcount_ >= window_ ) {
+						double mean = 0;
+						for (size_t i = 0; i < window_; ++i) mean += residual_[i];
+						peak = ( r > factor_ * mean / window_ );
+					}
+					residual_[rcount_++ % window_] = r;
+					return peak;
+				}
+
+			private:
+				size_t slot( size_t k ) const { return ( count_ > capacity_ ? count_ - capacity_ + k : k ) % capacity_; }
+
+				size_t n_, dim_, capacity_, post_, every_;
+				// Istantanee: celle contigue, passo e tempo
+				vector<float> data_;
+				vector<size_t> step_;
+				vector<double> time_;
+				// Istantanee inserite (l'ultima e' nella posizione (count_-1)%capacity_)
+				size_t count_;
+				// Evento in attesa: istantanee mancanti alla fine della finestra
+				bool pending_;
+				size_t remaining_, events_, eventStep_;
+				double eventTime_;
+				string reason_;
+				// Media mobile del residuo
+				double factor_;
+				size_t window_, rcount_;
+				vector<double> residual_;
+		};
+	}
+}
+
+#endif
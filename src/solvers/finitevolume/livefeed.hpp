@@ -0,0 +1,281 @@
+#ifndef _FINITEVOLUME_LIVEFEED_HPP
+#define _FINITEVOLUME_LIVEFEED_HPP
+
+// Pubblicazione dello stato corrente in memoria condivisa POSIX, per visualizzatori esterni
+
+#include <vector>
+#include <string>
+#include <atomic>
+#include <cstring>
+#include <cstdint>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+// Disposizione della soluzione
+#include <solvers/finitevolume/solutionbuffer.hpp>
+
+namespace ConservationLaw2D {
+	namespace Solver {
+
+		using namespace std;
+
+		static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "the live feed needs lock-free 64 bit atomics");
+
+		/*! \brief Intestazione del segmento condiviso (vedi LiveFeed) */
+		struct LiveFeedHeader {
+			char magic[8];
+			uint32_t version;
+			// Dimensione dello stato, byte per componente (4 o 8), disposizione (Solver::Layout)
+			uint32_t dim, scalar, layout;
+			uint64_t ncells, slots, slotBytes;
+			// Ultima pubblicazione completa (0 nessuna) e fine della simulazione
+			std::atomic<uint64_t> latest;
+			std::atomic<uint64_t> finished;
+		};
+
+		/*! \brief Intestazione di uno slot: seq dispari durante la scrittura */
+		struct LiveFeedSlot {
+			std::atomic<uint64_t> seq;
+			uint64_t generation, step;
+			double time, dt;
+		};
+
+		/*! \class LiveFeed
+			\brief Stato corrente del solutore in un segmento di memoria condivisa POSIX (un solo scrittore,
+			piu' lettori in altri processi)
+
+			Il segmento contiene un'intestazione, i baricentri delle celle nell'ordine del solutore e un
+			anello di \c slots copie dello stato, cosi' come e' memorizzato (variabili conservate, tipo e
+			disposizione del buffer del solutore). Ogni pubblicazione scrive lo slot successivo con un
+			seqlock: seq dispari durante la copia, pari alla fine, poi \c latest indica la generazione.
+			Lo scrittore non attende mai i lettori: un lettore copia lo slot di \c latest e lo scarta se
+			seq e' cambiato nel frattempo (vedi LiveFeedReader). Il costo per il solutore e' una copia del
+			buffer per pubblicazione, senza I/O. */
+		class LiveFeed {
+			public:
+				LiveFeed():base_(0),bytes_(0),generation_(0) {}
+				~LiveFeed() { close(); }
+
+				/*! \brief Crea il segmento (sostituisce un segmento con lo stesso nome)
+				\param[in] name Nome del segmento (es. "/sodproblem", il primo '/' e' aggiunto se manca)
+				\param[in] ncells Numero di celle
+				\param[in] dim Componenti per cella
+				\param[in] scalar Byte per componente
+				\param[in] layout Disposizione del buffer (Solver::AoS o Solver::SoA)
+				\param[in] slots Copie dello stato nell'anello
+				\return Falso se il segmento non puo' essere creato */
+				bool open( const string& name, size_t ncells, size_t dim, size_t scalar, int layout, size_t slots = 3 );
+				/*! \brief Imposta il baricentro della cella i */
+				void setCentroid( size_t i, double x, double y ) {
+					centroids()[2*i] = x;
+					centroids()[2*i+1] = y;
+				}
+				/*! \brief Pubblica lo stato (ncells*dim componenti nella disposizione indicata a open()) */
+				void publish( size_t step, double time, double dt, const void* data );
+				/*! \brief Segnala ai lettori la fine della simulazione e rimuove il nome del segmento
+				(i lettori gia' collegati continuano a leggere l'ultimo stato) */
+				void close( void );
+				/*! \brief Vero se il segmento e' aperto */
+				bool active( void ) const { return base_ != 0; }
+				/*! \brief Numero di pubblicazioni */
+				uint64_t published( void ) const { return generation_; }
+
+				/*! \brief Nome POSIX (con il '/' iniziale) */
+				static string shmName( const string& name ) { return ( !name.empty() && name[0] == '/' ) ? name : "/" + name; }
+				/*! \brief Byte dell'intestazione (allineati a 64) */
+				static size_t headerBytes( void ) { return align(sizeof(LiveFeedHeader)); }
+				/*! \brief Byte dell'intestazione di uno slot (allineati a 64) */
+				static size_t slotHeaderBytes( void ) { return align(sizeof(LiveFeedSlot)); }
+				/*! \brief Allinea a 64 byte (una linea di cache) */
+				static size_t align( size_t n ) { return (n + 63) & ~size_t(63); }
+
+			private:
+				LiveFeed( const LiveFeed& );
+				LiveFeed& operator=( const LiveFeed& );
+				LiveFeedHeader* header( void ) { return reinterpret_cast<LiveFeedHeader*>(base_); }
+				double* centroids( void ) { return reinterpret_cast<double*>(base_ + headerBytes()); }
+				char* slot( size_t k ) { return base_ + offset_ + k*header()->slotBytes; }
+
+				char* base_;
+				size_t bytes_, offset_, dataBytes_;
+				string name_;
+				uint64_t generation_;
+		};
+
+		/*! \class LiveFeedReader
+			\brief Lettore di un segmento scritto da LiveFeed (anche da un altro processo) */
+		class LiveFeedReader {
+			public:
+				LiveFeedReader():base_(0),bytes_(0) {}
+				~LiveFeedReader() { close(); }
+
+				/*! \brief Collega il segmento in sola lettura (falso se non esiste o non e' valido) */
+				bool open( const string& name );
+				/*! \brief Scollega il segmento */
+				void close( void );
+				/*! \brief Numero di celle */
+				size_t nCells( void ) const { return header()->ncells; }
+				/*! \brief Componenti per cella */
+				size_t dim( void ) const { return header()->dim; }
+				/*! \brief Baricentro della cella i */
+				double cx( size_t i ) const { return centroids()[2*i]; }
+				double cy( size_t i ) const { return centroids()[2*i+1]; }
+				/*! \brief Generazione dell'ultima pubblicazione completa (0 nessuna) */
+				uint64_t latest( void ) const { return header()->latest.load(std::memory_order_acquire); }
+				/*! \brief Vero se lo scrittore ha terminato */
+				bool finished( void ) const { return header()->finished.load(std::memory_order_acquire) != 0; }
+				/*! \brief Copia l'ultimo stato pubblicato se piu' recente della generazione \c after
+				\param[out] q Stato delle celle in doppia precisione, componenti di una cella contigue
+				\return Falso se non ci sono pubblicazioni piu' recenti o se lo scrittore ha sovrascritto
+				lo slot durante tutti i tentativi */
+				bool read( vector<double>& q, uint64_t& generation, uint64_t& step, double& time, double& dt, uint64_t after = 0 );
+
+			private:
+				LiveFeedReader( const LiveFeedReader& );
+				LiveFeedReader& operator=( const LiveFeedReader& );
+				const LiveFeedHeader* header( void ) const { return reinterpret_cast<const LiveFeedHeader*>(base_); }
+				const double* centroids( void ) const { return reinterpret_cast<const double*>(base_ + LiveFeed::headerBytes()); }
+
+				const char* base_;
+				size_t bytes_, offset_;
+				vector<char> raw_;
+		};
+
+		// ===========
+		// DEFINITIONS
+		// ===========
+
+		inline bool LiveFeed::open( const string& name, size_t ncells, size_t dim, size_t scalar, int layout, size_t slots ) {
+			close();
+			name_ = shmName(name);
+			slots = max(slots, size_t(2));
+			dataBytes_ = ncells*dim*scalar;
+			offset_ = headerBytes() + align(2*ncells*sizeof(double));
+			const size_t slotBytes = slotHeaderBytes() + align(dataBytes_);
+			bytes_ = offset_ + slots*slotBytes;
+			// Un segmento rimasto da una simulazione precedente viene sostituito
+			shm_unlink(name_.c_str());
+			const int fd = shm_open(name_.c_str(), O_CREAT | O_RDWR, 0644);
+			if ( fd < 0 ) return false;
+			if ( ftruncate(fd, bytes_) != 0 ) {
+				::close(fd);
+				shm_unlink(name_.c_str());
+				return false;
+			}
+			void* p = mmap(0, bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			::close(fd);
+			if ( p == MAP_FAILED ) {
+				shm_unlink(name_.c_str());
+				return false;
+			}
+			base_ = static_cast<char*>(p);
+			// Il segmento nuovo e' azzerato: seq = 0, latest = 0
+			LiveFeedHeader* h = header();
+			h->version = 1;
+			h->dim = dim;
+			h->scalar = scalar;
+			h->layout = layout;
+			h->ncells = ncells;
+			h->slots = slots;
+			h->slotBytes = slotBytes;
+			generation_ = 0;
+			// Il lettore riconosce il segmento solo quando l'intestazione e' completa
+			std::atomic_thread_fence(std::memory_order_release);
+			memcpy(h->magic, "CL2DFEED", 8);
+			return true;
+		}
+
+		inline void LiveFeed::publish( size_t step, double time, double dt, const void* data ) {
+			if ( !base_ ) return;
+			const uint64_t g = ++generation_;
+			LiveFeedSlot* s = reinterpret_cast<LiveFeedSlot*>(slot(g % header()->slots));
+			// Seqlock: dispari durante la scrittura, 2g alla fine
+			s->seq.store(2*g-1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			s->generation = g;
+			s->step = step;
+			s->time = time;
+			s->dt = dt;
+			memcpy(reinterpret_cast<char*>(s) + slotHeaderBytes(), data, dataBytes_);
+			s->seq.store(2*g, std::memory_order_release);
+			header()->latest.store(g, std::memory_order_release);
+		}
+
+		inline void LiveFeed::close( void ) {
+			if ( !base_ ) return;
+			header()->finished.store(1, std::memory_order_release);
+			munmap(base_, bytes_);
+			shm_unlink(name_.c_str());
+			base_ = 0;
+		}
+
+		inline bool LiveFeedReader::open( const string& name ) {
+			close();
+			const int fd = shm_open(LiveFeed::shmName(name).c_str(), O_RDONLY, 0);
+			if ( fd < 0 ) return false;
+			struct stat st;
+			if ( fstat(fd, &st) != 0 || size_t(st.st_size) < LiveFeed::headerBytes() ) {
+				::close(fd);
+				return false;
+			}
+			bytes_ = st.st_size;
+			void* p = mmap(0, bytes_, PROT_READ, MAP_SHARED, fd, 0);
+			::close(fd);
+			if ( p == MAP_FAILED ) return false;
+			base_ = static_cast<const char*>(p);
+			const LiveFeedHeader* h = header();
+			if ( memcmp(h->magic, "CL2DFEED", 8) != 0 || h->version != 1 || (h->scalar != 4 && h->scalar != 8) ) {
+				close();
+				return false;
+			}
+			std::atomic_thread_fence(std::memory_order_acquire);
+			offset_ = LiveFeed::headerBytes() + LiveFeed::align(2*h->ncells*sizeof(double));
+			if ( offset_ + h->slots*h->slotBytes > bytes_ ) {
+				close();
+				return false;
+			}
+			return true;
+		}
+
+		inline void LiveFeedReader::close( void ) {
+			if ( !base_ ) return;
+			munmap(const_cast<char*>(base_), bytes_);
+			base_ = 0;
+		}
+
+		inline bool LiveFeedReader::read( vector<double>& q, uint64_t& generation, uint64_t& step, double& time, double& dt, uint64_t after ) {
+			const LiveFeedHeader* h = header();
+			const size_t n = h->ncells, d = h->dim, bytes = n*d*h->scalar;
+			raw_.resize(bytes);
+			for (int attempt = 0; attempt < 16; ++attempt) {
+				const uint64_t g = h->latest.load(std::memory_order_acquire);
+				if ( g == 0 || g <= after ) return false;
+				const LiveFeedSlot* s = reinterpret_cast<const LiveFeedSlot*>(base_ + offset_ + (g % h->slots)*h->slotBytes);
+				const uint64_t s1 = s->seq.load(std::memory_order_acquire);
+				// Slot gia' riscritto da una generazione successiva o in scrittura: riprovo con la nuova latest
+				if ( s1 != 2*g ) continue;
+				generation = s->generation;
+				step = s->step;
+				time = s->time;
+				dt = s->dt;
+				if ( bytes ) memcpy(&raw_[0], reinterpret_cast<const char*>(s) + LiveFeed::slotHeaderBytes(), bytes);
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if ( s->seq.load(std::memory_order_relaxed) != s1 ) continue;
+				// Copia coerente: conversione in doppia precisione, celle contigue
+				q.resize(n*d);
+				for (size_t c = 0; c < n; ++c)
+					for (size_t i = 0; i < d; ++i) {
+						const size_t k = ( h->layout == AoS ) ? c*d + i : i*n + c;
+						q[c*d+i] = ( h->scalar == 8 ) ? reinterpret_cast<const double*>(&raw_[0])[k]
+							: double(reinterpret_cast<const float*>(&raw_[0])[k]);
+					}
+				return true;
+			}
+			return false;
+		}
+	}
+}
+
+#endif
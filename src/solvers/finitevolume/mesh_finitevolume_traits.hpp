@@ -11,7 +11,7 @@
 
 namespace ConservationLaw2D {
 	namespace Mesh {
-		template <typename T, typename SOLTYPE>
+		template <typename T>
 		/*! \struct DefaultTraits
 			\brief In questa struttura vengono definiti le classi vere e proprie per la Mesh
 		*/
@@ -57,7 +57,6 @@ namespace ConservationLaw2D {
 			*/
 			class Polygon : public BasePolygon<Kernel> {
 				public:
-					EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 					/*! \brief Restituisce l'area del poligono */
 					inline T area() { return area_; }
 					/*! \brief Restituisce il diametro dell'elemento */
@@ -74,10 +73,6 @@ namespace ConservationLaw2D {
 						cx_ = BasePolygon<Kernel>::cx();
 						cy_ = BasePolygon<Kernel>::cy();
 					}
-					/*! \brief Soluzione corrente nel poligono */
-					SOLTYPE sol;
-					/*! \brief Soluzione al passo precedente nel poligono */
-					SOLTYPE sol0;
 				private:
 					T area_, diam_, cx_, cy_;
 			};
@@ -0,0 +1,348 @@
+#ifndef _FINITEVOLUME_MONITOR_HPP
+#define _FINITEVOLUME_MONITOR_HPP
+
+// Sonde puntuali e linee di campionamento per il solutore a volumi finiti
+
+#include <mesh/search/pointlocator.hpp>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <cstdlib>
+#include <stdint.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace ConservationLaw2D {
+	namespace Solver {
+
+		using namespace std;
+
+		template <typename MESH, typename T, int DIM>
+		/*! \class Monitor
+			\brief Sonde puntuali e linee di campionamento (line-out) con scrittura asincrona
+
+			Le sonde vengono risolte una sola volta (resolve()) in una lista di celle e pesi:
+			la cella che contiene il punto e i suoi vicini, con i pesi della ricostruzione lineare
+			ai minimi quadrati sui baricentri (esatta per campi lineari). Per i punti fuori dalla mesh
+			si usa il valore della cella piu' vicina.
+
+			I campioni (passo, tempo e \c DIM valori per punto) vengono copiati in un buffer circolare
+			di \c capacity record; un thread dedicato li scrive su file (CSV o binario) quando il buffer
+			e' pieno a meta' o su richiesta (flush()). Se il buffer e' pieno push() attende il thread di scrittura.
+
+			Formato binario: la stringa \c "CL2DMON" (8 byte), numero di punti e \c DIM (\c uint64_t),
+			le coordinate dei punti (\c double, x e y alternate) e poi i record, ognuno di
+			\c 2+npoints*DIM \c double: passo, tempo, valori punto per punto. */
+		class Monitor {
+			public:
+				/*! \brief Tipo di dato reale dei campioni */
+				typedef T	real_t;
+
+				Monitor():every_(0),capacity_(0),binary_(false),resolved_(false),head_(0),tail_(0),
+					flushReq_(false),stop_(false) {}
+				~Monitor() { close(); }
+
+				/*! \brief Aggiunge una sonda nel punto (x,y)
+				\warning Va chiamato prima di resolve() */
+				void addProbe( real_t x, real_t y ) { px_.push_back(x); py_.push_back(y); }
+				/*! \brief Aggiunge una linea spezzata campionata con n punti equispaziati lungo la lunghezza
+				(estremi compresi)
+				\param[in] vx Ascisse dei vertici della spezzata
+				\param[in] vy Ordinate dei vertici della spezzata
+				\param[in] n Numero di punti di campionamento
+				\warning Va chiamato prima di resolve() */
+				void addPolyline( const vector<real_t>& vx, const vector<real_t>& vy, size_t n );
+
+				/*! \brief Apre il file e avvia il thread di scrittura
+				\param[in] filename Nome del file
+				\param[in] every Registra un campione ogni \c every passi
+				\param[in] binary Formato binario invece di CSV
+				\param[in] capacity Numero di record nel buffer circolare */
+				void open( const string& filename, size_t every = 1, bool binary = false, size_t capacity = 1024 );
+				/*! \brief Scrive i record rimasti nel buffer, chiude il file e ferma il thread di scrittura */
+				void close( void );
+				/*! \brief Vero se il file e' aperto */
+				bool active( void ) const { return every_ > 0; }
+				/*! \brief Numero di passi tra due campioni */
+				size_t every( void ) const { return every_; }
+
+				/*! \brief Localizza i punti sulla mesh e calcola i pesi di interpolazione
+				\warning La geometria della mesh deve essere gia' calcolata (init_geom()) */
+				void resolve( MESH& mesh );
+				/*! \brief Numero di punti (sonde e punti delle linee) */
+				size_t nPoints( void ) const { return px_.size(); }
+				/*! \brief Prima posizione nelle liste di celle e pesi del punto i */
+				size_t begin( size_t i ) const { return start_[i]; }
+				/*! \brief Posizione successiva all'ultima nelle liste di celle e pesi del punto i */
+				size_t end( size_t i ) const { return start_[i+1]; }
+				/*! \brief k-esima cella delle liste */
+				size_t cell( size_t k ) const { return cell_[k]; }
+				/*! \brief k-esimo peso delle liste */
+				real_t weight( size_t k ) const { return weight_[k]; }
+
+				/*! \brief Copia un campione nel buffer circolare
+				\param[in] step Passo temporale
+				\param[in] time Tempo
+				\param[in] values nPoints()*DIM valori, punto per punto */
+				void push( size_t step, real_t time, const real_t* values );
+				/*! \brief Attende che tutti i record nel buffer siano scritti su file */
+				void flush( void );
+
+			private:
+				Monitor( const Monitor& );
+				Monitor& operator=( const Monitor& );
+				// Corpo del thread di scrittura
+				void writer( void );
+				// Scrive l'intestazione del file
+				void header( void );
+				// Scrive il record nella posizione data del buffer
+				void write( size_t slot );
+				// Dimensione di un record
+				size_t recordSize( void ) const { return 2 + px_.size()*DIM; }
+
+				// Punti
+				vector<real_t>	px_, py_;
+				// Celle e pesi di interpolazione (CSR, un intervallo per punto)
+				vector<size_t>	start_, cell_;
+				vector<real_t>	weight_;
+				// File e buffer circolare
+				string			filename_;
+				ofstream		out_;
+				size_t			every_, capacity_;
+				bool			binary_, resolved_;
+				vector<double>	ring_;
+				// Record inseriti e scritti (contatori, il record r e' nella posizione r%capacity_)
+				size_t			head_, tail_;
+				bool			flushReq_, stop_;
+				thread			thread_;
+				mutex			mutex_;
+				condition_variable	wake_, done_;
+		};
+
+		// ===========
+		// DEFINITIONS
+		// ===========
+
+		template <typename MESH, typename T, int DIM>
+		void Monitor<MESH,T,DIM>::addPolyline( const vector<real_t>& vx, const vector<real_t>& vy, size_t n ) {
+			if ( vx.size() != vy.size() || vx.empty() || n == 0 ) {
+				std::cerr << "Error: bad polyline for the monitor!" << std::endl;
+				exit(1);
+			}
+			// Lunghezze cumulate dei tratti
+			vector<real_t> s(vx.size(), 0);
+			for (size_t k = 1; k < vx.size(); ++k)
+				s[k] = s[k-1] + sqrt( (vx[k]-vx[k-1])*(vx[k]-vx[k-1]) + (vy[k]-vy[k-1])*(vy[k]-vy[k-1]) );
+			size_t k = 0;
+			for (size_t i = 0; i < n; ++i) {
+				const real_t si = ( n == 1 ) ? 0 : s.back()*real_t(i)/(n-1);
+				while ( k+2 < vx.size() && s[k+1] < si ) ++k;
+				if ( vx.size() == 1 || s[k+1] <= s[k] ) {
+					addProbe(vx[k], vy[k]);
+					continue;
+				}
+				const real_t f = min( real_t(1), (si-s[k])/(s[k+1]-s[k]) );
+				addProbe( vx[k] + f*(vx[k+1]-vx[k]), vy[k] + f*(vy[k+1]-vy[k]) );
+			}
+		}
+
+		template <typename MESH, typename T, int DIM>
+		void Monitor<MESH,T,DIM>::resolve( MESH& mesh ) {
+			typedef typename MESH::polygon_ptr polygon_ptr;
+			typedef typename MESH::Polygon::HEdgeCirculator he_cit;
+			typedef typename MESH::real_t mreal_t;
+			// Celle contenenti i punti (la piu' vicina per i punti fuori dalla mesh)
+			Mesh::PointLocator<MESH> locator(mesh);
+			vector<mreal_t> x(px_.begin(), px_.end()), y(py_.begin(), py_.end());
+			vector<size_t> ids;
+			locator.locate(x, y, ids, true);
+			start_.assign(1, 0);
+			cell_.clear();
+			weight_.clear();
+			for (size_t i = 0; i < ids.size(); ++i) {
+				polygon_ptr p = mesh.p(ids[i]);
+				const real_t xc = p->cx(), yc = p->cy();
+				const real_t rx = px_[i]-xc, ry = py_[i]-yc;
+				// Vicini e matrice dei minimi quadrati G = sum d d^T, con d = baricentro vicino - baricentro
+				vector<size_t> nb;
+				vector<real_t> dx, dy;
+				real_t gxx(0), gxy(0), gyy(0);
+				he_cit e = p->beginE();
+				do {
+					if ( !e->isBoundary() ) {
+						nb.push_back(e->polygonR().getId());
+						dx.push_back(e->polygonR().cx()-xc);
+						dy.push_back(e->polygonR().cy()-yc);
+						gxx += dx.back()*dx.back();
+						gxy += dx.back()*dy.back();
+						gyy += dy.back()*dy.back();
+					}
+					++e;
+				} while ( e != p->beginE() );
+				// Gradiente = G^{-1} sum d (q_k - q_c): il valore nel punto e' lineare nei q_k
+				const real_t det = gxx*gyy - gxy*gxy;
+				const bool inside = locator.contains(ids[i], x[i], y[i]);
+				cell_.push_back(ids[i]);
+				weight_.push_back(1);
+				if ( inside && nb.size() >= 2 && det > 1e-12*(gxx+gyy)*(gxx+gyy) ) {
+					// a = G^{-1} r
+					const real_t ax = ( gyy*rx - gxy*ry)/det;
+					const real_t ay = (-gxy*rx + gxx*ry)/det;
+					for (size_t k = 0; k < nb.size(); ++k) {
+						const real_t w = ax*dx[k] + ay*dy[k];
+						cell_.push_back(nb[k]);
+						weight_.push_back(w);
+						weight_[start_.back()] -= w;
+					}
+				}
+				start_.push_back(cell_.size());
+			}
+			resolved_ = true;
+		}
+
+		template <typename MESH, typename T, int DIM>
+		void Monitor<MESH,T,DIM>::open( const string& filename, size_t every, bool binary, size_t capacity ) {
+			close();
+			filename_ = filename;
+			every_ = max(every, size_t(1));
+			binary_ = binary;
+			capacity_ = max(capacity, size_t(2));
+			head_ = tail_ = 0;
+			flushReq_ = stop_ = false;
+			out_.open(filename.c_str(), binary ? ios::out | ios::binary : ios::out);
+			if ( !out_ ) {
+				std::cerr << "Error: cannot open monitor file " << filename << std::endl;
+				exit(1);
+			}
+			// L'intestazione e il buffer richiedono il numero di punti: vengono preparati al primo push()
+			ring_.clear();
+			thread_ = thread(&Monitor::writer, this);
+		}
+
+		template <typename MESH, typename T, int DIM>
+		void Monitor<MESH,T,DIM>::close( void ) {
+			if ( !thread_.joinable() )
+				return;
+			{
+				lock_guard<mutex> lock(mutex_);
+				stop_ = true;
+			}
+			wake_.notify_one();
+			thread_.join();
+			out_.close();
+			every_ = 0;
+		}
+
+		template <typename MESH, typename T, int DIM>
+		void Monitor<MESH,T,DIM>::push( size_t step, real_t time, const real_t* values ) {
+			if ( !active() )
+				return;
+			if ( !resolved_ ) {
+				std::cerr << "Error: monitor points not resolved!" << std::endl;
+				exit(1);
+			}
+			const size_t rs = recordSize();
+			unique_lock<mutex> lock(mutex_);
+			if ( ring_.empty() ) {
+				header();
+				ring_.resize(capacity_*rs);
+			}
+			// Buffer pieno: attendo il thread di scrittura
+			while ( head_ - tail_ == capacity_ ) {
+				flushReq_ = true;
+				wake_.notify_one();
+				done_.wait(lock);
+			}
+			// La posizione head_ non e' letta dal thread di scrittura: copio senza il lock
+			lock.unlock();
+			double* r = &ring_[(head_ % capacity_)*rs];
+			r[0] = double(step);
+			r[1] = double(time);
+			for (size_t k = 0; k < rs-2; ++k)
+				r[k+2] = double(values[k]);
+			lock.lock();
+			++head_;
+			if ( head_ - tail_ >= capacity_/2 )
+				wake_.notify_one();
+		}
+
+		template <typename MESH, typename T, int DIM>
+		void Monitor<MESH,T,DIM>::flush( void ) {
+			if ( !active() )
+				return;
+			unique_lock<mutex> lock(mutex_);
+			while ( tail_ != head_ ) {
+				flushReq_ = true;
+				wake_.notify_one();
+				done_.wait(lock);
+			}
+			out_.flush();
+		}
+
+		template <typename MESH, typename T, int DIM>
+		void Monitor<MESH,T,DIM>::writer( void ) {
+			unique_lock<mutex> lock(mutex_);
+			for (;;) {
+				while ( !stop_ && !flushReq_ && head_ - tail_ < max(capacity_/2, size_t(1)) )
+					wake_.wait(lock);
+				const bool last = stop_;
+				flushReq_ = false;
+				// Scrivo i record presenti senza il lock: push() non tocca le posizioni in [tail_,head_)
+				const size_t upto = head_;
+				lock.unlock();
+				for (size_t r = tail_; r < upto; ++r)
+					write(r % capacity_);
+				if ( tail_ != upto ) out_.flush();
+				lock.lock();
+				tail_ = upto;
+				done_.notify_all();
+				if ( last && tail_ == head_ )
+					return;
+			}
+		}
+
+		template <typename MESH, typename T, int DIM>
+		void Monitor<MESH,T,DIM>::header( void ) {
+			const size_t np = px_.size();
+			if ( binary_ ) {
+				const char magic[8] = "CL2DMON";
+				const uint64_t n[2] = { np, uint64_t(DIM) };
+				out_.write(magic, 8);
+				out_.write(reinterpret_cast<const char*>(n), sizeof(n));
+				for (size_t i = 0; i < np; ++i) {
+					const double xy[2] = { double(px_[i]), double(py_[i]) };
+					out_.write(reinterpret_cast<const char*>(xy), sizeof(xy));
+				}
+				return;
+			}
+			for (size_t i = 0; i < np; ++i)
+				out_ << "# p" << i << " " << px_[i] << " " << py_[i] << std::endl;
+			out_ << "step,time";
+			for (size_t i = 0; i < np; ++i)
+				for (int d = 0; d < DIM; ++d)
+					out_ << ",p" << i << "_" << d;
+			out_ << std::endl;
+			out_ << std::setprecision(12);
+		}
+
+		template <typename MESH, typename T, int DIM>
+		void Monitor<MESH,T,DIM>::write( size_t slot ) {
+			const size_t rs = recordSize();
+			const double* r = &ring_[slot*rs];
+			if ( binary_ ) {
+				out_.write(reinterpret_cast<const char*>(r), rs*sizeof(double));
+				return;
+			}
+			out_ << size_t(r[0]);
+			for (size_t k = 1; k < rs; ++k)
+				out_ << "," << r[k];
+			out_ << "\n";
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,150 @@
+#ifndef _FINITEVOLUME_REDUCTION_HPP
+#define _FINITEVOLUME_REDUCTION_HPP
+
+// Riduzioni (minimo, massimo, somma) sulle celle con risultato indipendente dal numero di thread
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+namespace ConservationLaw2D {
+	namespace Solver {
+
+		using namespace std;
+
+		template <typename T>
+		/*! \class CompensatedSum
+			\brief Somma compensata (Kahan-Babuska-Neumaier): l'errore di arrotondamento di ogni
+			addizione viene accumulato a parte e aggiunto alla fine */
+		class CompensatedSum {
+			public:
+				CompensatedSum():s_(0),c_(0) {}
+				/*! \brief Aggiunge x alla somma */
+				inline void add( T x ) {
+					const T t = s_ + x;
+					// Selezione senza salti: il ciclo resta vettorizzabile
+					const bool big = std::abs(s_) >= std::abs(x);
+					const T a = big ? s_ : x, b = big ? x : s_;
+					c_ += (a - t) + b;
+					s_ = t;
+				}
+				/*! \brief Valore della somma */
+				inline T value( void ) const { return s_ + c_; }
+			private:
+				T s_, c_;
+		};
+
+		template <typename T, int W = 1>
+		/*! \class PairwiseSum
+			\brief Somma a coppie in una passata di W valori per addendo: gruppi di 16 addendi sommati
+			in ordine, poi le somme dei gruppi combinate a coppie come in un albero binario (una pila con
+			una somma per livello). L'errore cresce con il logaritmo del numero di addendi, al costo di
+			circa un'addizione per addendo: piu' veloce della somma compensata.
+
+			Costo misurato (miglior tempo su piu' prove, mesh di 2816 celle, W = 4): gli integrali di
+			FiniteVolume::getTotals() costano circa 3.5-6 us, meno di una somma in ordine sugli stessi
+			dati (6.8-7.4 us su array contigui, 8-9 us con getSol()), perche' le W somme del gruppo sono
+			indipendenti. Gruppi piu' larghi (fino a 128) non danno differenze misurabili. */
+		class PairwiseSum {
+			public:
+				PairwiseSum():count_(0),groups_(0),depth_(0) {
+					for (int k = 0; k < W; ++k) leaf_[k] = T(0);
+				}
+				/*! \brief Aggiunge x alla somma (W = 1) */
+				inline void add( T x ) { add(&x); }
+				/*! \brief Aggiunge i W valori x[0..W-1] alle somme */
+				inline void add( const T* x ) {
+					for (int k = 0; k < W; ++k) leaf_[k] += x[k];
+					if ( ++count_ == 16 ) push();
+				}
+				/*! \brief Valore della somma k */
+				inline T value( int k = 0 ) const {
+					T s = leaf_[k];
+					for (size_t l = depth_; l > 0; --l)
+						s = stack_[l-1][k] + s;
+					return s;
+				}
+			private:
+				// Chiude il gruppo: le somme dei livelli completi vengono combinate a coppie
+				inline void push( void ) {
+					T v[W];
+					for (int k = 0; k < W; ++k) v[k] = leaf_[k];
+					for (size_t g = groups_++; g & 1; g >>= 1) {
+						--depth_;
+						for (int k = 0; k < W; ++k) v[k] = stack_[depth_][k] + v[k];
+					}
+					for (int k = 0; k < W; ++k) {
+						stack_[depth_][k] = v[k];
+						leaf_[k] = T(0);
+					}
+					++depth_;
+					count_ = 0;
+				}
+				T leaf_[W];
+				size_t count_, groups_, depth_;
+				T stack_[64][W];
+		};
+
+		template <typename T>
+		/*! \class Reduction
+			\brief Riduzione deterministica sulle celle
+
+			Le celle sono divise in blocchi consecutivi di dimensione fissa, che non dipendono dal numero
+			di thread: ogni blocco viene ridotto in ordine da un solo thread (i thread si dividono i blocchi,
+			non le celle) e i risultati parziali dei blocchi vengono combinati con un albero binario fisso.
+			Il risultato e' quindi lo stesso, bit per bit, con qualsiasi numero di thread. Le somme dentro
+			un blocco vanno fatte con PairwiseSum o CompensatedSum; l'albero tra i blocchi e' una somma a coppie.
+
+			Ogni blocco puo' avere piu' valori parziali (\c width, per esempio uno per componente). */
+		class Reduction {
+			public:
+				Reduction():n_(0),nb_(0),block_(1),width_(1) {}
+
+				/*! \brief Imposta la divisione in blocchi
+				\param[in] n Numero di celle
+				\param[in] width Numero di valori parziali per blocco
+				\param[in] block Celle per blocco */
+				void setup( size_t n, size_t width = 1, size_t block = 1024 ) {
+					n_ = n;
+					width_ = std::max(width, size_t(1));
+					block_ = std::max(block, size_t(1));
+					nb_ = (n + block_ - 1) / block_;
+					partial_.assign(nb_*width_, T(0));
+				}
+				/*! \brief Numero di blocchi */
+				size_t nBlocks( void ) const { return nb_; }
+				/*! \brief Prima cella del blocco b */
+				size_t begin( size_t b ) const { return b*block_; }
+				/*! \brief Cella successiva all'ultima del blocco b */
+				size_t end( size_t b ) const { return std::min(n_, (b+1)*block_); }
+				/*! \brief Valore parziale k del blocco b */
+				T& operator()( size_t b, size_t k = 0 ) { return partial_[b*width_+k]; }
+				/*! \brief Valore parziale k del blocco b */
+				const T& operator()( size_t b, size_t k = 0 ) const { return partial_[b*width_+k]; }
+
+				/*! \brief Minimo dei valori parziali k dei blocchi */
+				T min( size_t k = 0 ) const { return tree(k, 0, nb_, MIN); }
+				/*! \brief Massimo dei valori parziali k dei blocchi */
+				T max( size_t k = 0 ) const { return tree(k, 0, nb_, MAX); }
+				/*! \brief Somma a coppie dei valori parziali k dei blocchi */
+				T sum( size_t k = 0 ) const { return tree(k, 0, nb_, SUM); }
+
+			private:
+				enum Op { MIN, MAX, SUM };
+				// Albero binario fisso sui blocchi [a,b): divisione a meta', stesso ordine a ogni chiamata
+				T tree( size_t k, size_t a, size_t b, Op op ) const {
+					if ( b <= a ) return T(0);
+					if ( b-a == 1 ) return partial_[a*width_+k];
+					const size_t m = a + (b-a)/2;
+					const T l = tree(k, a, m, op), r = tree(k, m, b, op);
+					if ( op == MIN ) return std::min(l, r);
+					if ( op == MAX ) return std::max(l, r);
+					return l + r;
+				}
+				size_t n_, nb_, block_, width_;
+				vector<T> partial_;
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,236 @@
+#ifndef _FINITEVOLUME_REGION_HPP
+#define _FINITEVOLUME_REGION_HPP
+
+// Regione di interesse per l'output: filtro sulle celle, scelta dei campi e decimazione
+
+#include <mesh/search/pointlocator.hpp>
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <cstdlib>
+
+namespace ConservationLaw2D {
+	namespace Solver {
+
+		using namespace std;
+
+		template <typename MESH, typename T>
+		/*! \class Region
+			\brief Regione di interesse per i frame: celle selezionate, campi scritti e decimazione
+
+			Una cella e' nella regione se il suo baricentro e' nel rettangolo (setBox()) e nel poligono
+			(setPolygon()) e se il suo colore e' tra quelli scelti (setColors()); i filtri non impostati
+			non escludono nulla. Le celle possono essere scritte tutte oppure decimate su una griglia
+			regolare di nx*ny riquadri che copre la regione:
+			- campionamento (setSampling()): per ogni riquadro la cella della regione che ne contiene il centro;
+			- agglomerazione (setAgglomeration()): media pesata con l'area delle celle della regione
+			  con il baricentro nel riquadro.
+
+			Le liste di celle e pesi vengono calcolate una sola volta (resolve()); un frame costa
+			quindi in proporzione alle celle della regione (o ai riquadri), non alla mesh. */
+		class Region {
+			public:
+				/*! \brief Tipo di dato reale */
+				typedef T	real_t;
+				/*! \brief Decimazione delle celle */
+				enum Decimation { NONE, SAMPLE, AGGLOMERATE };
+
+				Region():box_(false),decimation_(NONE),nx_(0),ny_(0),resolved_(false) {}
+
+				/*! \brief Limita la regione al rettangolo [x0,x1]x[y0,y1] */
+				void setBox( real_t x0, real_t y0, real_t x1, real_t y1 ) {
+					box_ = true;
+					x0_ = min(x0, x1); x1_ = max(x0, x1);
+					y0_ = min(y0, y1); y1_ = max(y0, y1);
+				}
+				/*! \brief Limita la regione alle celle con uno dei colori dati */
+				void setColors( const vector<size_t>& colors ) { colors_ = colors; }
+				/*! \brief Limita la regione al poligono (semplice) con i vertici dati */
+				void setPolygon( const vector<real_t>& vx, const vector<real_t>& vy ) {
+					if ( vx.size() != vy.size() || vx.size() < 3 ) {
+						std::cerr << "Error: bad polygon for the output region!" << std::endl;
+						exit(1);
+					}
+					vx_ = vx;
+					vy_ = vy;
+				}
+				/*! \brief Componenti delle variabili primitive da scrivere (di default tutte) */
+				void setFields( const vector<int>& fields ) { fields_ = fields; }
+				/*! \brief Decimazione per campionamento su una griglia di nx*ny riquadri */
+				void setSampling( size_t nx, size_t ny ) { setGrid(SAMPLE, nx, ny); }
+				/*! \brief Decimazione per agglomerazione su una griglia di nx*ny riquadri */
+				void setAgglomeration( size_t nx, size_t ny ) { setGrid(AGGLOMERATE, nx, ny); }
+
+				/*! \brief Vero se e' stato impostato almeno un filtro, un campo o una decimazione */
+				bool configured( void ) const {
+					return box_ || !colors_.empty() || !vx_.empty() || !fields_.empty() || decimation_ != NONE;
+				}
+				/*! \brief Calcola le liste di celle e pesi
+				\warning La geometria della mesh deve essere gia' calcolata (init_geom()) */
+				void resolve( MESH& mesh );
+				/*! \brief Vero dopo resolve() */
+				bool resolved( void ) const { return resolved_; }
+
+				/*! \brief Decimazione impostata */
+				Decimation decimation( void ) const { return decimation_; }
+				/*! \brief Componenti da scrivere (vuoto: tutte) */
+				const vector<int>& fields( void ) const { return fields_; }
+				/*! \brief Numero di celle della regione */
+				size_t nCells( void ) const { return cells_.size(); }
+				/*! \brief i-esima cella della regione (le celle seguono la numerazione originale della mesh) */
+				size_t cell( size_t i ) const { return cells_[i]; }
+				/*! \brief Numero di riquadri non vuoti della griglia di decimazione */
+				size_t nBins( void ) const { return bx_.size(); }
+				/*! \brief Centro del riquadro k */
+				real_t binX( size_t k ) const { return bx_[k]; }
+				real_t binY( size_t k ) const { return by_[k]; }
+				/*! \brief Riga della griglia del riquadro k */
+				size_t binRow( size_t k ) const { return brow_[k]; }
+				/*! \brief Posizioni nelle liste di celle e pesi del riquadro k */
+				size_t begin( size_t k ) const { return start_[k]; }
+				size_t end( size_t k ) const { return start_[k+1]; }
+				/*! \brief j-esima cella delle liste dei riquadri */
+				size_t binCell( size_t j ) const { return bcell_[j]; }
+				/*! \brief j-esimo peso delle liste dei riquadri (somma 1 per riquadro) */
+				real_t binWeight( size_t j ) const { return bweight_[j]; }
+
+			private:
+				void setGrid( Decimation d, size_t nx, size_t ny ) {
+					decimation_ = ( nx > 0 && ny > 0 ) ? d : NONE;
+					nx_ = nx;
+					ny_ = ny;
+				}
+				// Vero se il punto e' nel rettangolo e nel poligono
+				bool inside( real_t x, real_t y ) const;
+
+				// Filtri
+				bool			box_;
+				real_t			x0_, y0_, x1_, y1_;
+				vector<size_t>	colors_;
+				vector<real_t>	vx_, vy_;
+				vector<int>		fields_;
+				// Griglia di decimazione
+				Decimation		decimation_;
+				size_t			nx_, ny_;
+				bool			resolved_;
+				// Celle della regione (numerazione originale)
+				vector<size_t>	cells_;
+				// Riquadri non vuoti: centro, riga, celle e pesi (CSR, un intervallo per riquadro)
+				vector<real_t>	bx_, by_;
+				vector<size_t>	brow_, start_, bcell_;
+				vector<real_t>	bweight_;
+		};
+
+		// ===========
+		// DEFINITIONS
+		// ===========
+
+		template <typename MESH, typename T>
+		bool Region<MESH,T>::inside( real_t x, real_t y ) const {
+			if ( box_ && ( x < x0_ || x > x1_ || y < y0_ || y > y1_ ) )
+				return false;
+			if ( vx_.empty() )
+				return true;
+			// Parita' degli attraversamenti di una semiretta orizzontale
+			bool in(false);
+			for (size_t i = 0, j = vx_.size()-1; i < vx_.size(); j = i++)
+				if ( (vy_[i] > y) != (vy_[j] > y) && x < vx_[j] + (vx_[i]-vx_[j])*(y-vy_[j])/(vy_[i]-vy_[j]) )
+					in = !in;
+			return in;
+		}
+
+		template <typename MESH, typename T>
+		void Region<MESH,T>::resolve( MESH& mesh ) {
+			typedef typename MESH::polygon_ptr polygon_ptr;
+			typedef typename MESH::real_t mreal_t;
+			// Celle della regione nella numerazione originale, e maschera per indice interno
+			cells_.clear();
+			vector<char> mask(mesh.nP(), 0);
+			real_t xmin(0), xmax(0), ymin(0), ymax(0);
+			for (size_t i = 0; i < mesh.nP(); ++i) {
+				polygon_ptr p = mesh.pOrig(i);
+				if ( !colors_.empty() && std::find(colors_.begin(), colors_.end(), p->getColor()) == colors_.end() )
+					continue;
+				const real_t x = p->cx(), y = p->cy();
+				if ( !inside(x, y) )
+					continue;
+				if ( cells_.empty() ) {
+					xmin = xmax = x;
+					ymin = ymax = y;
+				}
+				xmin = min(xmin, x); xmax = max(xmax, x);
+				ymin = min(ymin, y); ymax = max(ymax, y);
+				cells_.push_back(p->getId());
+				mask[p->getId()] = 1;
+			}
+			bx_.clear(); by_.clear(); brow_.clear();
+			start_.assign(1, 0);
+			bcell_.clear(); bweight_.clear();
+			resolved_ = true;
+			if ( decimation_ == NONE || cells_.empty() )
+				return;
+			// Griglia sul rettangolo, se impostato, altrimenti sui baricentri della regione
+			if ( box_ ) {
+				xmin = x0_; xmax = x1_;
+				ymin = y0_; ymax = y1_;
+			}
+			const real_t hx = ( xmax > xmin ) ? (xmax-xmin)/nx_ : real_t(1);
+			const real_t hy = ( ymax > ymin ) ? (ymax-ymin)/ny_ : real_t(1);
+			if ( decimation_ == SAMPLE ) {
+				// Cella che contiene il centro di ogni riquadro, se e' nella regione
+				Mesh::PointLocator<MESH> locator(mesh);
+				vector<mreal_t> x, y;
+				for (size_t r = 0; r < ny_; ++r)
+					for (size_t c = 0; c < nx_; ++c) {
+						x.push_back(xmin + (c+0.5)*hx);
+						y.push_back(ymin + (r+0.5)*hy);
+					}
+				vector<size_t> ids;
+				locator.locate(x, y, ids);
+				for (size_t k = 0; k < ids.size(); ++k) {
+					if ( ids[k] == size_t(Mesh::PointLocator<MESH>::NOPOLYGON) || !mask[ids[k]] )
+						continue;
+					bx_.push_back(x[k]);
+					by_.push_back(y[k]);
+					brow_.push_back(k / nx_);
+					bcell_.push_back(ids[k]);
+					bweight_.push_back(1);
+					start_.push_back(bcell_.size());
+				}
+				return;
+			}
+			// Agglomerazione: celle ordinate per riquadro (conteggio e prefissi)
+			vector<size_t> bin(cells_.size()), count(nx_*ny_+1, 0);
+			for (size_t i = 0; i < cells_.size(); ++i) {
+				polygon_ptr p = mesh.p(cells_[i]);
+				const size_t c = min(size_t(max(real_t(0), (p->cx()-xmin)/hx)), nx_-1);
+				const size_t r = min(size_t(max(real_t(0), (p->cy()-ymin)/hy)), ny_-1);
+				bin[i] = r*nx_ + c;
+				++count[bin[i]+1];
+			}
+			for (size_t k = 0; k < nx_*ny_; ++k)
+				count[k+1] += count[k];
+			vector<size_t> order(cells_.size());
+			vector<size_t> next(count.begin(), count.end()-1);
+			for (size_t i = 0; i < cells_.size(); ++i)
+				order[next[bin[i]]++] = cells_[i];
+			for (size_t k = 0; k < nx_*ny_; ++k) {
+				if ( count[k+1] == count[k] )
+					continue;
+				real_t area(0);
+				for (size_t j = count[k]; j < count[k+1]; ++j)
+					area += mesh.p(order[j])->area();
+				for (size_t j = count[k]; j < count[k+1]; ++j) {
+					bcell_.push_back(order[j]);
+					bweight_.push_back(mesh.p(order[j])->area() / area);
+				}
+				bx_.push_back(xmin + (k%nx_+0.5)*hx);
+				by_.push_back(ymin + (k/nx_+0.5)*hy);
+				brow_.push_back(k / nx_);
+				start_.push_back(bcell_.size());
+			}
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,143 @@
+#ifndef _FINITEVOLUME_SOLUTIONBUFFER_HPP
+#define _FINITEVOLUME_SOLUTIONBUFFER_HPP
+
+// Soluzione per cella in array contigui, separata dalla topologia della mesh
+
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+#include <functional>
+// Gruppo di thread e allocatore per il first touch
+#include <solvers/finitevolume/threadteam.hpp>
+// Libreria EIGEN per l'Algebra
+#include <Eigen/Core>
+
+namespace ConservationLaw2D {
+	namespace Solver {
+
+		using namespace std;
+
+		/*! \brief Disposizione in memoria delle componenti della soluzione */
+		enum Layout {
+			/*! \brief Array of Structures: le componenti di una cella sono contigue */
+			AoS,
+			/*! \brief Structure of Arrays: ogni componente e' un array sulle celle */
+			SoA
+		};
+
+		template <typename T, int DIM, int LAYOUT = AoS>
+		/*! \class SolutionBuffer
+			\brief Soluzione su tutte le celle in un unico array, indicizzata con l'id del poligono
+
+			Lo scambio tra due buffer (swap()) scambia solo i puntatori ai dati. */
+		class SolutionBuffer {
+			public:
+				/*! \brief Tipo per lo stato di una cella */
+				typedef Eigen::Matrix<T, DIM, 1>	VecType;
+
+				SolutionBuffer():n_(0) {}
+				/*! \brief Costruttore con il numero di celle */
+				explicit SolutionBuffer( size_t n ):n_(n),data_(n*DIM, T(0)) {}
+
+				/*! \brief Imposta il numero di celle (il contenuto non e' conservato) */
+				void resize( size_t n ) { n_ = n; data_.assign(n*DIM, T(0)); }
+				/*! \brief Imposta il numero di celle e azzera in parallelo l'intervallo di celle di ogni
+				thread del gruppo: le pagine finiscono nella memoria del nodo NUMA del thread che le usa
+				(il contenuto non e' conservato) */
+				void resize( size_t n, ThreadTeam& team ) {
+					n_ = n;
+					vector<T, FirstTouchAllocator<T> >(n*DIM).swap(data_);
+					team.run(std::bind(&SolutionBuffer::touch, this, std::placeholders::_1, &team));
+				}
+				/*! \brief Numero di celle */
+				size_t size( void ) const { return n_; }
+				/*! \brief Scambia il contenuto con un altro buffer, senza copie */
+				void swap( SolutionBuffer& other ) { std::swap(n_, other.n_); data_.swap(other.data_); }
+
+				/*! \brief Posizione nell'array della componente i della cella c */
+				inline size_t index( size_t c, int i ) const { return LAYOUT == AoS ? c*DIM + i : i*n_ + c; }
+				/*! \brief Distanza nell'array tra due celle consecutive (stessa componente) */
+				inline size_t cellStride( void ) const { return LAYOUT == AoS ? DIM : 1; }
+				/*! \brief Distanza nell'array tra due componenti consecutive (stessa cella) */
+				inline size_t componentStride( void ) const { return LAYOUT == AoS ? 1 : n_; }
+				/*! \brief Componente i della cella c */
+				inline T& operator()( size_t c, int i ) { return data_[index(c,i)]; }
+				/*! \brief Componente i della cella c */
+				inline const T& operator()( size_t c, int i ) const { return data_[index(c,i)]; }
+				/*! \brief Stato della cella c */
+				inline VecType operator[]( size_t c ) const {
+					VecType q;
+					for (int i = 0; i < DIM; ++i) q[i] = data_[index(c,i)];
+					return q;
+				}
+				/*! \brief Imposta lo stato della cella c */
+				inline void set( size_t c, const VecType& q ) {
+					for (int i = 0; i < DIM; ++i) data_[index(c,i)] = q[i];
+				}
+				/*! \brief Puntatore ai dati */
+				T* data( void ) { return data_.empty() ? 0 : &data_[0]; }
+				/*! \brief Puntatore ai dati */
+				const T* data( void ) const { return data_.empty() ? 0 : &data_[0]; }
+			private:
+				// Azzera le celle del thread t (ogni componente per SoA)
+				void touch( size_t t, const ThreadTeam* team ) {
+					const size_t b = team->first(t, n_), e = team->last(t, n_);
+					for (size_t c = b; c < e; ++c)
+						for (int i = 0; i < DIM; ++i) data_[index(c,i)] = T(0);
+				}
+				size_t n_;
+				vector<T, FirstTouchAllocator<T> > data_;
+		};
+
+		template <typename BUFFER>
+		/*! \class SolutionPool
+			\brief Insieme di buffer di appoggio per gli integratori a piu' stadi
+
+			I buffer restituiti da release() vengono riusati dalle richieste successive:
+			dopo il primo passo non ci sono piu' allocazioni. */
+		class SolutionPool {
+			public:
+				SolutionPool():n_(0),team_(0) {}
+				~SolutionPool() {
+					for (size_t i = 0; i < all_.size(); ++i)
+						delete all_[i];
+				}
+				/*! \brief Imposta il numero di celle dei buffer
+				\param[in] n Numero di celle
+				\param[in] team Se dato, i buffer sono inizializzati in parallelo dai thread del gruppo */
+				void resize( size_t n, ThreadTeam* team = 0 ) {
+					n_ = n;
+					team_ = team;
+					for (size_t i = 0; i < all_.size(); ++i)
+						allocate(*all_[i]);
+				}
+				/*! \brief Restituisce un buffer libero (il contenuto non e' definito) */
+				BUFFER& acquire( void ) {
+					if ( free_.empty() ) {
+						all_.push_back(new BUFFER);
+						allocate(*all_.back());
+						return *all_.back();
+					}
+					BUFFER* b = free_.back();
+					free_.pop_back();
+					return *b;
+				}
+				/*! \brief Rende disponibile un buffer ottenuto con acquire() */
+				void release( BUFFER& b ) { free_.push_back(&b); }
+				/*! \brief Numero di buffer allocati */
+				size_t allocated( void ) const { return all_.size(); }
+			private:
+				SolutionPool( const SolutionPool& );
+				SolutionPool& operator=( const SolutionPool& );
+				void allocate( BUFFER& b ) {
+					if ( team_ ) b.resize(n_, *team_);
+					else b.resize(n_);
+				}
+				size_t n_;
+				ThreadTeam* team_;
+				vector<BUFFER*> all_, free_;
+		};
+	}
+}
+
+#endif
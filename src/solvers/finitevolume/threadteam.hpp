@@ -0,0 +1,278 @@
+#ifndef _FINITEVOLUME_THREADTEAM_HPP
+#define _FINITEVOLUME_THREADTEAM_HPP
+
+// Gruppo di thread con affinita' ai core e partizione delle celle per nodo NUMA
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdlib>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+namespace ConservationLaw2D {
+	namespace Solver {
+
+		using namespace std;
+
+		/*! \brief Allocatore che non inizializza gli elementi costruiti senza argomenti
+
+			Le pagine di un vettore allocato con questo allocatore non vengono toccate alla creazione:
+			restano senza nodo NUMA finche' il primo thread che le scrive non le assegna al proprio
+			(first touch). */
+		template <typename T>
+		struct FirstTouchAllocator : public std::allocator<T> {
+			template <typename U> struct rebind { typedef FirstTouchAllocator<U> other; };
+			FirstTouchAllocator() {}
+			template <typename U> FirstTouchAllocator( const FirstTouchAllocator<U>& ) {}
+			template <typename U> void construct( U* p ) { ::new(static_cast<void*>(p)) U; }
+			template <typename U, typename... A> void construct( U* p, A&&... a ) {
+				::new(static_cast<void*>(p)) U(std::forward<A>(a)...);
+			}
+		};
+
+		/*! \class ThreadTeam
+			\brief Gruppo fisso di thread che eseguono la stessa funzione su parti diverse delle celle
+
+			Il thread chiamante e' il thread 0, gli altri restano in attesa tra un ciclo e il successivo.
+			Ogni thread lavora su un intervallo contiguo di celle (first(), last()): con una mesh rinumerata
+			per localita' (reorder()) gli intervalli sono regioni compatte. Con l'affinita' attiva i thread
+			sono assegnati a blocchi ai nodi NUMA (thread consecutivi sullo stesso nodo) e, nel nodo, ai
+			core in ordine; la topologia e' letta da /sys, senza librerie esterne (solo Linux, altrove
+			l'affinita' e' ignorata).
+
+			I dati scritti per la prima volta da ogni thread sul proprio intervallo (first touch) finiscono
+			nella memoria del suo nodo: report() mostra per ogni thread core, nodo e nodo effettivo della
+			prima pagina di un array.
+			\warning Con l'affinita' attiva anche il thread chiamante resta fissato al core del thread 0 */
+		class ThreadTeam {
+			public:
+				ThreadTeam():n_(1),generation_(0),pending_(0),stop_(false) {}
+				~ThreadTeam() { stop(); }
+
+				/*! \brief Avvia il gruppo
+				\param[in] n Numero di thread (compreso il chiamante)
+				\param[in] pin Fissa ogni thread a un core */
+				void start( size_t n, bool pin = true );
+				/*! \brief Termina i thread */
+				void stop( void );
+				/*! \brief Numero di thread */
+				size_t size( void ) const { return n_; }
+				/*! \brief Prima cella del thread t su n celle */
+				size_t first( size_t t, size_t n ) const { return (n*t)/n_; }
+				/*! \brief Cella successiva all'ultima del thread t su n celle */
+				size_t last( size_t t, size_t n ) const { return (n*(t+1))/n_; }
+				/*! \brief Esegue f(t) su tutti i thread e attende che finiscano */
+				void run( const std::function<void(size_t)>& f );
+				/*! \brief Core assegnato al thread t (-1 senza affinita') */
+				int cpu( size_t t ) const { return cpu_.empty() ? -1 : cpu_[t]; }
+				/*! \brief Nodo NUMA assegnato al thread t */
+				int node( size_t t ) const { return node_.empty() ? 0 : node_[t]; }
+				/*! \brief Nodo NUMA della pagina che contiene l'indirizzo dato (-1 se la pagina non e'
+				ancora stata toccata o l'informazione non e' disponibile) */
+				static int pageNode( const void* addr );
+				/*! \brief Stampa la disposizione scelta
+				\param[in] data Array di n elementi di dimensione size divisi tra i thread (opzionale) */
+				void report( std::ostream& out, const void* data = 0, size_t n = 0, size_t size = 0 ) const;
+
+			private:
+				ThreadTeam( const ThreadTeam& );
+				ThreadTeam& operator=( const ThreadTeam& );
+				// Ciclo dei thread in attesa
+				void worker( size_t t );
+				// Fissa il thread corrente al core del thread t
+				void pin( size_t t ) const;
+				// Core dei nodi NUMA disponibili al processo
+				static void topology( vector< vector<int> >& nodes );
+				// Elenco di core nel formato di /sys (es. "0-3,8-11")
+				static vector<int> parseList( const string& s );
+
+				size_t n_;
+				vector<std::thread> threads_;
+				vector<int> cpu_, node_;
+				std::mutex mutex_;
+				std::condition_variable wake_, done_;
+				std::function<void(size_t)> job_;
+				size_t generation_, pending_;
+				bool stop_;
+		};
+
+		// ===========
+		// DEFINITIONS
+		// ===========
+
+		inline void ThreadTeam::start( size_t n, bool pin ) {
+			stop();
+			n_ = max(n, size_t(1));
+			cpu_.clear();
+			node_.clear();
+			if ( pin ) {
+				vector< vector<int> > nodes;
+				topology(nodes);
+				if ( !nodes.empty() ) {
+					// Thread a blocchi sui nodi, nel nodo sui core in ordine (ciclicamente se sono meno dei thread)
+					for (size_t t = 0; t < n_; ++t) {
+						const size_t k = (t*nodes.size())/n_;
+						const size_t t0 = (k*n_ + nodes.size()-1)/nodes.size();
+						cpu_.push_back(nodes[k][(t-t0) % nodes[k].size()]);
+						node_.push_back(int(k));
+					}
+				}
+			}
+			stop_ = false;
+			generation_ = 0;
+			for (size_t t = 1; t < n_; ++t)
+				threads_.push_back(std::thread(&ThreadTeam::worker, this, t));
+			this->pin(0);
+		}
+
+		inline void ThreadTeam::stop( void ) {
+			if ( threads_.empty() ) return;
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				stop_ = true;
+			}
+			wake_.notify_all();
+			for (size_t t = 0; t < threads_.size(); ++t)
+				threads_[t].join();
+			threads_.clear();
+			n_ = 1;
+		}
+
+		inline void ThreadTeam::run( const std::function<void(size_t)>& f ) {
+			if ( n_ == 1 ) {
+				f(0);
+				return;
+			}
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				job_ = f;
+				pending_ = n_-1;
+				++generation_;
+			}
+			wake_.notify_all();
+			f(0);
+			std::unique_lock<std::mutex> lock(mutex_);
+			while ( pending_ > 0 )
+				done_.wait(lock);
+		}
+
+		inline void ThreadTeam::worker( size_t t ) {
+			pin(t);
+			size_t seen(0);
+			for (;;) {
+				std::function<void(size_t)> job;
+				{
+					std::unique_lock<std::mutex> lock(mutex_);
+					while ( !stop_ && generation_ == seen )
+						wake_.wait(lock);
+					if ( stop_ ) return;
+					seen = generation_;
+					job = job_;
+				}
+				job(t);
+				std::lock_guard<std::mutex> lock(mutex_);
+				if ( --pending_ == 0 )
+					done_.notify_one();
+			}
+		}
+
+		inline void ThreadTeam::pin( size_t t ) const {
+#ifdef __linux__
+			if ( cpu_.empty() ) return;
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			CPU_SET(cpu_[t], &set);
+			if ( pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0 )
+				std::cerr << "Warning: cannot pin thread " << t << " to cpu " << cpu_[t] << std::endl;
+#endif
+		}
+
+		inline vector<int> ThreadTeam::parseList( const string& s ) {
+			vector<int> list;
+			stringstream ss(s);
+			string item;
+			while ( getline(ss, item, ',') ) {
+				if ( item.empty() || item[0] == '\n' ) continue;
+				const size_t dash = item.find('-');
+				const int a = atoi(item.substr(0, dash).c_str());
+				const int b = ( dash == string::npos ) ? a : atoi(item.substr(dash+1).c_str());
+				for (int c = a; c <= b; ++c) list.push_back(c);
+			}
+			return list;
+		}
+
+		inline void ThreadTeam::topology( vector< vector<int> >& nodes ) {
+			nodes.clear();
+#ifdef __linux__
+			cpu_set_t allowed;
+			CPU_ZERO(&allowed);
+			if ( sched_getaffinity(0, sizeof(allowed), &allowed) != 0 ) return;
+			// Nodi NUMA: node0, node1, ... (le CPU non consentite al processo sono scartate)
+			for (int k = 0; ; ++k) {
+				std::ostringstream name;
+				name << "/sys/devices/system/node/node" << k << "/cpulist";
+				std::ifstream in(name.str().c_str());
+				if ( !in ) break;
+				string s;
+				getline(in, s);
+				vector<int> list = parseList(s), cpus;
+				for (size_t i = 0; i < list.size(); ++i)
+					if ( list[i] < CPU_SETSIZE && CPU_ISSET(list[i], &allowed) ) cpus.push_back(list[i]);
+				if ( !cpus.empty() ) nodes.push_back(cpus);
+			}
+			// Senza informazioni sui nodi: un solo nodo con le CPU consentite
+			if ( nodes.empty() ) {
+				vector<int> cpus;
+				for (int c = 0; c < CPU_SETSIZE; ++c)
+					if ( CPU_ISSET(c, &allowed) ) cpus.push_back(c);
+				if ( !cpus.empty() ) nodes.push_back(cpus);
+			}
+#endif
+		}
+
+		inline int ThreadTeam::pageNode( const void* addr ) {
+#if defined(__linux__) && defined(SYS_move_pages)
+			// move_pages senza nodi di destinazione restituisce il nodo attuale delle pagine
+			void* pages[1] = { const_cast<void*>(addr) };
+			int status[1] = { -1 };
+			if ( syscall(SYS_move_pages, 0, 1UL, pages, (const int*)0, status, 0) != 0 ) return -1;
+			return status[0] >= 0 ? status[0] : -1;
+#else
+			return -1;
+#endif
+		}
+
+		inline void ThreadTeam::report( std::ostream& out, const void* data, size_t n, size_t size ) const {
+			out << "Threads: " << n_ << (cpu_.empty() ? ", not pinned" : ", pinned") << std::endl;
+			for (size_t t = 0; t < n_; ++t) {
+				out << " Thread " << t << ": ";
+				if ( !cpu_.empty() ) out << "cpu " << cpu_[t] << ", node " << node_[t];
+				else out << "any cpu";
+				if ( data && n > 0 ) {
+					const size_t b = first(t, n), e = last(t, n);
+					out << ", cells [" << b << "," << e << ")";
+					if ( e > b ) {
+						const int pn = pageNode(static_cast<const char*>(data) + b*size);
+						out << ", first page on node ";
+						if ( pn >= 0 ) out << pn; else out << "unknown";
+					}
+				}
+				out << std::endl;
+			}
+		}
+	}
+}
+
+#endif
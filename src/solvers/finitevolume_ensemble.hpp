@@ -0,0 +1,358 @@
+#ifndef _FINITEVOLUME_ENSEMBLE_HPP
+#define _FINITEVOLUME_ENSEMBLE_HPP
+
+// Libreria per la Mesh
+#include <solvers/finitevolume/mesh_finitevolume_traits.hpp>
+// Blocchi di lati per i flussi vettoriali
+#include <solvers/fluxes/faceblock.hpp>
+// Formato dei frame per gnuplot
+#include <solvers/finitevolume/gnuplotwriter.hpp>
+#include <cmath>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <iomanip>
+#include <functional>
+
+namespace ConservationLaw2D {
+	namespace Solver {
+		using namespace std;
+		/*! \class FiniteVolumeEnsemble
+		\brief Solutore a Volumi Finiti per un insieme di K problemi sulla stessa mesh
+
+		Ogni cella contiene K stati (membri dell'insieme), memorizzati per componente
+		e poi per membro. I lati vengono visitati una sola volta per passo e il flusso
+		numerico e' valutato su blocchi di coppie (lato, membro), una per canale SIMD
+		(vedi NumericalFlux::BlockFlux): la geometria viene letta una volta per tutti i membri.
+		Ogni membro avanza con il proprio passo temporale, a meno di setSharedDt(). */
+		template <typename MODEL, typename NUMFLUX>
+		class FiniteVolumeEnsemble {
+
+			private:
+				typedef typename MODEL::real_t							real_t;
+				typedef typename MODEL::SolType							SolType;
+				typedef typename Mesh::DefaultTraits<real_t>			Traits;
+			public:
+				// Mesh
+				/*! \brief Mesh specifica per volumi finiti (la stessa di FiniteVolume) */
+				typedef typename Traits::PolygonalMesh		FVMesh;
+			private:
+				// Puntatori
+				typedef typename FVMesh::polygon_ptr		polygon_ptr;
+				typedef typename FVMesh::vertex_ptr			vertex_ptr;
+				typedef typename FVMesh::hedge_ptr			hedge_ptr;
+				// Iteratori
+				typedef typename FVMesh::polygon_it			p_it;
+				typedef typename FVMesh::hedge_it			e_it;
+				// Circolatori
+				typedef typename FVMesh::Vertex::PolygonCirculator	vp_cit;
+				typedef typename FVMesh::Polygon::VertexCirculator	pv_cit;
+				// Condizioni iniziali e al bordo: funzioni o oggetti con stato, come in FiniteVolume
+				// (es. una closure con i parametri di ogni membro)
+				// [in ingresso membro, colore, x e y]
+				typedef std::function<SolType( size_t, size_t, real_t, real_t )> INITCOND;
+				// [in ingresso x, y, t e colore]
+				typedef std::function<SolType( SolType&, size_t, real_t, real_t, real_t, real_t, real_t )> BOUNDARYCOND;
+				// Dimensione dello spazio di stato
+				enum { DIM = SolType::RowsAtCompileTime };
+				// Blocco di coppie (lato, membro) per i flussi vettoriali
+				typedef NumericalFlux::FaceBlock<real_t,DIM>	Block;
+
+				// Indice della componente i del membro m nella cella c
+				inline size_t idx( size_t c, int i, size_t m ) const { return (c*DIM + i)*K_ + m; }
+				// Stato del membro m nella cella c
+				inline SolType state( const vector<real_t>& q, size_t c, size_t m ) const {
+					SolType s;
+					for (int i = 0; i < DIM; ++i) s[i] = q[idx(c,i,m)];
+					return s;
+				}
+
+			public:
+				/*! \brief Costruttore del solutore
+				 \param[in] model Referenza al modello di problema
+				 \param[in] mesh Referenza alla mesh
+				 \param[in] K Numero di membri dell'insieme
+				*/
+				FiniteVolumeEnsemble( MODEL& model, FVMesh& mesh, size_t K )
+					:model_(model),mesh_(mesh),NumFlux(model),K_(K),cflmax_(0.0),
+					finaltime_(numeric_limits<real_t>::max()),shareddt_(false),
+					dt_(K,0.0),currtime_(K,0.0) {};
+
+				// Impostazioni
+				/*! \brief Imposta il massimo CFL */
+				void setCFLmax ( real_t cflm ) { cflmax_ = cflm; }
+				/*! \brief Imposta le condizioni iniziali (il primo argomento e' l'indice del membro) */
+				void setIC ( INITCOND ic ) { InitialCondition = ic; }
+				/*! \brief Imposta le condizioni al bordo, comuni a tutti i membri */
+				void setBC ( BOUNDARYCOND bc ) { BoundaryCondition = bc; }
+				/*! \brief Imposta la directory nella quale sara' salvata la soluzione */
+				void setDirectory ( const string& dir ) { datadir_ = dir; }
+				/*! \brief Usa per tutti i membri il minimo dei passi temporali */
+				void setSharedDt ( bool on ) { shareddt_ = on; }
+				/*! \brief Tempo finale: i membri che lo raggiungono non vengono piu' aggiornati */
+				void setFinalTime ( real_t t ) { finaltime_ = t; }
+				// Accesso
+				/*! \brief Restituisce il numero di membri */
+				size_t size(void) const { return K_; }
+				/*! \brief Restituisce il tempo corrente del membro m */
+				real_t getCurrTime(size_t m) const { return currtime_[m]; }
+				/*! \brief Restituisce il passo temporale corrente del membro m */
+				real_t getCurrDt(size_t m) const { return dt_[m]; }
+				/*! \brief Restituisce lo stato (variabili conservate) dell'i-esimo poligono per il membro m */
+				SolType getSol(size_t m, size_t i) const { return state(sol_, i, m); }
+				/*! \brief Vero se tutti i membri hanno raggiunto il tempo finale */
+				bool finished(void) const;
+
+				/*! \brief Inizializza il solutore */
+				void init();
+				/*! \brief Esegue un passo temporale per tutti i membri */
+				void timestep();
+				/*! \brief Salva un frame della soluzione del membro m
+				\param[in] m Indice del membro
+				\param[in] id Id del frame
+				\param[in] gnuplot Tipologia del plot (GNUPLOT o densita' interpolata ai vertici) */
+				void framegrab(size_t const m, size_t const id, bool gnuplot) const;
+			private:
+				void updateTimestep();
+				// Valuta i flussi del blocco e li somma ai residui
+				void flushBlock( Block&, size_t, const size_t*, const size_t*, const size_t*, const real_t* );
+
+			private:
+				// Modello
+				MODEL& model_;
+				// Mesh
+				FVMesh& mesh_;
+				// Flusso numerico
+				NUMFLUX NumFlux;
+				// Condizioni iniziali e bordo
+				INITCOND		InitialCondition;
+				BOUNDARYCOND	BoundaryCondition;
+				// Altro
+				size_t K_;
+				real_t cflmax_, finaltime_;
+				bool shareddt_;
+				vector<real_t> dt_, currtime_;
+				vector<size_t> running_;
+				string datadir_;
+				// Geometria delle celle
+				vector<real_t> area_, diam_;
+				// Lati interni (poligoni e geometria) e lati di bordo
+				vector<size_t> faceL_, faceR_;
+				vector<real_t> faceLen_, faceNx_, faceNy_;
+				vector<hedge_ptr> bfaces_;
+				// Soluzione corrente, al passo precedente e residui [cella][componente][membro]
+				vector<real_t> sol_, sol0_, residual_;
+		};
+
+
+		///////////////////////
+		//  IMPLEMENTAZIONE  //
+		///////////////////////
+
+		template <typename MODEL, typename NUMFLUX>
+		void FiniteVolumeEnsemble<MODEL,NUMFLUX>::init() {
+			std::cout << "============================= " << std::endl;
+			std::cout << "Init Finite Volume Ensemble ... " << std::endl;
+			std::cout << "============================= " << std::endl;
+			std::cout << " Members: " << K_ << (shareddt_ ? " (shared dt)" : " (per-member dt)") << std::endl;
+			// Inizializzo la geometria per la mesh
+			mesh_.init_geom();
+			area_.resize(mesh_.nP());
+			diam_.resize(mesh_.nP());
+			sol_.resize(mesh_.nP()*DIM*K_);
+			for (p_it p = mesh_.p_begin(); p != mesh_.p_end(); ++p) {
+				size_t c = (*p)->getId();
+				area_[c] = (*p)->area();
+				diam_[c] = (*p)->diam();
+				for (size_t m = 0; m < K_; ++m) {
+					SolType q = model_.PrimitiveToConservative(InitialCondition(m,(*p)->getColor(),(*p)->cx(),(*p)->cy()));
+					for (int i = 0; i < DIM; ++i)
+						sol_[idx(c,i,m)] = q[i];
+				}
+			}
+			sol0_ = sol_;
+			residual_.assign(sol_.size(), 0.0);
+			// Ogni lato interno compare una sola volta
+			faceL_.clear(); faceR_.clear();
+			faceLen_.clear(); faceNx_.clear(); faceNy_.clear();
+			bfaces_.clear();
+			for (e_it e = mesh_.he_begin(); e != mesh_.he_end(); ++e) {
+				if ( (*e)->isBoundary() ) {
+					bfaces_.push_back(*e);
+				} else if ( (*e)->getId() < (*e)->getTwinHEdge().getId() ) {
+					faceL_.push_back((*e)->polygonL().getId());
+					faceR_.push_back((*e)->polygonR().getId());
+					faceLen_.push_back((*e)->length());
+					faceNx_.push_back((*e)->nx());
+					faceNy_.push_back((*e)->ny());
+				}
+			}
+			std::fill(currtime_.begin(), currtime_.end(), 0.0);
+			std::fill(dt_.begin(), dt_.end(), 0.0);
+		}
+
+		template <typename MODEL, typename NUMFLUX>
+		bool FiniteVolumeEnsemble<MODEL,NUMFLUX>::finished( void ) const {
+			for (size_t m = 0; m < K_; ++m)
+				if ( currtime_[m] < finaltime_ ) return false;
+			return true;
+		}
+
+		template <typename MODEL, typename NUMFLUX>
+		inline void FiniteVolumeEnsemble<MODEL,NUMFLUX>::updateTimestep( void ) {
+			// Membri ancora in corsa
+			running_.clear();
+			for (size_t m = 0; m < K_; ++m)
+				if ( currtime_[m] < finaltime_ ) running_.push_back(m);
+			// Calcolo dt da CFL desiderato (cflmax) per ogni membro
+			std::fill(dt_.begin(), dt_.end(), 0.0);
+			for (size_t j = 0; j < running_.size(); ++j) {
+				const size_t m = running_[j];
+				real_t dt = 1e10;
+				for (size_t c = 0; c < mesh_.nP(); ++c)
+					dt = min( dt, cflmax_* diam_[c]/model_.MaxLambda(state(sol_,c,m)) );
+				dt_[m] = dt;
+			}
+			// Passo comune: il minimo sui membri ancora in corsa
+			if ( shareddt_ && !running_.empty() ) {
+				real_t dt = 1e10;
+				for (size_t j = 0; j < running_.size(); ++j)
+					dt = min(dt, dt_[running_[j]]);
+				for (size_t j = 0; j < running_.size(); ++j)
+					dt_[running_[j]] = dt;
+			}
+			// Non supero il tempo finale
+			for (size_t j = 0; j < running_.size(); ++j) {
+				const size_t m = running_[j];
+				dt_[m] = min(dt_[m], finaltime_ - currtime_[m]);
+			}
+		}
+
+		template <typename MODEL, typename NUMFLUX>
+		inline void FiniteVolumeEnsemble<MODEL,NUMFLUX>::flushBlock( Block& b, size_t n,
+				const size_t* cl, const size_t* cr, const size_t* mm, const real_t* len ) {
+			b.pad(n);
+			NumericalFlux::BlockFlux<NUMFLUX>::eval(NumFlux, b);
+			for (size_t k = 0; k < n; ++k) {
+				for (int i = 0; i < DIM; ++i) {
+					real_t F = len[k] * b.flux[i][k];
+					residual_[idx(cl[k],i,mm[k])] += F;
+					// Lati di bordo: nessuna cella a destra
+					if ( cr ) residual_[idx(cr[k],i,mm[k])] -= F;
+				}
+			}
+		}
+
+		template <typename MODEL, typename NUMFLUX>
+		inline void FiniteVolumeEnsemble<MODEL,NUMFLUX>::timestep( void ) {
+			updateTimestep();
+			// La soluzione corrente diventa quella al passo precedente (viene riscritta per intero)
+			sol_.swap(sol0_);
+			for (size_t c = 0; c < mesh_.nP(); ++c)
+				for (size_t j = 0; j < running_.size(); ++j)
+					if ( !model_.ConsistentState(state(sol0_,c,running_[j])) ) {
+						std::cerr << "Bad state solution in member " << running_[j] << "! Maybe too high CFL number ..." << std::endl;
+						exit(1);
+					}
+			std::fill(residual_.begin(), residual_.end(), 0.0);
+			Block b;
+			const size_t W = Block::Width;
+			size_t cl[W], cr[W], mm[W];
+			real_t len[W];
+			// Lati interni: un canale per ogni coppia (lato, membro in corsa)
+			size_t n = 0;
+			for (size_t f = 0; f < faceL_.size(); ++f) {
+				const size_t L = faceL_[f], R = faceR_[f];
+				for (size_t j = 0; j < running_.size(); ++j) {
+					const size_t m = running_[j];
+					for (int i = 0; i < DIM; ++i) {
+						b.ql[i][n] = sol0_[idx(L,i,m)];
+						b.qr[i][n] = sol0_[idx(R,i,m)];
+					}
+					b.nx[n] = faceNx_[f];
+					b.ny[n] = faceNy_[f];
+					cl[n] = L; cr[n] = R; mm[n] = m; len[n] = faceLen_[f];
+					if ( ++n == W ) {
+						flushBlock(b, n, cl, cr, mm, len);
+						n = 0;
+					}
+				}
+			}
+			if ( n ) flushBlock(b, n, cl, cr, mm, len);
+			// Lati di bordo: stato a destra dalle condizioni al bordo, al tempo del membro
+			n = 0;
+			for (size_t f = 0; f < bfaces_.size(); ++f) {
+				hedge_ptr e = bfaces_[f];
+				const size_t L = e->polygonL().getId();
+				for (size_t j = 0; j < running_.size(); ++j) {
+					const size_t m = running_[j];
+					SolType ql = state(sol0_, L, m);
+					SolType wl = model_.ConservativeToPrimitive(ql);
+					SolType qr = model_.PrimitiveToConservative(BoundaryCondition(wl,e->getColor(),e->xm(),e->ym(),e->nx(),e->ny(),currtime_[m]));
+					for (int i = 0; i < DIM; ++i) {
+						b.ql[i][n] = ql[i];
+						b.qr[i][n] = qr[i];
+					}
+					b.nx[n] = e->nx();
+					b.ny[n] = e->ny();
+					cl[n] = L; mm[n] = m; len[n] = e->length();
+					if ( ++n == W ) {
+						flushBlock(b, n, cl, 0, mm, len);
+						n = 0;
+					}
+				}
+			}
+			if ( n ) flushBlock(b, n, cl, 0, mm, len);
+			// Risolvo l'ODE (i membri arrivati al tempo finale hanno dt nullo)
+			for (size_t c = 0; c < mesh_.nP(); ++c) {
+				real_t invA = 1.0 / area_[c];
+				for (int i = 0; i < DIM; ++i)
+					for (size_t m = 0; m < K_; ++m)
+						sol_[idx(c,i,m)] = sol0_[idx(c,i,m)] - dt_[m] * invA * residual_[idx(c,i,m)];
+			}
+			// Aggiorno i tempi correnti
+			for (size_t m = 0; m < K_; ++m)
+				currtime_[m] += dt_[m];
+		}
+
+		template <typename MODEL, typename NUMFLUX>
+		void FiniteVolumeEnsemble<MODEL,NUMFLUX>::framegrab( size_t const m, size_t const id, bool gnuplot ) const {
+			// Nome del file
+			stringstream buffer;
+			buffer.fill('0');
+			buffer << datadir_ << "/solution" << std::setw(2) << m << "_" << std::setw(4) << id << ".dat";
+			// Apro il file
+			std::ofstream filehandle(buffer.str().c_str());
+			// Solo mesh triangolari
+			assert(mesh_.isTriangular());
+			if (!gnuplot) {
+				// Densita' interpolata ai vertici, nella numerazione originale
+				for ( size_t i = 0; i < mesh_.nV(); ++i ) {
+					vertex_ptr v = mesh_.vOrig(i);
+					SolType tmpsol = SolType::Zero();
+					size_t count(0);
+					vp_cit p = v->beginP();
+					do {
+						tmpsol += model_.ConservativeToPrimitive(state(sol_, p->getId(), m));
+						count++;
+						p++;
+					} while( p != v->beginP() );
+					tmpsol /= count;
+					filehandle << tmpsol[0] << std::endl;
+				}
+			} else {
+				// Soluzione non interpolata sui triangoli
+				for ( size_t i = 0; i < mesh_.nP(); ++i ) {
+					polygon_ptr p = mesh_.pOrig(i);
+					writeTriangle(filehandle, p, model_.ConservativeToPrimitive(state(sol_, p->getId(), m)));
+				}
+			}
+		}
+	}
+}
+
+#endif
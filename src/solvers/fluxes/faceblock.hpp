@@ -0,0 +1,132 @@
+#ifndef FACEBLOCK_HPP
+#define FACEBLOCK_HPP
+
+// Blocchi di lati in formato Structure-of-Arrays
+// per la valutazione vettoriale dei flussi numerici
+
+#include <cstddef>
+// Libreria EIGEN per l'Algebra
+#include <Eigen/Core>
+
+// Numero di lati per blocco (8 double = un registro AVX-512, due AVX2)
+#ifndef CONSLAW2D_BLOCK_WIDTH
+#define CONSLAW2D_BLOCK_WIDTH 8
+#endif
+
+// Scelta dell'instruction set a runtime (GCC >= 6 su x86-64):
+// il compilatore genera una versione del kernel per ogni ISA e
+// il loader sceglie quella adatta alla CPU
+#if defined(__GNUC__) && (__GNUC__ >= 6) && defined(__x86_64__) && !defined(CONSLAW2D_NO_TARGET_CLONES)
+#define CONSLAW2D_TARGET_CLONES __attribute__((target_clones("avx512f","avx2","default")))
+#else
+#define CONSLAW2D_TARGET_CLONES
+#endif
+
+// Le funzioni chiamate dentro i cicli sui lati di un blocco vanno espanse nel ciclo:
+// una chiamata rimasta nel corpo impedisce la vettorizzazione
+#if defined(__GNUC__)
+#define CONSLAW2D_ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#define CONSLAW2D_ALWAYS_INLINE inline
+#endif
+
+namespace ConservationLaw2D {
+	namespace NumericalFlux {
+
+		/*! \struct FaceBlock
+		\brief Blocco di lati in formato SoA: stati a sinistra e a destra, normali e flussi */
+		template <typename T, int DIM>
+		struct FaceBlock {
+			/*! \brief Numero di lati nel blocco */
+			enum { Width = CONSLAW2D_BLOCK_WIDTH };
+			/*! \brief Stato a sinistra, componente per componente */
+			T ql[DIM][Width];
+			/*! \brief Stato a destra, componente per componente */
+			T qr[DIM][Width];
+			/*! \brief Prima componente della normale */
+			T nx[Width];
+			/*! \brief Seconda componente della normale */
+			T ny[Width];
+			/*! \brief Flusso numerico in uscita */
+			T flux[DIM][Width];
+			/*! \brief Riempie i lati non utilizzati copiando il primo
+			\param[in] n Numero di lati validi nel blocco */
+			void pad( size_t n ) {
+				for (size_t k = n; k < size_t(Width); ++k) {
+					for (int i = 0; i < DIM; ++i) {
+						ql[i][k] = ql[i][0];
+						qr[i][k] = qr[i][0];
+					}
+					nx[k] = nx[0];
+					ny[k] = ny[0];
+				}
+			}
+		} EIGEN_ALIGN_128;
+
+		/*! \struct CachedFaceBlock
+		\brief Blocco di lati in formato SoA con le grandezze per cella gia' calcolate
+		(vedi Model::Eulero::CellCache) al posto degli stati conservati */
+		template <typename T, int DIM, int NC>
+		struct CachedFaceBlock {
+			/*! \brief Numero di lati nel blocco */
+			enum { Width = CONSLAW2D_BLOCK_WIDTH };
+			/*! \brief Cache della cella a sinistra, valore per valore */
+			T wl[NC][Width];
+			/*! \brief Cache della cella a destra, valore per valore */
+			T wr[NC][Width];
+			/*! \brief Prima componente della normale */
+			T nx[Width];
+			/*! \brief Seconda componente della normale */
+			T ny[Width];
+			/*! \brief Flusso numerico in uscita */
+			T flux[DIM][Width];
+			/*! \brief Riempie i lati non utilizzati copiando il primo
+			\param[in] n Numero di lati validi nel blocco */
+			void pad( size_t n ) {
+				for (size_t k = n; k < size_t(Width); ++k) {
+					for (int i = 0; i < NC; ++i) {
+						wl[i][k] = wl[i][0];
+						wr[i][k] = wr[i][0];
+					}
+					nx[k] = nx[0];
+					ny[k] = ny[0];
+				}
+			}
+		} EIGEN_ALIGN_128;
+
+		/*! \struct BlockFlux
+		\brief Valuta il flusso numerico su un blocco di lati
+
+		Versione generica: chiama il flusso scalare lato per lato. I flussi con un
+		kernel vettoriale dedicato specializzano questa struttura; quelli che accettano
+		anche un CachedFaceBlock lo segnalano con \c Cached = 1. */
+		template <typename NUMFLUX>
+		struct BlockFlux {
+			/*! \brief Vero se il flusso ha un kernel per CachedFaceBlock */
+			enum { Cached = 0 };
+			/*! \brief Calcola b.flux a partire da b.ql, b.qr e dalle normali */
+			template <typename T, int DIM>
+			static inline void eval( const NUMFLUX& f, FaceBlock<T,DIM>& b ) {
+				typedef Eigen::Matrix<T, DIM, 1> SolType;
+				SolType ql, qr, F;
+				for (int k = 0; k < FaceBlock<T,DIM>::Width; ++k) {
+					for (int i = 0; i < DIM; ++i) {
+						ql[i] = b.ql[i][k];
+						qr[i] = b.qr[i][k];
+					}
+					F = f(ql, qr, b.nx[k], b.ny[k]);
+					for (int i = 0; i < DIM; ++i)
+						b.flux[i][k] = F[i];
+				}
+			}
+		};
+
+		/*! \struct HybridFlux
+		\brief Vale 1 per i flussi ibridi (vedi NumericalFlux::Hybrid): il solutore divide i lati
+		per tipo e valuta ogni gruppo con il kernel del flusso corrispondente */
+		template <typename NUMFLUX>
+		struct HybridFlux { enum { value = 0 }; };
+	}
+}
+
+#endif
@@ -0,0 +1,332 @@
+#ifndef _SOLVER_REGISTRY_HPP
+#define _SOLVER_REGISTRY_HPP
+
+// Registro delle coppie modello/flusso selezionabili per nome a runtime
+
+// Modelli
+#include <models/eulero/eulero.hpp>
+#include <models/shallowwater/shallowwater.hpp>
+#include <models/acoustics/acoustics.hpp>
+// Flussi numerici
+#include <solvers/fluxes/laxfriedrichs.hpp>
+#include <models/eulero/fluxes/godunovROE.hpp>
+#include <models/eulero/fluxes/godunovHLL.hpp>
+#include <models/eulero/fluxes/godunovHLLC.hpp>
+#include <models/eulero/fluxes/rusanov.hpp>
+#include <models/eulero/fluxes/hybrid.hpp>
+#include <models/shallowwater/fluxes/godunovROE.hpp>
+#include <models/shallowwater/fluxes/godunovHLL.hpp>
+#include <models/acoustics/fluxes/godunov.hpp>
+// Solutore
+#include <solvers/finitevolume.hpp>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <functional>
+#include <type_traits>
+
+namespace ConservationLaw2D {
+	namespace Solver {
+
+		using namespace std;
+
+		/*! \class Simulation
+			\brief Interfaccia comune dei solutori scelti per nome (vedi Registry)
+
+			Il confine virtuale e' al livello del passo temporale: ogni chiamata (init(), timestep(),
+			framegrab(), ...) costa una chiamata indiretta, mentre i cicli su celle e lati restano
+			quelli di FiniteVolume<MODEL,NUMFLUX>, con il flusso numerico espanso inline.
+			Stati, condizioni iniziali e al bordo sono vettori di \c double di dimensione dim(),
+			in variabili primitive come nel modello (salvo getSol() e getTotals(), conservate). */
+		class Simulation {
+			public:
+				/*! \brief Mesh condivisa da tutti i solutori del registro */
+				typedef Mesh::DefaultTraits<double>::PolygonalMesh	FVMesh;
+				/*! \brief Condizione iniziale: colore, x, y, stato primitivo w in uscita */
+				typedef std::function<void( size_t, double, double, double* )>	InitFunction;
+				/*! \brief Condizione al bordo: stato primitivo interno wl, colore, x, y, nx, ny, t,
+				stato primitivo esterno wr in uscita */
+				typedef std::function<void( const double*, size_t, double, double, double, double, double, double* )>	BoundaryFunction;
+
+				virtual ~Simulation() {}
+
+				/*! \brief Nome della variante ("modello/flusso") */
+				virtual const string& name( void ) const = 0;
+				/*! \brief Dimensione dello spazio di stato */
+				virtual size_t dim( void ) const = 0;
+				/*! \brief Numero di celle */
+				virtual size_t nCells( void ) const = 0;
+
+				// Impostazioni (vedi FiniteVolume)
+				/*! \brief Imposta le condizioni iniziali */
+				virtual void setIC( const InitFunction& ic ) = 0;
+				/*! \brief Imposta le condizioni al bordo */
+				virtual void setBC( const BoundaryFunction& bc ) = 0;
+				/*! \brief Imposta il massimo CFL */
+				virtual void setCFLmax( double cflm ) = 0;
+				/*! \brief Imposta la directory nella quale sara' salvata la soluzione */
+				virtual void setDirectory( const string& dir ) = 0;
+				/*! \brief Imposta l'integratore in tempo (1, 2 o 3 stadi) */
+				virtual void setTimeIntegrator( size_t stages ) = 0;
+				/*! \brief Calcola i flussi una sola volta per lato, a blocchi vettoriali */
+				virtual void setBatchedFluxes( bool on ) = 0;
+				/*! \brief Esegue il ciclo sulle celle con n thread */
+				virtual void setThreads( size_t n, bool pin = true ) = 0;
+				/*! \brief La geometria della mesh e' gia' calcolata */
+				virtual void setGeometryReady( bool on ) = 0;
+				/*! \brief Nessun messaggio sullo standard output */
+				virtual void setQuiet( bool on ) = 0;
+				/*! \brief Aggiunge una sonda nel punto (x,y) */
+				virtual void addProbe( double x, double y ) = 0;
+				/*! \brief Aggiunge il segmento da (x0,y0) a (x1,y1) campionato con n punti */
+				virtual void addLine( double x0, double y0, double x1, double y1, size_t n ) = 0;
+				/*! \brief Registra sonde e linee su file ogni \c every passi */
+				virtual void setMonitor( const string& filename, size_t every = 1, bool binary = false ) = 0;
+				/*! \brief Pubblica lo stato in memoria condivisa ogni \c every passi */
+				virtual void setLiveFeed( const string& name, size_t every = 1, size_t slots = 3 ) = 0;
+
+				// Passi
+				/*! \brief Inizializza il solutore */
+				virtual void init( void ) = 0;
+				/*! \brief Esegue un passo temporale */
+				virtual void timestep( void ) = 0;
+
+				// Accesso
+				/*! \brief Restituisce il tempo corrente */
+				virtual double getCurrTime( void ) = 0;
+				/*! \brief Restituisce il passo temporale corrente */
+				virtual double getCurrDt( void ) = 0;
+				/*! \brief Restituisce il numero di chiamate a timestep() dall'inizializzazione */
+				virtual size_t getStep( void ) const = 0;
+				/*! \brief Copia in q lo stato (variabili conservate) dell'i-esimo poligono */
+				virtual void getSol( size_t i, double* q ) const = 0;
+				/*! \brief Copia in w lo stato in variabili primitive dell'i-esimo poligono */
+				virtual void getPrimitive( size_t i, double* w ) const = 0;
+				/*! \brief Copia in q l'integrale sul dominio delle variabili conservate */
+				virtual void getTotals( double* q ) = 0;
+				/*! \brief Salva un frame della soluzione */
+				virtual void framegrab( size_t id, bool gnuplot, bool interpolated ) const = 0;
+				/*! \brief Salva un frame della soluzione in formato VTK */
+				virtual void framegrabVTU( size_t id ) const = 0;
+		};
+
+		/*! \brief Parametri dei modelli per nome (es. "gamma") */
+		typedef map<string,double>	Parameters;
+
+		/*! \brief Valore del parametro, o quello di default se assente */
+		inline double parameter( const Parameters& p, const string& key, double def ) {
+			Parameters::const_iterator it = p.find(key);
+			return ( it == p.end() ) ? def : it->second;
+		}
+
+		/*! \brief Costruzione dei modelli dai parametri: una specializzazione per modello */
+		template <typename MODEL> struct ModelFactory;
+
+		template <typename T>
+		struct ModelFactory< Model::Eulero<T> > {
+			/*! \brief Parametri: \c gamma (1.4) */
+			static Model::Eulero<T> create( const Parameters& p ) { return Model::Eulero<T>(parameter(p, "gamma", 1.4)); }
+		};
+		template <typename T, bool BATHYMETRY>
+		struct ModelFactory< Model::ShallowWater<T,BATHYMETRY> > {
+			/*! \brief Parametri: \c hdry (1e-8) */
+			static Model::ShallowWater<T,BATHYMETRY> create( const Parameters& p ) {
+				return Model::ShallowWater<T,BATHYMETRY>(parameter(p, "hdry", 1e-8));
+			}
+		};
+		template <typename T>
+		struct ModelFactory< Model::LinearAcoustics<T> > {
+			/*! \brief Parametri: \c rho0 (1) e \c K0 (1) */
+			static Model::LinearAcoustics<T> create( const Parameters& p ) {
+				return Model::LinearAcoustics<T>(parameter(p, "rho0", 1.0), parameter(p, "K0", 1.0));
+			}
+		};
+
+		template <typename MODEL, typename NUMFLUX>
+		/*! \class RegisteredSolver
+			\brief FiniteVolume<MODEL,NUMFLUX> dietro l'interfaccia Simulation: possiede il modello
+			e adatta condizioni iniziali e al bordo ai vettori di \c double */
+		class RegisteredSolver : public Simulation {
+			private:
+				typedef FiniteVolume<MODEL,NUMFLUX>		FVSolver;
+				typedef typename MODEL::SolType			SolType;
+				typedef typename MODEL::real_t			real_t;
+				enum { DIM = SolType::RowsAtCompileTime };
+				static_assert(std::is_same<typename FVSolver::FVMesh, FVMesh>::value, "registered solvers must share the mesh type");
+			public:
+				RegisteredSolver( const string& name, FVMesh& mesh, const Parameters& p )
+					:name_(name),mesh_(mesh),model_(ModelFactory<MODEL>::create(p)),solver_(model_, mesh) {}
+
+				const string& name( void ) const { return name_; }
+				size_t dim( void ) const { return DIM; }
+				size_t nCells( void ) const { return mesh_.nP(); }
+
+				void setIC( const InitFunction& ic ) {
+					ic_ = ic;
+					solver_.setIC(std::bind(&RegisteredSolver::initial, this, std::placeholders::_1,
+						std::placeholders::_2, std::placeholders::_3));
+				}
+				void setBC( const BoundaryFunction& bc ) {
+					bc_ = bc;
+					solver_.setBC(std::bind(&RegisteredSolver::boundary, this, std::placeholders::_1, std::placeholders::_2,
+						std::placeholders::_3, std::placeholders::_4, std::placeholders::_5, std::placeholders::_6, std::placeholders::_7));
+				}
+				void setCFLmax( double cflm ) { solver_.setCFLmax(cflm); }
+				void setDirectory( const string& dir ) { solver_.setDirectory(dir); }
+				void setTimeIntegrator( size_t stages ) { solver_.setTimeIntegrator(stages); }
+				void setBatchedFluxes( bool on ) { solver_.setBatchedFluxes(on); }
+				void setThreads( size_t n, bool pin ) { solver_.setThreads(n, pin); }
+				void setGeometryReady( bool on ) { solver_.setGeometryReady(on); }
+				void setQuiet( bool on ) { solver_.setQuiet(on); }
+				void addProbe( double x, double y ) { solver_.addProbe(x, y); }
+				void addLine( double x0, double y0, double x1, double y1, size_t n ) { solver_.addLine(x0, y0, x1, y1, n); }
+				void setMonitor( const string& filename, size_t every, bool binary ) { solver_.setMonitor(filename, every, binary); }
+				void setLiveFeed( const string& name, size_t every, size_t slots ) { solver_.setLiveFeed(name, every, slots); }
+
+				void init( void ) { solver_.init(); }
+				void timestep( void ) { solver_.timestep(); }
+
+				double getCurrTime( void ) { return solver_.getCurrTime(); }
+				double getCurrDt( void ) { return solver_.getCurrDt(); }
+				size_t getStep( void ) const { return solver_.getStep(); }
+				void getSol( size_t i, double* q ) const { copy(solver_.getSol(i), q); }
+				void getPrimitive( size_t i, double* w ) const { copy(model_.ConservativeToPrimitive(solver_.getSol(i)), w); }
+				void getTotals( double* q ) { copy(solver_.getTotals(), q); }
+				void framegrab( size_t id, bool gnuplot, bool interpolated ) const { solver_.framegrab(id, gnuplot, interpolated); }
+				void framegrabVTU( size_t id ) const { solver_.framegrabVTU(id); }
+
+				/*! \brief Solutore tipizzato, per le impostazioni specifiche della variante */
+				FVSolver& solver( void ) { return solver_; }
+
+			private:
+				static inline void copy( const SolType& s, double* v ) {
+					for (int k = 0; k < DIM; ++k) v[k] = s[k];
+				}
+				// Adattatori per FiniteVolume: chiamati solo all'inizializzazione e sui lati di bordo
+				SolType initial( size_t color, real_t x, real_t y ) const {
+					double w[DIM];
+					ic_(color, x, y, w);
+					SolType s;
+					for (int k = 0; k < DIM; ++k) s[k] = w[k];
+					return s;
+				}
+				SolType boundary( SolType& wl, size_t color, real_t x, real_t y, real_t nx, real_t ny, real_t t ) const {
+					double l[DIM], r[DIM];
+					copy(wl, l);
+					bc_(l, color, x, y, nx, ny, t, r);
+					SolType s;
+					for (int k = 0; k < DIM; ++k) s[k] = r[k];
+					return s;
+				}
+
+				string name_;
+				FVMesh& mesh_;
+				MODEL model_;
+				FVSolver solver_;
+				InitFunction ic_;
+				BoundaryFunction bc_;
+		};
+
+		/*! \class Registry
+			\brief Registro delle varianti FiniteVolume<MODEL,NUMFLUX> compilate nel programma, scelte per nome
+
+			Ogni variante registrata con add() istanzia per intero il proprio solutore, con il flusso
+			espanso nei cicli sui lati: un solo eseguibile contiene tutte le combinazioni e la scelta
+			a runtime costa una chiamata virtuale per passo. Il registro globale (instance()) contiene
+			i modelli \c euler, \c shallowwater e \c acoustics in doppia precisione con i loro flussi;
+			il primo flusso registrato per un modello e' quello di default.
+			\warning add() non e' protetto da lock: le registrazioni vanno fatte prima di usare il
+			registro da piu' thread */
+		class Registry {
+			public:
+				/*! \brief Costruttore di una variante sulla mesh data */
+				typedef std::shared_ptr<Simulation> (*Factory)( const string&, Simulation::FVMesh&, const Parameters& );
+
+				/*! \brief Registro con le varianti predefinite */
+				static Registry& instance( void ) {
+					static Registry registry(true);
+					return registry;
+				}
+				/*! \brief Registro vuoto */
+				Registry() {}
+
+				/*! \brief Registra la variante FiniteVolume<MODEL,NUMFLUX> come "model/flux" */
+				template <typename MODEL, typename NUMFLUX>
+				void add( const string& model, const string& flux ) {
+					const string name = model + "/" + flux;
+					if ( factories_.find(name) == factories_.end() ) names_.push_back(name);
+					factories_[name] = &build<MODEL,NUMFLUX>;
+					if ( defaults_.find(model) == defaults_.end() ) defaults_[model] = flux;
+				}
+				/*! \brief Vero se la variante esiste (flusso vuoto: flusso di default del modello) */
+				bool has( const string& model, const string& flux = "" ) const {
+					return factories_.find(key(model, flux)) != factories_.end();
+				}
+				/*! \brief Crea la variante "model/flux" sulla mesh data (puntatore nullo se non esiste)
+				\param[in] flux Nome del flusso (vuoto: flusso di default del modello) */
+				std::shared_ptr<Simulation> create( const string& model, const string& flux, Simulation::FVMesh& mesh,
+					const Parameters& p = Parameters() ) const {
+					const string name = key(model, flux);
+					map<string,Factory>::const_iterator it = factories_.find(name);
+					if ( it == factories_.end() ) return std::shared_ptr<Simulation>();
+					return it->second(name, mesh, p);
+				}
+				/*! \brief Nomi delle varianti, in ordine di registrazione */
+				const vector<string>& names( void ) const { return names_; }
+				/*! \brief Stampa le varianti disponibili
+				\param[in] model Se non vuoto, stampa solo i flussi di questo modello (senza "model/") */
+				void list( std::ostream& out, const string& model = "" ) const {
+					const string prefix = model + "/";
+					bool first = true;
+					for (size_t i = 0; i < names_.size(); ++i) {
+						if ( !model.empty() && names_[i].compare(0, prefix.size(), prefix) != 0 ) continue;
+						out << (first ? "" : " ") << ( model.empty() ? names_[i] : names_[i].substr(prefix.size()) );
+						first = false;
+					}
+					out << std::endl;
+				}
+
+			private:
+				explicit Registry( bool defaults ) { if ( defaults ) addDefaults(); }
+				string key( const string& model, const string& flux ) const {
+					if ( !flux.empty() ) return model + "/" + flux;
+					map<string,string>::const_iterator it = defaults_.find(model);
+					return ( it == defaults_.end() ) ? model + "/" : model + "/" + it->second;
+				}
+				template <typename MODEL, typename NUMFLUX>
+				static std::shared_ptr<Simulation> build( const string& name, Simulation::FVMesh& mesh, const Parameters& p ) {
+					return std::shared_ptr<Simulation>(new RegisteredSolver<MODEL,NUMFLUX>(name, mesh, p));
+				}
+				void addDefaults( void );
+
+				map<string,Factory> factories_;
+				map<string,string> defaults_;
+				vector<string> names_;
+		};
+
+		// ===========
+		// DEFINITIONS
+		// ===========
+
+		inline void Registry::addDefaults( void ) {
+			typedef Model::Eulero<double>			Euler;
+			typedef Model::ShallowWater<double>		ShallowWater;
+			typedef Model::LinearAcoustics<double>	Acoustics;
+			add< Euler, NumericalFlux::GodunovRoe<Euler> >("euler", "roe");
+			add< Euler, NumericalFlux::GodunovHLL<Euler> >("euler", "hll");
+			add< Euler, NumericalFlux::GodunovHLLC<Euler> >("euler", "hllc");
+			add< Euler, NumericalFlux::Rusanov<Euler> >("euler", "rusanov");
+			add< Euler, NumericalFlux::LaxFriedrichs<Euler> >("euler", "laxfriedrichs");
+			add< Euler, NumericalFlux::Hybrid<Euler> >("euler", "hybrid");
+			add< ShallowWater, NumericalFlux::GodunovHLL<ShallowWater> >("shallowwater", "hll");
+			add< ShallowWater, NumericalFlux::GodunovRoe<ShallowWater> >("shallowwater", "roe");
+			add< ShallowWater, NumericalFlux::LaxFriedrichs<ShallowWater> >("shallowwater", "laxfriedrichs");
+			add< Acoustics, NumericalFlux::Godunov<Acoustics> >("acoustics", "godunov");
+			add< Acoustics, NumericalFlux::LaxFriedrichs<Acoustics> >("acoustics", "laxfriedrichs");
+		}
+	}
+}
+
+#endif
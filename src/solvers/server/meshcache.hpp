@@ -0,0 +1,182 @@
+#ifndef _SERVER_MESHCACHE_HPP
+#define _SERVER_MESHCACHE_HPP
+
+// Cache delle mesh lette, con la geometria gia' calcolata, indicizzate con il checksum del file
+
+#include <map>
+#include <string>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <mesh/io/meshreader.hpp>
+
+namespace ConservationLaw2D {
+	namespace Solver {
+
+		using namespace std;
+
+		template <typename MESH>
+		/*! \class MeshCache
+			\brief Mesh lette una sola volta e condivise tra piu' solutori
+
+			La chiave e' il checksum (FNV-1a a 64 bit) del contenuto del file: file uguali con nomi
+			diversi condividono la stessa mesh, un file modificato viene riletto. Il checksum di un file
+			viene ricalcolato solo se dimensione o data di modifica (stat()) sono cambiate dalla richiesta
+			precedente. Alla lettura viene calcolata anche la geometria (init_geom()). Piu' thread
+			possono chiedere la stessa mesh: il primo la legge, gli altri attendono. Oltre la capacita'
+			viene scartata la mesh usata meno di recente; le mesh ancora in uso restano valide finche'
+			i solutori le tengono.
+			\warning Le mesh sono condivise: i solutori non devono modificarle (vedi
+			FiniteVolume::setGeometryReady()) */
+		class MeshCache {
+			public:
+				/*! \brief Puntatore condiviso a una mesh della cache */
+				typedef std::shared_ptr<MESH>	mesh_ptr;
+
+				/*! \brief Costruttore
+				\param[in] capacity Numero massimo di mesh in memoria */
+				MeshCache( size_t capacity = 8 ):capacity_(max(capacity, size_t(1))),clock_(0),hits_(0),misses_(0) {}
+
+				/*! \brief Restituisce la mesh del file, leggendola solo se non e' gia' in memoria
+				\param[in] filename Nome del file
+				\param[out] key Checksum del file
+				\param[out] hit Vero se la mesh era gia' in memoria
+				\return Mesh (nulla se il file non si puo' leggere) */
+				mesh_ptr get( const string& filename, uint64_t& key, bool& hit );
+				/*! \brief Checksum FNV-1a a 64 bit del contenuto del file
+				\return Falso se il file non si puo' leggere */
+				static bool checksum( const string& filename, uint64_t& key );
+
+				/*! \brief Numero di mesh in memoria */
+				size_t size( void ) { std::lock_guard<std::mutex> lock(mutex_); return entries_.size(); }
+				/*! \brief Numero di richieste servite dalla memoria */
+				size_t hits( void ) { std::lock_guard<std::mutex> lock(mutex_); return hits_; }
+				/*! \brief Numero di mesh lette da file */
+				size_t misses( void ) { std::lock_guard<std::mutex> lock(mutex_); return misses_; }
+
+			private:
+				struct Entry {
+					mesh_ptr mesh;
+					bool ready;
+					size_t lastUse;
+				};
+				// Checksum dell'ultima lettura di un file, valido finche' dimensione e data non cambiano
+				struct Stamp {
+					off_t size;
+					time_t sec;
+					long nsec;
+					uint64_t key;
+				};
+				// Checksum del file, ricalcolato solo se il file e' cambiato
+				bool fileKey( const string& filename, uint64_t& key );
+				size_t capacity_, clock_, hits_, misses_;
+				map<uint64_t, Entry> entries_;
+				map<string, Stamp> stamps_;
+				std::mutex mutex_;
+				std::condition_variable loaded_;
+		};
+
+		// ===========
+		// DEFINITIONS
+		// ===========
+
+		template <typename MESH>
+		bool MeshCache<MESH>::checksum( const string& filename, uint64_t& key ) {
+			std::ifstream in(filename.c_str(), std::ios::binary);
+			if ( !in ) return false;
+			key = 14695981039346656037ULL;
+			char buffer[65536];
+			while ( in ) {
+				in.read(buffer, sizeof(buffer));
+				const std::streamsize n = in.gcount();
+				for (std::streamsize i = 0; i < n; ++i) {
+					key ^= uint64_t(static_cast<unsigned char>(buffer[i]));
+					key *= 1099511628211ULL;
+				}
+			}
+			return true;
+		}
+
+		template <typename MESH>
+		bool MeshCache<MESH>::fileKey( const string& filename, uint64_t& key ) {
+			struct stat st;
+			if ( stat(filename.c_str(), &st) != 0 )
+				return false;
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				typename map<string, Stamp>::const_iterator it = stamps_.find(filename);
+				if ( it != stamps_.end() && it->second.size == st.st_size
+					&& it->second.sec == st.st_mtim.tv_sec && it->second.nsec == st.st_mtim.tv_nsec ) {
+					key = it->second.key;
+					return true;
+				}
+			}
+			// Lettura senza il lock; se il file cambia intanto, la data salvata e' quella vecchia
+			// e la prossima richiesta ricalcola il checksum
+			if ( !checksum(filename, key) )
+				return false;
+			std::lock_guard<std::mutex> lock(mutex_);
+			Stamp& stamp = stamps_[filename];
+			stamp.size = st.st_size;
+			stamp.sec = st.st_mtim.tv_sec;
+			stamp.nsec = st.st_mtim.tv_nsec;
+			stamp.key = key;
+			return true;
+		}
+
+		template <typename MESH>
+		typename MeshCache<MESH>::mesh_ptr MeshCache<MESH>::get( const string& filename, uint64_t& key, bool& hit ) {
+			hit = false;
+			if ( !fileKey(filename, key) )
+				return mesh_ptr();
+			std::unique_lock<std::mutex> lock(mutex_);
+			typename map<uint64_t, Entry>::iterator it = entries_.find(key);
+			if ( it != entries_.end() ) {
+				// Letta o in lettura da un altro thread
+				while ( !it->second.ready ) {
+					loaded_.wait(lock);
+					it = entries_.find(key);
+					if ( it == entries_.end() ) return mesh_ptr();
+				}
+				it->second.lastUse = ++clock_;
+				hits_++;
+				hit = true;
+				return it->second.mesh;
+			}
+			// Scarto la mesh usata meno di recente (tra quelle gia' pronte)
+			if ( entries_.size() >= capacity_ ) {
+				typename map<uint64_t, Entry>::iterator old = entries_.end();
+				for (it = entries_.begin(); it != entries_.end(); ++it)
+					if ( it->second.ready && (old == entries_.end() || it->second.lastUse < old->second.lastUse) )
+						old = it;
+				if ( old != entries_.end() ) {
+					// Anche i file che puntavano alla mesh scartata
+					for (typename map<string, Stamp>::iterator s = stamps_.begin(); s != stamps_.end(); )
+						if ( s->second.key == old->first ) stamps_.erase(s++);
+						else ++s;
+					entries_.erase(old);
+				}
+			}
+			Entry& e = entries_[key];
+			e.ready = false;
+			e.lastUse = ++clock_;
+			misses_++;
+			// Lettura senza il lock: le altre mesh restano disponibili
+			lock.unlock();
+			mesh_ptr mesh(new MESH);
+			Mesh::IO::MeshReader(*mesh, filename);
+			mesh->init_geom();
+			lock.lock();
+			Entry& done = entries_[key];
+			done.mesh = mesh;
+			done.ready = true;
+			loaded_.notify_all();
+			return mesh;
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef _SERVER_WORKERPOOL_HPP
+#define _SERVER_WORKERPOOL_HPP
+
+// Gruppo di thread che eseguono lavori indipendenti da una coda
+
+#include <deque>
+#include <vector>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+
+namespace ConservationLaw2D {
+	namespace Solver {
+
+		using namespace std;
+
+		/*! \class WorkerPool
+			\brief Coda di lavori eseguiti da un numero fisso di thread, nell'ordine di arrivo
+
+			A differenza di ThreadTeam (tutti i thread sulla stessa funzione, parti diverse delle celle)
+			ogni lavoro e' eseguito per intero da un solo thread: serve per piu' simulazioni indipendenti
+			in contemporanea. */
+		class WorkerPool {
+			public:
+				/*! \brief Costruttore, avvia n thread */
+				explicit WorkerPool( size_t n ):running_(0),stop_(false) {
+					for (size_t t = 0; t < max(n, size_t(1)); ++t)
+						threads_.push_back(std::thread(&WorkerPool::worker, this));
+				}
+				/*! \brief Distruttore, esegue i lavori in coda e termina i thread */
+				~WorkerPool() {
+					{
+						std::lock_guard<std::mutex> lock(mutex_);
+						stop_ = true;
+					}
+					work_.notify_all();
+					for (size_t t = 0; t < threads_.size(); ++t)
+						threads_[t].join();
+				}
+
+				/*! \brief Accoda un lavoro */
+				void submit( const std::function<void()>& job ) {
+					{
+						std::lock_guard<std::mutex> lock(mutex_);
+						queue_.push_back(job);
+					}
+					work_.notify_one();
+				}
+				/*! \brief Attende che la coda sia vuota e tutti i lavori finiti */
+				void wait( void ) {
+					std::unique_lock<std::mutex> lock(mutex_);
+					while ( !queue_.empty() || running_ > 0 )
+						idle_.wait(lock);
+				}
+				/*! \brief Numero di thread */
+				size_t size( void ) const { return threads_.size(); }
+				/*! \brief Numero di lavori in coda o in esecuzione */
+				size_t pending( void ) {
+					std::lock_guard<std::mutex> lock(mutex_);
+					return queue_.size() + running_;
+				}
+
+			private:
+				WorkerPool( const WorkerPool& );
+				WorkerPool& operator=( const WorkerPool& );
+				void worker( void ) {
+					for (;;) {
+						std::function<void()> job;
+						{
+							std::unique_lock<std::mutex> lock(mutex_);
+							while ( !stop_ && queue_.empty() )
+								work_.wait(lock);
+							if ( queue_.empty() ) return;
+							job = queue_.front();
+							queue_.pop_front();
+							running_++;
+						}
+						job();
+						std::lock_guard<std::mutex> lock(mutex_);
+						running_--;
+						if ( queue_.empty() && running_ == 0 )
+							idle_.notify_all();
+					}
+				}
+				vector<std::thread> threads_;
+				deque< std::function<void()> > queue_;
+				size_t running_;
+				bool stop_;
+				std::mutex mutex_;
+				std::condition_variable work_, idle_;
+		};
+	}
+}
+
+#endif
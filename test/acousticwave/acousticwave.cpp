@@ -37,13 +37,14 @@ inline SolType bc( SolType& wl, size_t color, real_t x, real_t y, real_t nx, rea
 
 int main(int argc, char **argv) {
 	// Parametri in ingresso
-	bool gnuplot(false), interpolated(false);
+	bool gnuplot(false), interpolated(false), linear(false);
 	string meshfile;
 	if ( argc < 2 ) {
 		cout << "Usage: " << argv[0] << " [options] meshfile.msh" << endl;
 		cout << "Options:" << endl;
 		cout << "  --gnuplot\t\tGenerate plot and animation from gnuplot" << endl;
 		cout << "  --interpolated\t\tInterpolate solution on vertices" << endl;
+		cout << "  --linear\t\tAssemble the timestep as a sparse matrix" << endl;
 		exit(1);
 	}
 	for (int i=1; i<argc; ++i) {
@@ -51,6 +52,8 @@ int main(int argc, char **argv) {
 			gnuplot = true;
 		else if (!strcmp(argv[i],"--interpolated"))
 			interpolated = true;
+		else if (!strcmp(argv[i],"--linear"))
+			linear = true;
 		else
 			meshfile = argv[i];
 	}
@@ -66,15 +69,18 @@ int main(int argc, char **argv) {
 	solver.setCFLmax(0.1);
 	solver.setIC(init);
 	solver.setBC(bc);
+	solver.setLinearOperator(linear);
 	// Inizializzo il solutore
 	solver.init();
 	solver.setDirectory("./data");
 	// Passi temporali
+	clock_t start = clock();
 	for (int i = 0; i < 1000; ++i) {
 		std::cout << "== Timestep " << i << " == currtime: " << std::setw(8) << solver.getCurrTime();
 		std::cout << ", dt = " << std::setw(8) << solver.getCurrDt() << std::endl;
 		solver.timestep();
 		if (i%50 == 0) solver.framegrab(i/50, gnuplot, interpolated);
 	}
+	std::cout << "Elapsed time: " << double(clock()-start)/CLOCKS_PER_SEC << " s" << std::endl;
 	return EXIT_SUCCESS;
 }
@@ -9,16 +9,20 @@ if (@ARGV < 1) {
 	print("Options:\n");
 	print("  --gnuplot\t\tGenerate plot and animation from gnuplot\n");
 	print("  --interpolated\t\tInterpolate solution on vertices\n");
+	print("  --linear\t\tAssemble the timestep as a sparse matrix\n");
 	exit();
 }
 my $meshfile;
 $gnuplot = false;
 $interpolated = false;
+$linear = false;
 foreach $arg (@ARGV) {
 	if ($arg eq "--gnuplot") {
 		$gnuplot = true;
 	} elsif($arg eq "--interpolated") {
 		$interpolated = true;
+	} elsif($arg eq "--linear") {
+		$linear = true;
 	} else {
 		$meshfile = $arg;
 	}
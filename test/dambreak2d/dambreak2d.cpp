@@ -1,5 +1,7 @@
 #include <models/shallowwater/shallowwater.hpp>
 #include <solvers/fluxes/laxfriedrichs.hpp>
+#include <models/shallowwater/fluxes/godunovHLL.hpp>
+#include <models/shallowwater/fluxes/godunovROE.hpp>
 #include <solvers/finitevolume.hpp>
 #include <mesh/io/meshreader.hpp>
 
@@ -15,23 +17,46 @@ typedef Model::ShallowWater<real_t>              myModel;
 typedef NumericalFlux::LaxFriedrichs<myModel>    myNumFlux;
 typedef Solver::FiniteVolume<myModel,myNumFlux>  mySolver;
 typedef mySolver::FVMesh                         myMesh;
+// Flussi dedicati (stessa mesh)
+typedef Solver::FiniteVolume<myModel,NumericalFlux::GodunovHLL<myModel> >  myHLLSolver;
+typedef Solver::FiniteVolume<myModel,NumericalFlux::GodunovRoe<myModel> >  myRoeSolver;
+// Modello con batimetria: stato (h, hu, hv, z)
+typedef Model::ShallowWater<real_t,true>                                   myBathModel;
+typedef Solver::FiniteVolume<myBathModel,NumericalFlux::GodunovHLL<myBathModel> >  myBathSolver;
+typedef myBathSolver::FVMesh                                               myBathMesh;
 
 // Tipo per la soluzione (vettore d-dim)
 typedef myModel::SolType	SolType;
+typedef myBathModel::SolType	BathSolType;
 
-// Stato iniziale in variabili (rho,u,v)
+// Fondo asciutto a valle della diga
+static bool dryBed = false;
+
+// Stato iniziale in variabili (h,u,v)
 inline SolType init( size_t color, real_t x, real_t y ) {
 	SolType sol = SolType::Zero();
-	// rho, u, v
-	sol[0] = ( x < 0 ) ? 4.0 : 1.0;
+	// h, u, v
+	sol[0] = ( x < 0 ) ? 4.0 : ( dryBed ? 0.0 : 1.0 );
+	sol[1] = 0.0;
+	sol[2] = 0.0;
+	return sol;
+}
+
+// Lago in quiete con un dosso che emerge: stato iniziale in variabili (h,u,v,z)
+inline BathSolType initLake( size_t color, real_t x, real_t y ) {
+	BathSolType sol = BathSolType::Zero();
+	// z, h = max(0, livello - z), u, v
+	sol[3] = 1.2*exp(-10*((x-0.5)*(x-0.5)+y*y));
+	sol[0] = max(0.0, 1.0 - sol[3]);
 	sol[1] = 0.0;
 	sol[2] = 0.0;
 	return sol;
 }
 
 // Condizioni al bordo
-inline SolType bc( SolType& wl, size_t color, real_t x, real_t y, real_t nx, real_t ny, real_t t ) {
-	SolType wr = SolType::Zero();
+template <typename SOL>
+inline SOL bc( SOL& wl, size_t color, real_t x, real_t y, real_t nx, real_t ny, real_t t ) {
+	SOL wr = wl;
 	switch (color) {
 		case 8:
 		case 11:
@@ -40,37 +65,103 @@ inline SolType bc( SolType& wl, size_t color, real_t x, real_t y, real_t nx, rea
 		case 18:
 		case 13:
 			// Riflettente
-			wr[0] = wl[0];
 			wr[1] = (ny*ny-nx*nx)*wl[1] - 2*nx*ny*wl[2];
 			wr[2] = - 2*nx*ny*wl[1] + (nx*nx-ny*ny)*wl[2];
 			break;
 		default:
 			// Assorbente
-			wr = wl;
 			break;
 	}
 	return wr;
 }
 
+// Avanza la simulazione del dam break con il solutore dato
+template <typename SOLVER>
+void run( SOLVER& solver, real_t cfl, bool tracking, bool gnuplot, bool interpolated ) {
+	solver.setCFLmax(cfl);
+	solver.setIC(init);
+	solver.setBC(bc<SolType>);
+	solver.setActivityTracking(tracking);
+	solver.init();
+	solver.setDirectory("./data");
+	// Passi temporali
+	for (int i = 0; i < 1000; ++i) {
+		std::cout << "== Timestep " << i << " == currtime: " << std::setw(8) << solver.getCurrTime();
+		std::cout << ", dt = " << std::setw(8) << solver.getCurrDt();
+		if (tracking) std::cout << ", active = " << solver.getActiveCount();
+		std::cout << std::endl;
+		solver.timestep();
+		if (i%50 == 0) solver.framegrab(i/50, gnuplot, interpolated);
+	}
+}
+
+// Lago in quiete su fondo non piatto: la ricostruzione idrostatica deve mantenere
+// la velocita' nulla anche sul bordo asciutto del dosso
+int validateLake( const string& meshfile, real_t cfl ) {
+	myBathModel model;
+	myBathMesh mesh;
+	Mesh::IO::MeshReader(mesh, meshfile);
+	myBathSolver solver(model, mesh);
+	solver.setCFLmax(cfl);
+	solver.setIC(initLake);
+	solver.setBC(bc<BathSolType>);
+	solver.init();
+	for (int i = 0; i < 500; ++i)
+		solver.timestep();
+	real_t umax(0), etamax(0);
+	size_t dry(0);
+	for (size_t i = 0; i < mesh.nP(); ++i) {
+		BathSolType q = solver.getSol(i);
+		umax = max(umax, sqrt(model.U(q)*model.U(q) + model.V(q)*model.V(q)));
+		if ( model.Dry(q) ) {
+			++dry;
+			continue;
+		}
+		etamax = max(etamax, fabs(q[0] + q[3] - 1.0));
+	}
+	cout << "== Lake at rest ==" << endl;
+	cout << " Time: " << solver.getCurrTime() << ", dry cells: " << dry << " of " << mesh.nP() << endl;
+	cout << " Max velocity: " << umax << ", max free surface error: " << etamax << endl;
+	return ( umax < 1e-10 && etamax < 1e-10 ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
 int main(int argc, char **argv) {
 	// Parametri in ingresso
-	bool gnuplot(false), interpolated(false);
-	string meshfile;
+	bool gnuplot(false), interpolated(false), tracking(false), lake(false);
+	string meshfile, flux("lf");
+	real_t cfl(0.1);
 	if ( argc < 2 ) {
 		cout << "Usage: " << argv[0] << " [options] meshfile.msh" << endl;
 		cout << "Options:" << endl;
 		cout << "  --gnuplot\t\tGenerate plot and animation from gnuplot" << endl;
 		cout << "  --interpolated\t\tInterpolate solution on vertices" << endl;
+		cout << "  --tracking\t\tUpdate only disturbed cells" << endl;
+		cout << "  --flux NAME\t\tNumerical flux: lf (default), hll, roe" << endl;
+		cout << "  --cfl C\t\tCFL number (default 0.1)" << endl;
+		cout << "  --dry\t\t\tDry bed downstream of the dam" << endl;
+		cout << "  --validate-lake\tCheck lake at rest over an emerging bump" << endl;
 		exit(1);
 	}
 	for (int i=1; i<argc; ++i) {
-		if (!strcmp(argv[i],"--gnuplot")) 
+		if (!strcmp(argv[i],"--gnuplot"))
 			gnuplot = true;
 		else if (!strcmp(argv[i],"--interpolated"))
 			interpolated = true;
+		else if (!strcmp(argv[i],"--tracking"))
+			tracking = true;
+		else if (!strcmp(argv[i],"--flux") && i+1 < argc)
+			flux = argv[++i];
+		else if (!strcmp(argv[i],"--cfl") && i+1 < argc)
+			cfl = atof(argv[++i]);
+		else if (!strcmp(argv[i],"--dry"))
+			dryBed = true;
+		else if (!strcmp(argv[i],"--validate-lake"))
+			lake = true;
 		else
 			meshfile = argv[i];
 	}
+	if (lake)
+		return validateLake(meshfile, cfl);
 	// Definisco il modello
 	myModel model;
 	// Definisco la mesh
@@ -78,19 +169,18 @@ int main(int argc, char **argv) {
 	// Leggo la mesh
 	Mesh::IO::MeshReader(mesh, meshfile);
 	// Definisco il solutore per il mio modello
-	mySolver solver(model, mesh);
-	// Inizializzo alcuni parametri
-	solver.setCFLmax(0.1);
-	solver.setIC(init);
-	solver.setBC(bc);
-	solver.init();
-	solver.setDirectory("./data");
-	// Passi temporali
-	for (int i = 0; i < 1000; ++i) {
-		std::cout << "== Timestep " << i << " == currtime: " << std::setw(8) << solver.getCurrTime();
-		std::cout << ", dt = " << std::setw(8) << solver.getCurrDt() << std::endl;
-		solver.timestep();
-		if (i%50 == 0) solver.framegrab(i/50, gnuplot, interpolated);
+	if ( flux == "lf" ) {
+		mySolver solver(model, mesh);
+		run(solver, cfl, tracking, gnuplot, interpolated);
+	} else if ( flux == "hll" ) {
+		myHLLSolver solver(model, mesh);
+		run(solver, cfl, tracking, gnuplot, interpolated);
+	} else if ( flux == "roe" ) {
+		myRoeSolver solver(model, mesh);
+		run(solver, cfl, tracking, gnuplot, interpolated);
+	} else {
+		cerr << "Unknown flux " << flux << endl;
+		exit(1);
 	}
 	return 0;
 }
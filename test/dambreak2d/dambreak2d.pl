@@ -9,16 +9,40 @@ if (@ARGV < 1) {
 	print("Options:\n");
 	print("  --gnuplot\t\tGenerate plot and animation from gnuplot\n");
 	print("  --interpolated\t\tInterpolate solution on vertices\n");
+	print("  --tracking\t\tUpdate only disturbed cells\n");
+	print("  --flux NAME\t\tNumerical flux: lf (default), hll, roe\n");
+	print("  --cfl C\t\tCFL number (default 0.1)\n");
+	print("  --dry\t\t\tDry bed downstream of the dam\n");
+	print("  --validate-lake\tCheck lake at rest over an emerging bump\n");
 	exit();
 }
 my $meshfile;
 $gnuplot = false;
 $interpolated = false;
+$tracking = false;
+$flux = "lf";
+$cfl = 0.1;
+$nextflux = false;
+$nextcfl = false;
 foreach $arg (@ARGV) {
-	if ($arg eq "--gnuplot") {
+	if ($nextflux eq true) {
+		$flux = $arg;
+		$nextflux = false;
+	} elsif ($nextcfl eq true) {
+		$cfl = $arg;
+		$nextcfl = false;
+	} elsif ($arg eq "--gnuplot") {
 		$gnuplot = true;
 	} elsif($arg eq "--interpolated") {
 		$interpolated = true;
+	} elsif($arg eq "--tracking") {
+		$tracking = true;
+	} elsif($arg eq "--flux") {
+		$nextflux = true;
+	} elsif($arg eq "--cfl") {
+		$nextcfl = true;
+	} elsif($arg eq "--dry" or $arg eq "--validate-lake") {
+		# passati direttamente al programma
 	} else {
 		$meshfile = $arg;
 	}
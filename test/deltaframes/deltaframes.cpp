@@ -0,0 +1,98 @@
+#include <solvers/finitevolume/deltaframes.hpp>
+#include <solvers/finitevolume/gnuplotwriter.hpp>
+#include <Eigen/Core>
+#include <mesh/mesh_default_traits.hpp>
+#include <mesh/io/meshreader.hpp>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+
+using namespace std;
+using namespace ConservationLaw2D;
+
+// Lettore di riferimento dei frame incrementali (es. ./shockbubble --delta 1e-4 meshfile.msh
+// e poi ./deltaframes --mesh meshfile.msh --out frame.dat data 12)
+
+typedef Mesh::DefaultTraits<double>::PolygonalMesh	myMesh;
+
+// Triangoli nella numerazione originale con lo stato della cella, come framegrab (non interpolato)
+void writeFrame( const string& filename, const myMesh& mesh, const vector<double>& w, size_t dim ) {
+	ofstream out(filename.c_str());
+	Eigen::Matrix<double,Eigen::Dynamic,1> sol(dim);
+	for (size_t i = 0; i < mesh.nP(); ++i) {
+		for (size_t d = 0; d < dim; ++d)
+			sol[d] = w[i*dim+d];
+		Solver::writeTriangle(out, mesh.p(i), sol);
+	}
+}
+
+int main(int argc, char **argv) {
+	if ( argc < 3 ) {
+		cout << "Usage: " << argv[0] << " [options] DIR FRAME" << endl;
+		cout << "Options:" << endl;
+		cout << "  --mesh file.msh\tMesh of the run, needed by --out" << endl;
+		cout << "  --out file\t\tWrite the frame in the framegrab format (gnuplot, not interpolated)" << endl;
+		cout << "  --list N\t\tPrint kind and written cells of frames 0..N-1" << endl;
+		exit(1);
+	}
+	string dir, meshfile, outfile;
+	size_t frame(0), list(0);
+	vector<string> args;
+	for (int i=1; i<argc; ++i) {
+		if (!strcmp(argv[i],"--mesh") && i+1 < argc)
+			meshfile = argv[++i];
+		else if (!strcmp(argv[i],"--out") && i+1 < argc)
+			outfile = argv[++i];
+		else if (!strcmp(argv[i],"--list") && i+1 < argc)
+			list = atoi(argv[++i]);
+		else
+			args.push_back(argv[i]);
+	}
+	if ( args.size() != 2 ) {
+		cerr << "Expected the frame directory and the frame number" << endl;
+		return EXIT_FAILURE;
+	}
+	dir = args[0];
+	frame = atoi(args[1].c_str());
+	// Elenco dei frame: completi o incrementali, celle scritte
+	for (size_t k = 0; k < list; ++k) {
+		Solver::DeltaFrameHeader h;
+		if ( !Solver::DeltaFrameReader::header(Solver::DeltaFrameWriter::fileName(dir, k), h) )
+			break;
+		cout << "Frame " << k << ( h.base == k ? " key  " : " delta" ) << " step " << h.step << " time " << h.time
+			<< " cells " << h.count << "/" << h.ncells << endl;
+	}
+	Solver::DeltaFrameReader reader;
+	vector<double> w;
+	size_t step;
+	double time;
+	if ( !reader.read(dir, frame, w, step, time) ) {
+		cerr << "Cannot reconstruct frame " << frame << " from " << dir << endl;
+		return EXIT_FAILURE;
+	}
+	cout << "Frame " << frame << ": step " << step << " time " << time << ", " << reader.nCells() << " cells, "
+		<< reader.dim() << " components, from frames";
+	for (size_t j = 0; j < reader.chain().size(); ++j)
+		cout << " " << reader.chain()[j] << "(" << reader.counts()[j] << ")";
+	cout << endl;
+	if ( outfile.empty() )
+		return EXIT_SUCCESS;
+	if ( meshfile.empty() ) {
+		cerr << "--out needs the mesh (--mesh)" << endl;
+		return EXIT_FAILURE;
+	}
+	myMesh mesh;
+	Mesh::IO::MeshReader(mesh, meshfile);
+	if ( mesh.nP() != reader.nCells() ) {
+		cerr << "The mesh has " << mesh.nP() << " cells, the frame " << reader.nCells() << endl;
+		return EXIT_FAILURE;
+	}
+	writeFrame(outfile, mesh, w, reader.dim());
+	return EXIT_SUCCESS;
+}
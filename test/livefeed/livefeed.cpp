@@ -0,0 +1,102 @@
+#include <solvers/finitevolume/livefeed.hpp>
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <unistd.h>
+
+using namespace std;
+using namespace ConservationLaw2D;
+
+// Lettore di riferimento dello stato pubblicato da un solutore in memoria condivisa
+// (es. ./sodproblem --live sod meshfile.msh e, in un altro terminale, ./livefeed sod --follow)
+
+// Minimo e massimo di ogni componente sulle celle
+void summary( const vector<double>& q, size_t n, size_t dim ) {
+	for (size_t i = 0; i < dim; ++i) {
+		double lo(q[i]), hi(q[i]);
+		for (size_t c = 1; c < n; ++c) {
+			lo = min(lo, q[c*dim+i]);
+			hi = max(hi, q[c*dim+i]);
+		}
+		cout << " q" << i << " [" << lo << ", " << hi << "]";
+	}
+	cout << endl;
+}
+
+// Baricentri e stato (variabili conservate) di ogni cella, una riga per cella
+void dump( const string& filename, Solver::LiveFeedReader& feed, const vector<double>& q ) {
+	ofstream out(filename.c_str());
+	for (size_t c = 0; c < feed.nCells(); ++c) {
+		out << feed.cx(c) << " " << feed.cy(c);
+		for (size_t i = 0; i < feed.dim(); ++i)
+			out << " " << q[c*feed.dim()+i];
+		out << endl;
+	}
+}
+
+int main(int argc, char **argv) {
+	if ( argc < 2 ) {
+		cout << "Usage: " << argv[0] << " [options] NAME" << endl;
+		cout << "Options:" << endl;
+		cout << "  --follow\t\tPrint every new state until the solver ends" << endl;
+		cout << "  --interval MS\t\tPolling interval in milliseconds (default 100)" << endl;
+		cout << "  --wait\t\tWait for the solver to create the segment" << endl;
+		cout << "  --dump file\t\tWrite centroids and state of the last state read" << endl;
+		exit(1);
+	}
+	bool follow(false), wait(false);
+	int interval(100);
+	string name, dumpfile;
+	for (int i=1; i<argc; ++i) {
+		if (!strcmp(argv[i],"--follow"))
+			follow = true;
+		else if (!strcmp(argv[i],"--wait"))
+			wait = true;
+		else if (!strcmp(argv[i],"--interval") && i+1 < argc)
+			interval = atoi(argv[++i]);
+		else if (!strcmp(argv[i],"--dump") && i+1 < argc)
+			dumpfile = argv[++i];
+		else
+			name = argv[i];
+	}
+	Solver::LiveFeedReader feed;
+	while ( !feed.open(name) ) {
+		if ( !wait ) {
+			cerr << "Cannot open shared memory segment " << Solver::LiveFeed::shmName(name) << endl;
+			return EXIT_FAILURE;
+		}
+		usleep(1000*interval);
+	}
+	cout << "Feed " << Solver::LiveFeed::shmName(name) << ": " << feed.nCells() << " cells, " << feed.dim() << " components" << endl;
+	vector<double> q;
+	uint64_t last(0), generation, step, reads(0), skipped(0);
+	double time, dt;
+	for (;;) {
+		// Lo stato di fine simulazione va letto dopo aver visto finished()
+		const bool finished = feed.finished();
+		if ( feed.read(q, generation, step, time, dt, last) ) {
+			++reads;
+			if ( last > 0 ) skipped += generation - last - 1;
+			last = generation;
+			cout << "Step " << step << " time " << setw(10) << time << " dt " << setw(10) << dt;
+			summary(q, feed.nCells(), feed.dim());
+			if ( !dumpfile.empty() ) dump(dumpfile, feed, q);
+			if ( !follow ) break;
+		} else if ( !follow || finished ) {
+			break;
+		}
+		usleep(1000*interval);
+	}
+	if ( reads == 0 ) {
+		cerr << "No state published yet" << endl;
+		return EXIT_FAILURE;
+	}
+	cout << "States read: " << reads << ", publications skipped between reads: " << skipped << endl;
+	return EXIT_SUCCESS;
+}
@@ -1,6 +1,7 @@
 #include <models/eulero/eulero.hpp>
 #include <models/eulero/fluxes/godunovROE.hpp>
 #include <solvers/finitevolume.hpp>
+#include <solvers/finitevolume_ensemble.hpp>
 #include <mesh/io/meshreader.hpp>
 
 #include <iostream>
@@ -17,17 +18,17 @@ typedef Model::Eulero<real_t>                    myModel;
 typedef NumericalFlux::GodunovRoe<myModel>       myNumFlux;
 typedef Solver::FiniteVolume<myModel,myNumFlux>  mySolver;
 typedef mySolver::FVMesh                         myMesh;
+typedef Solver::FiniteVolumeEnsemble<myModel,myNumFlux>  myEnsemble;
 
 // Tipo per la soluzione (vettore d-dim)
 typedef myModel::SolType	SolType;
 
-// Stato iniziale in variabili (p,u,v)
-inline SolType init( size_t color, real_t x, real_t y ) {
+// Stato iniziale in variabili (p,u,v), dati l'intensita' dello shock e la densita' della bolla
+inline SolType initState( real_t p_inf, real_t rho_in, real_t x, real_t y ) {
 	SolType sol = SolType::Zero();
 	// rho, u, v
 	real_t rho_out = 1.0, p_out = 1.0, u_out = 0.0;
-	real_t rho_in  = 0.1, p_in  = 1.0, u_in  = 0.0;
-	real_t p_inf = 10.0;
+	real_t p_in  = 1.0, u_in  = 0.0;
 	real_t s_shock = u_out + sqrt(GAMMA*p_out/rho_out)*sqrt((GAMMA+1)/(2*GAMMA)*(p_inf/p_out)+(GAMMA-1)/(2*GAMMA));
 	real_t rho_inf = rho_out*((GAMMA+1)*pow(u_out-s_shock,2))/((GAMMA-1)*pow(u_out-s_shock,2)+2*GAMMA*p_out/rho_out);
 	real_t u_inf = (1.0-rho_out/rho_inf)*s_shock + u_out*rho_out/rho_inf;
@@ -41,6 +42,11 @@ inline SolType init( size_t color, real_t x, real_t y ) {
 	return sol;
 }
 
+// Stato iniziale del problema di riferimento
+inline SolType init( size_t color, real_t x, real_t y ) {
+	return initState(10.0, 0.1, x, y);
+}
+
 // Condizioni al bordo
 inline SolType bc( SolType& wl, size_t color, real_t x, real_t y, real_t nx, real_t ny, real_t t ) {
 	return wl;
@@ -48,13 +54,27 @@ inline SolType bc( SolType& wl, size_t color, real_t x, real_t y, real_t nx, rea
 
 int main(int argc, char **argv) {
 	// Parametri in ingresso
-	bool gnuplot(false), interpolated(false);
+	bool gnuplot(false), interpolated(false), tracking(false), batched(false), cached(false), shareddt(false);
+	size_t members(0), coarse(0), sample(0);
+	bool region(false);
+	real_t delta(-1);
+	int refine(0);
 	string meshfile;
 	if ( argc < 2 ) {
 		cout << "Usage: " << argv[0] << " [options] meshfile.msh" << endl;
 		cout << "Options:" << endl;
 		cout << "  --gnuplot\t\tGenerate plot and animation from gnuplot" << endl;
 		cout << "  --interpolated\t\tInterpolate solution on vertices" << endl;
+		cout << "  --batched\t\tCompute fluxes once per edge with vectorized kernels" << endl;
+		cout << "  --cached\t\tWith --batched, precompute primitive variables per cell" << endl;
+		cout << "  --tracking\t\tUpdate only disturbed cells" << endl;
+		cout << "  --ensemble K\t\tRun K cases (p_inf, rho_in) in a single sweep" << endl;
+		cout << "  --shared-dt\t\tUse the same timestep for all ensemble members" << endl;
+		cout << "  --refine N\t\tUniformly refine the mesh N times (1:4) before solving" << endl;
+		cout << "  --region\t\tWrite only density and pressure around the bubble (data/region*.dat)" << endl;
+		cout << "  --coarse N\t\tWith --region, average the cells on a N x N/2 grid" << endl;
+		cout << "  --sample N\t\tWith --region, sample the cells on a N x N/2 grid" << endl;
+		cout << "  --delta TOL\t\tWrite only cells changed more than TOL (data/delta*.bin, read with test/deltaframes)" << endl;
 		exit(1);
 	}
 	for (int i=1; i<argc; ++i) {
@@ -62,6 +82,26 @@ int main(int argc, char **argv) {
 			gnuplot = true;
 		else if (!strcmp(argv[i],"--interpolated"))
 			interpolated = true;
+		else if (!strcmp(argv[i],"--batched"))
+			batched = true;
+		else if (!strcmp(argv[i],"--cached"))
+			cached = true;
+		else if (!strcmp(argv[i],"--tracking"))
+			tracking = true;
+		else if (!strcmp(argv[i],"--ensemble") && i+1 < argc)
+			members = atoi(argv[++i]);
+		else if (!strcmp(argv[i],"--shared-dt"))
+			shareddt = true;
+		else if (!strcmp(argv[i],"--refine") && i+1 < argc)
+			refine = atoi(argv[++i]);
+		else if (!strcmp(argv[i],"--region"))
+			region = true;
+		else if (!strcmp(argv[i],"--coarse") && i+1 < argc)
+			coarse = atoi(argv[++i]);
+		else if (!strcmp(argv[i],"--sample") && i+1 < argc)
+			sample = atoi(argv[++i]);
+		else if (!strcmp(argv[i],"--delta") && i+1 < argc)
+			delta = atof(argv[++i]);
 		else
 			meshfile = argv[i];
 	}
@@ -71,24 +111,77 @@ int main(int argc, char **argv) {
 	myMesh mesh;
 	// Leggo la mesh
 	Mesh::IO::MeshReader(mesh, meshfile);
+	// Raffinamento uniforme, per provare mesh piu' grandi
+	for (int r = 0; r < refine; ++r)
+		mesh.refine();
 	// Storing della geometria e output di alcune statistiche
 	mesh.init_geom();
 	mesh.stats();
+	if ( members > 0 ) {
+		// Insieme di problemi sulla stessa mesh, stesso tempo finale per tutti
+		// Parametri dei membri: p_inf = 10, 15, 20, ... e bolla leggera/pesante alternate
+		vector<real_t> pinf(members), rhoin(members);
+		for (size_t m = 0; m < members; ++m) {
+			pinf[m] = 10.0 + 5.0*(m/2);
+			rhoin[m] = (m%2) ? 5.0 : 0.1;
+		}
+		myEnsemble ensemble(model, mesh, members);
+		ensemble.setCFLmax(0.1);
+		ensemble.setIC([&pinf, &rhoin]( size_t m, size_t color, real_t x, real_t y ) {
+			return initState(pinf[m], rhoin[m], x, y);
+		});
+		ensemble.setBC(bc);
+		ensemble.setSharedDt(shareddt);
+		ensemble.setFinalTime(0.4);
+		ensemble.init();
+		ensemble.setDirectory("./data");
+		clock_t start = clock();
+		for (int i = 0; !ensemble.finished(); ++i) {
+			std::cout << "== Timestep " << i << " ==";
+			for (size_t m = 0; m < ensemble.size(); ++m)
+				std::cout << " " << std::setw(8) << ensemble.getCurrTime(m);
+			std::cout << std::endl;
+			ensemble.timestep();
+		}
+		std::cout << "Elapsed time: " << double(clock()-start)/CLOCKS_PER_SEC << " s" << std::endl;
+		for (size_t m = 0; m < ensemble.size(); ++m)
+			ensemble.framegrab(m, 0, gnuplot);
+		return 0;
+	}
 	// Definisco il solutore per il mio modello
 	mySolver solver(model, mesh);
 	// Inizializzo alcuni parametri
 	solver.setCFLmax(0.1);
 	solver.setIC(init);
 	solver.setBC(bc);
+	solver.setActivityTracking(tracking);
+	solver.setBatchedFluxes(batched);
+	solver.setPrimitiveCache(cached);
+	// Regione di interesse: la bolla e la scia, densita' e pressione
+	if ( region ) {
+		solver.getRegion().setBox(0.2, 0.0, 1.2, 0.5);
+		solver.getRegion().setFields(vector<int>{0, 3});
+		if ( coarse > 0 ) solver.getRegion().setAgglomeration(coarse, coarse/2);
+		if ( sample > 0 ) solver.getRegion().setSampling(sample, sample/2);
+	}
+	// Frame incrementali, un frame completo ogni 10
+	if ( delta >= 0 )
+		solver.setDeltaFrames(vector<real_t>(1, delta), 10);
 	// Inizializzo il solutore
 	solver.init();
 	solver.setDirectory("./data");
 	// Passi temporali
 	for (int i = 0; i < 5000; ++i) {
 		std::cout << "== Timestep " << i << " == currtime: " << std::setw(8) << solver.getCurrTime();
-		std::cout << ", dt = " << std::setw(8) << solver.getCurrDt() << std::endl;
+		std::cout << ", dt = " << std::setw(8) << solver.getCurrDt();
+		if (tracking) std::cout << ", active = " << solver.getActiveCount();
+		std::cout << std::endl;
 		solver.timestep();
-		if (i%50 == 0) solver.framegrab(i/50, gnuplot, interpolated);
+		if (i%50 == 0) {
+			if (delta >= 0) solver.framegrabDelta(i/50);
+			else if (region) solver.framegrabRegion(i/50);
+			else solver.framegrab(i/50, gnuplot, interpolated);
+		}
 	}
 	return 0;
 }
@@ -9,16 +9,66 @@ if (@ARGV < 1) {
 	print("Options:\n");
 	print("  --gnuplot\t\tGenerate plot and animation from gnuplot\n");
 	print("  --interpolated\t\tInterpolate solution on vertices\n");
+	print("  --batched\t\tCompute fluxes once per edge with vectorized kernels\n");
+	print("  --cached\t\tWith --batched, precompute primitive variables per cell\n");
+	print("  --tracking\t\tUpdate only disturbed cells\n");
+	print("  --ensemble K\t\tRun K cases (p_inf, rho_in) in a single sweep\n");
+	print("  --shared-dt\t\tUse the same timestep for all ensemble members\n");
+	print("  --refine N\t\tUniformly refine the mesh N times (1:4) before solving\n");
+	print("  --region\t\tWrite only density and pressure around the bubble (data/region*.dat)\n");
+	print("  --coarse N\t\tWith --region, average the cells on a N x N/2 grid\n");
+	print("  --sample N\t\tWith --region, sample the cells on a N x N/2 grid\n");
+	print("  --delta TOL\t\tWrite only cells changed more than TOL (data/delta*.bin, read with test/deltaframes)\n");
 	exit();
 }
 my $meshfile;
 $gnuplot = false;
 $interpolated = false;
+$batched = false;
+$cached = false;
+$tracking = false;
+$members = 0;
+$shareddt = false;
+$nextmembers = false;
+$nextrefine = false;
+$nextcoarse = false;
+$nextsample = false;
+$nextdelta = false;
 foreach $arg (@ARGV) {
-	if ($arg eq "--gnuplot") {
+	if ($nextmembers eq true) {
+		$members = $arg;
+		$nextmembers = false;
+	} elsif ($nextrefine eq true) {
+		$nextrefine = false;
+	} elsif ($nextcoarse eq true) {
+		$nextcoarse = false;
+	} elsif ($nextsample eq true) {
+		$nextsample = false;
+	} elsif ($nextdelta eq true) {
+		$nextdelta = false;
+	} elsif ($arg eq "--gnuplot") {
 		$gnuplot = true;
 	} elsif($arg eq "--interpolated") {
 		$interpolated = true;
+	} elsif($arg eq "--batched") {
+		$batched = true;
+	} elsif($arg eq "--cached") {
+		$cached = true;
+	} elsif($arg eq "--tracking") {
+		$tracking = true;
+	} elsif($arg eq "--ensemble") {
+		$nextmembers = true;
+	} elsif($arg eq "--shared-dt") {
+		$shareddt = true;
+	} elsif($arg eq "--refine") {
+		$nextrefine = true;
+	} elsif($arg eq "--region") {
+	} elsif($arg eq "--coarse") {
+		$nextcoarse = true;
+	} elsif($arg eq "--sample") {
+		$nextsample = true;
+	} elsif($arg eq "--delta") {
+		$nextdelta = true;
 	} else {
 		$meshfile = $arg;
 	}
@@ -72,12 +72,14 @@ inline SolType bc( SolType& wl, size_t color, real_t x, real_t y, real_t nx, rea
 int main(int argc, char **argv) {
 	// Parametri in ingresso
 	bool gnuplot(false), interpolated(false);
+	size_t history(0);
 	string meshfile;
 	if ( argc < 2 ) {
 		cout << "Usage: " << argv[0] << " [options] meshfile.msh" << endl;
 		cout << "Options:" << endl;
 		cout << "  --gnuplot\t\tGenerate plot and animation from gnuplot" << endl;
 		cout << "  --interpolated\t\tInterpolate solution on vertices" << endl;
+		cout << "  --history N\t\tKeep the last N states in memory and write them only around events" << endl;
 		exit(1);
 	}
 	for (int i=1; i<argc; ++i) {
@@ -85,6 +87,8 @@ int main(int argc, char **argv) {
 			gnuplot = true;
 		else if (!strcmp(argv[i],"--interpolated"))
 			interpolated = true;
+		else if (!strcmp(argv[i],"--history") && i+1 < argc)
+			history = atoi(argv[++i]);
 		else
 			meshfile = argv[i];
 	}
@@ -100,6 +104,13 @@ int main(int argc, char **argv) {
 	solver.setCFLmax(0.3);
 	solver.setIC(init);
 	solver.setBC(bc);
+	// Storia in memoria al posto dei frame periodici: la finestra attorno all'arrivo
+	// dell'urto riflesso sulla parete in basso (pressione oltre 1.5) o a un picco del residuo
+	if ( history > 0 ) {
+		solver.setHistory(history, history/2);
+		solver.addProbeTrigger(3.0, 0.05, 3, 1.5);
+		solver.setResidualTrigger(3.0);
+	}
 	// Inizializzo il solutore
 	solver.init();
 	solver.setDirectory("./data");
@@ -108,7 +119,12 @@ int main(int argc, char **argv) {
 		std::cout << "== Timestep " << i << " == currtime: " << std::setw(8) << solver.getCurrTime();
 		std::cout << ", dt = " << std::setw(8) << solver.getCurrDt() << std::endl;
 		solver.timestep();
-		if (i%50 == 0) solver.framegrab(i/50, gnuplot, interpolated);
+		if (history == 0 && i%50 == 0) solver.framegrab(i/50, gnuplot, interpolated);
+	}
+	if ( history > 0 ) {
+		// Un evento vicino alla fine ha la finestra incompleta: la scrivo con le istantanee raccolte
+		solver.finishHistory();
+		std::cout << "Event windows written: " << solver.getEventCount() << std::endl;
 	}
 	return 0;
 }
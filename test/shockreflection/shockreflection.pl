@@ -9,13 +9,19 @@ if (@ARGV < 1) {
 	print("Options:\n");
 	print("  --gnuplot\t\tGenerate plot and animation from gnuplot\n");
 	print("  --interpolated\t\tInterpolate solution on vertices\n");
+	print("  --history N\t\tKeep the last N states in memory and write them only around events\n");
 	exit();
 }
 my $meshfile;
 $gnuplot = false;
 $interpolated = false;
+$nexthistory = false;
 foreach $arg (@ARGV) {
-	if ($arg eq "--gnuplot") {
+	if ($nexthistory eq true) {
+		$nexthistory = false;
+	} elsif ($arg eq "--history") {
+		$nexthistory = true;
+	} elsif ($arg eq "--gnuplot") {
 		$gnuplot = true;
 	} elsif($arg eq "--interpolated") {
 		$interpolated = true;
@@ -0,0 +1,408 @@
+#include <solvers/registry.hpp>
+#include <solvers/server/meshcache.hpp>
+#include <solvers/server/workerpool.hpp>
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <cstring>
+#include <chrono>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <algorithm>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace ConservationLaw2D;
+
+typedef double real_t;
+// La mesh dei volumi finiti non dipende da modello e flusso: una sola cache per tutte le varianti
+typedef Solver::Simulation::FVMesh	myMesh;
+typedef Solver::MeshCache<myMesh>	myCache;
+
+// Descrizione di una simulazione: problema di Riemann lungo x in variabili primitive
+// ((rho,u,v,p) per euler, (h,u,v) per shallowwater, (p,u,v) per acoustics)
+struct Job {
+	string id, mesh, model, flux, bc, output;
+	vector<real_t> left, right;
+	Solver::Parameters params;
+	real_t x0, cfl, tend;
+	int frames;
+	size_t maxsteps;
+};
+
+// Secondi dall'istante dato
+inline double seconds( const chrono::steady_clock::time_point& t0 ) {
+	return chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+}
+
+// Vettore di stato come valori separati da virgole
+bool parseState( const string& s, vector<real_t>& w ) {
+	stringstream ss(s);
+	string item;
+	w.clear();
+	while ( getline(ss, item, ',') )
+		w.push_back(atof(item.c_str()));
+	return !w.empty();
+}
+
+// Riga di coppie chiave=valore separate da spazi
+bool parseJob( const string& line, Job& job, string& error ) {
+	static std::atomic<size_t> counter(0);
+	job.model = "euler";
+	job.bc = "transmissive";
+	job.x0 = 0.0;
+	job.cfl = 0.1;
+	job.tend = 0.1;
+	job.frames = 0;
+	job.maxsteps = 1000000;
+	stringstream ss(line);
+	string token;
+	while ( ss >> token ) {
+		const size_t eq = token.find('=');
+		if ( eq == string::npos ) {
+			error = "expected key=value: " + token;
+			return false;
+		}
+		const string key = token.substr(0, eq), value = token.substr(eq+1);
+		bool ok = true;
+		if ( key == "id" ) job.id = value;
+		else if ( key == "mesh" ) job.mesh = value;
+		else if ( key == "model" ) job.model = value;
+		else if ( key == "flux" ) job.flux = value;
+		else if ( key == "bc" ) job.bc = value;
+		else if ( key == "output" ) job.output = value;
+		else if ( key == "left" ) ok = parseState(value, job.left);
+		else if ( key == "right" ) ok = parseState(value, job.right);
+		else if ( key == "x0" ) job.x0 = atof(value.c_str());
+		else if ( key == "gamma" || key == "hdry" || key == "rho0" || key == "K0" ) job.params[key] = atof(value.c_str());
+		else if ( key == "cfl" ) job.cfl = atof(value.c_str());
+		else if ( key == "tend" ) job.tend = atof(value.c_str());
+		else if ( key == "frames" ) job.frames = atoi(value.c_str());
+		else if ( key == "maxsteps" ) job.maxsteps = atol(value.c_str());
+		else ok = false;
+		if ( !ok ) {
+			error = "bad parameter " + token;
+			return false;
+		}
+	}
+	if ( job.id.empty() ) {
+		stringstream id;
+		id << "job" << ++counter;
+		job.id = id.str();
+	}
+	// Stati di default: tubo d'urto di Sod, rottura di diga, impulso di pressione
+	if ( job.left.empty() ) {
+		if ( job.model == "euler" ) parseState("1,0,0,1", job.left);
+		else if ( job.model == "shallowwater" ) parseState("1,0,0", job.left);
+		else parseState("1,0,0", job.left);
+	}
+	if ( job.right.empty() ) {
+		if ( job.model == "euler" ) parseState("0.125,0,0,0.1", job.right);
+		else if ( job.model == "shallowwater" ) parseState("0.5,0,0", job.right);
+		else parseState("0,0,0", job.right);
+	}
+	if ( job.mesh.empty() ) error = "missing mesh";
+	else if ( !Solver::Registry::instance().has(job.model) ) error = "unknown model " + job.model;
+	else if ( !Solver::Registry::instance().has(job.model, job.flux) ) error = "unknown flux " + job.flux + " for " + job.model;
+	else if ( job.left.size() != job.right.size() ) error = "left and right states differ in size";
+	else if ( job.bc != "transmissive" && job.bc != "reflective" ) error = "unknown bc " + job.bc;
+	else if ( job.cfl <= 0 || job.tend <= 0 ) error = "cfl and tend must be positive";
+	return error.empty();
+}
+
+// Condizioni al bordo (trasmissiva o parete riflettente): in tutti i modelli le componenti 1 e 2
+// dello stato primitivo sono la velocita'
+inline void boundary( bool reflect, size_t dim, const real_t* wl, real_t nx, real_t ny, real_t* wr ) {
+	for (size_t i = 0; i < dim; ++i) wr[i] = wl[i];
+	if ( !reflect ) return;
+	const real_t un = wl[1]*nx + wl[2]*ny;
+	wr[1] -= 2*un*nx;
+	wr[2] -= 2*un*ny;
+}
+
+// Canale di risposta di un client: i lavori finiscono su thread diversi
+class Connection {
+	public:
+		Connection( int fd, bool socket ):fd_(fd),socket_(socket),pending_(0) {}
+		void reply( const string& line ) {
+			std::lock_guard<std::mutex> lock(mutex_);
+			const string s = line + "\n";
+			size_t done = 0;
+			while ( done < s.size() ) {
+				ssize_t n = socket_ ? send(fd_, s.data()+done, s.size()-done, MSG_NOSIGNAL)
+					: write(fd_, s.data()+done, s.size()-done);
+				if ( n <= 0 ) return;
+				done += n;
+			}
+		}
+		void begin( void ) { std::lock_guard<std::mutex> lock(mutex_); ++pending_; }
+		void end( void ) {
+			std::lock_guard<std::mutex> lock(mutex_);
+			if ( --pending_ == 0 ) idle_.notify_all();
+		}
+		void wait( void ) {
+			std::unique_lock<std::mutex> lock(mutex_);
+			while ( pending_ > 0 ) idle_.wait(lock);
+		}
+	private:
+		int fd_;
+		bool socket_;
+		size_t pending_;
+		std::mutex mutex_;
+		std::condition_variable idle_;
+};
+
+// Esegue la simulazione con la variante del registro sulla mesh condivisa
+void simulate( const Job& job, Solver::Simulation& solver, ostringstream& result ) {
+	const size_t dim = solver.dim();
+	const vector<real_t> left(job.left), right(job.right);
+	const real_t x0 = job.x0;
+	const bool reflect = ( job.bc == "reflective" );
+	solver.setGeometryReady(true);
+	// Con --stdin lo standard output porta solo le risposte del protocollo
+	solver.setQuiet(true);
+	solver.setCFLmax(job.cfl);
+	solver.setIC([=]( size_t color, real_t x, real_t y, real_t* w ) {
+		const vector<real_t>& s = ( x < x0 ) ? left : right;
+		for (size_t i = 0; i < dim; ++i) w[i] = s[i];
+	});
+	solver.setBC([=]( const real_t* wl, size_t color, real_t x, real_t y, real_t nx, real_t ny, real_t t, real_t* wr ) {
+		boundary(reflect, dim, wl, nx, ny, wr);
+	});
+	const bool output = !job.output.empty();
+	if ( output ) solver.setDirectory(job.output);
+	solver.init();
+	int frame = 0;
+	if ( output ) solver.framegrab(frame++, false, false);
+	size_t steps = 0;
+	while ( solver.getCurrTime() < job.tend && steps < job.maxsteps ) {
+		solver.timestep();
+		++steps;
+		// Frame equispaziati in tempo, l'ultimo alla fine
+		if ( output && job.frames > 0 && solver.getCurrTime() >= frame*job.tend/job.frames )
+			solver.framegrab(frame++, false, false);
+	}
+	if ( output && job.frames <= 0 ) solver.framegrab(frame++, false, false);
+	vector<real_t> totals(dim);
+	solver.getTotals(&totals[0]);
+	result << " steps=" << steps << " time=" << solver.getCurrTime() << " totals=" << setprecision(12);
+	for (size_t i = 0; i < dim; ++i)
+		result << (i ? "," : "") << totals[i];
+	result << setprecision(6);
+	if ( output ) result << " frames=" << frame;
+}
+
+// Lavoro del gruppo: mesh dalla cache, simulazione, risposta al client
+void execute( Job job, myCache* cache, Connection* conn ) {
+	chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+	uint64_t key(0);
+	bool hit(false);
+	myCache::mesh_ptr mesh = cache->get(job.mesh, key, hit);
+	const double tload = seconds(t0);
+	if ( !mesh ) {
+		conn->reply("error id=" + job.id + " cannot read mesh " + job.mesh);
+		conn->end();
+		return;
+	}
+	std::shared_ptr<Solver::Simulation> solver = Solver::Registry::instance().create(job.model, job.flux, *mesh, job.params);
+	if ( job.left.size() != solver->dim() ) {
+		ostringstream error;
+		error << "error id=" << job.id << " " << job.model << " needs states with " << solver->dim() << " values";
+		conn->reply(error.str());
+		conn->end();
+		return;
+	}
+	if ( !job.output.empty() ) mkdir(job.output.c_str(), 0755);
+	ostringstream result;
+	result << "done id=" << job.id << " solver=" << solver->name() << " cells=" << mesh->nP();
+	t0 = chrono::steady_clock::now();
+	simulate(job, *solver, result);
+	result << " mesh=" << hex << setw(16) << setfill('0') << key << dec << setfill(' ')
+		<< (hit ? " cached" : " loaded") << " load=" << tload << "s run=" << seconds(t0) << "s";
+	conn->reply(result.str());
+	conn->end();
+}
+
+// Legge una riga dal descrittore (con buffer per i caratteri gia' letti)
+bool readLine( int fd, string& buffer, string& line ) {
+	for (;;) {
+		const size_t nl = buffer.find('\n');
+		if ( nl != string::npos ) {
+			line = buffer.substr(0, nl);
+			buffer.erase(0, nl+1);
+			return true;
+		}
+		char chunk[4096];
+		const ssize_t n = read(fd, chunk, sizeof(chunk));
+		if ( n <= 0 ) {
+			// Ultima riga senza a capo
+			line = buffer;
+			buffer.clear();
+			return !line.empty();
+		}
+		buffer.append(chunk, n);
+	}
+}
+
+// Serve le richieste di un client fino alla fine dell'input o a quit; vero se il client ha chiesto quit
+bool serve( int in, Connection& conn, Solver::WorkerPool& pool, myCache& cache ) {
+	string buffer, line;
+	bool quit = false;
+	while ( !quit && readLine(in, buffer, line) ) {
+		const size_t b = line.find_first_not_of(" \t\r"), e = line.find_last_not_of(" \t\r");
+		if ( b == string::npos || line[b] == '#' ) continue;
+		line = line.substr(b, e-b+1);
+		if ( line == "quit" ) {
+			quit = true;
+		} else if ( line == "wait" ) {
+			conn.wait();
+			conn.reply("idle");
+		} else if ( line == "stats" ) {
+			ostringstream s;
+			s << "stats meshes=" << cache.size() << " hits=" << cache.hits() << " misses=" << cache.misses()
+				<< " workers=" << pool.size() << " pending=" << pool.pending();
+			conn.reply(s.str());
+		} else {
+			Job job;
+			string error;
+			if ( !parseJob(line, job, error) ) {
+				conn.reply("error " + error);
+				continue;
+			}
+			conn.reply("queued id=" + job.id);
+			conn.begin();
+			pool.submit(std::bind(execute, job, &cache, &conn));
+		}
+	}
+	// Le risposte dei lavori ancora in corso vanno al client prima di chiudere
+	conn.wait();
+	return quit;
+}
+
+// Server su socket UNIX: un thread per client, quit da un client chiude il server
+std::atomic<bool> quitServer(false);
+int listenFd = -1;
+// Descrittori dei client ancora aperti (il server li chiude alla fine) e thread dei client
+// terminati, da unire
+std::mutex clientsMutex;
+vector<int> clientFds;
+vector<std::thread::id> finishedClients;
+
+void client( int fd, Solver::WorkerPool* pool, myCache* cache ) {
+	Connection conn(fd, true);
+	if ( serve(fd, conn, *pool, *cache) ) {
+		quitServer = true;
+		shutdown(listenFd, SHUT_RDWR);
+	}
+	// Tolgo il descrittore dalla lista prima di chiuderlo: il numero puo' essere riusato
+	{
+		std::lock_guard<std::mutex> lock(clientsMutex);
+		clientFds.erase(std::find(clientFds.begin(), clientFds.end(), fd));
+	}
+	close(fd);
+	std::lock_guard<std::mutex> lock(clientsMutex);
+	finishedClients.push_back(std::this_thread::get_id());
+}
+
+// Unisce i thread dei client terminati: un server sempre acceso non li accumula
+void reapClients( vector<std::thread>& clients ) {
+	vector<std::thread::id> finished;
+	{
+		std::lock_guard<std::mutex> lock(clientsMutex);
+		finished.swap(finishedClients);
+	}
+	for (size_t k = 0; k < finished.size(); ++k)
+		for (size_t i = 0; i < clients.size(); ++i)
+			if ( clients[i].get_id() == finished[k] ) {
+				clients[i].join();
+				clients[i].swap(clients.back());
+				clients.pop_back();
+				break;
+			}
+}
+
+int main(int argc, char **argv) {
+	// Avvertimento
+	if ( argc < 2 ) {
+		cout << "Usage: " << argv[0] << " [options] --stdin | --socket path" << endl;
+		cout << "Options:" << endl;
+		cout << "  --stdin\t\tRead run descriptions from standard input" << endl;
+		cout << "  --socket path\t\tListen for run descriptions on a UNIX domain socket" << endl;
+		cout << "  --workers N\t\tRun up to N simulations at the same time (default 2)" << endl;
+		cout << "  --cache N\t\tKeep up to N meshes in memory (default 8)" << endl;
+		cout << "Run description (one line, key=value):" << endl;
+		cout << "  mesh=file.msh [id=name] [model=euler|shallowwater|acoustics] [flux=name]" << endl;
+		cout << "  [left=w0,w1,...] [right=w0,w1,...] [x0=X] [cfl=C] [tend=T] [maxsteps=N]" << endl;
+		cout << "  [gamma=G] [hdry=H] [rho0=R] [K0=K] [bc=transmissive|reflective] [output=dir] [frames=N]" << endl;
+		cout << "Solvers (model/flux, the first flux of each model is its default): ";
+		Solver::Registry::instance().list(cout);
+		cout << "Commands: wait (until this client's runs end), stats, quit" << endl;
+		exit(EXIT_SUCCESS);
+	}
+	string socketPath;
+	bool useStdin(false);
+	int workers(2), capacity(8);
+	for (int i=1; i<argc; ++i) {
+		if (!strcmp(argv[i],"--stdin"))
+			useStdin = true;
+		else if (!strcmp(argv[i],"--socket") && i+1 < argc)
+			socketPath = argv[++i];
+		else if (!strcmp(argv[i],"--workers") && i+1 < argc)
+			workers = atoi(argv[++i]);
+		else if (!strcmp(argv[i],"--cache") && i+1 < argc)
+			capacity = atoi(argv[++i]);
+	}
+	myCache cache(capacity);
+	Solver::WorkerPool pool(workers);
+	if ( useStdin || socketPath.empty() ) {
+		Connection conn(STDOUT_FILENO, false);
+		serve(STDIN_FILENO, conn, pool, cache);
+		return EXIT_SUCCESS;
+	}
+	// Socket UNIX
+	sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if ( socketPath.size() >= sizeof(addr.sun_path) ) {
+		cerr << "Socket path too long: " << socketPath << endl;
+		return EXIT_FAILURE;
+	}
+	strcpy(addr.sun_path, socketPath.c_str());
+	listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+	unlink(socketPath.c_str());
+	if ( listenFd < 0 || bind(listenFd, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listenFd, 16) != 0 ) {
+		cerr << "Cannot listen on " << socketPath << endl;
+		return EXIT_FAILURE;
+	}
+	cout << "Listening on " << socketPath << " with " << pool.size() << " workers" << endl;
+	vector<std::thread> clients;
+	while ( !quitServer ) {
+		const int fd = accept(listenFd, 0, 0);
+		reapClients(clients);
+		if ( fd < 0 ) continue;
+		{
+			std::lock_guard<std::mutex> lock(clientsMutex);
+			clientFds.push_back(fd);
+		}
+		clients.push_back(std::thread(client, fd, &pool, &cache));
+	}
+	// Chiudo la lettura degli altri client: finiscono i loro lavori, rispondono e terminano
+	// prima che gruppo di lavoro e cache vengano distrutti
+	{
+		std::lock_guard<std::mutex> lock(clientsMutex);
+		for (size_t i = 0; i < clientFds.size(); ++i)
+			shutdown(clientFds[i], SHUT_RD);
+	}
+	for (size_t i = 0; i < clients.size(); ++i)
+		clients[i].join();
+	// Finisco i lavori in coda
+	pool.wait();
+	close(listenFd);
+	unlink(socketPath.c_str());
+	return EXIT_SUCCESS;
+}
@@ -4,12 +4,18 @@
 #include <models/eulero/fluxes/godunovHLL.hpp>
 #include <models/eulero/fluxes/godunovHLLC.hpp>
 #include <models/eulero/fluxes/rusanov.hpp>
+#include <models/eulero/fluxes/hybrid.hpp>
 #include <solvers/finitevolume.hpp>
+#include <solvers/registry.hpp>
 #include <mesh/io/meshreader.hpp>
 
 #include <iostream>
 #include <ctime>
 #include <cmath>
+#include <chrono>
+#ifdef CONSLAW2D_MPI
+#include <mpi.h>
+#endif
 
 using namespace std;
 using namespace ConservationLaw2D;
@@ -23,6 +29,15 @@ typedef NumericalFlux::GodunovRoe<myModel>		myNumFlux;
 //typedef NumericalFlux::GodunovHLLC<myModel>	myNumFlux;
 typedef Solver::FiniteVolume<myModel,myNumFlux>	mySolver;
 typedef mySolver::FVMesh						myMesh;
+// Precisione mista: stato e geometria in float, flussi in double
+typedef Solver::FiniteVolume<myModel,myNumFlux,float>	myMixedSolver;
+typedef myMixedSolver::FVMesh							myMixedMesh;
+// Soluzione in formato Structure-of-Arrays (stessa mesh)
+typedef Solver::FiniteVolume<myModel,myNumFlux,real_t,Solver::SoA>	mySoASolver;
+// Flussi per il confronto del flusso ibrido (stessa mesh)
+typedef Solver::FiniteVolume<myModel,NumericalFlux::GodunovHLLC<myModel> >	myHLLCSolver;
+typedef Solver::FiniteVolume<myModel,NumericalFlux::Rusanov<myModel> >		myRusanovSolver;
+typedef Solver::FiniteVolume<myModel,NumericalFlux::Hybrid<myModel> >		myHybridSolver;
 
 // Tipo per la soluzione (vettore d-dim)
 typedef myModel::SolType	SolType;
@@ -43,15 +58,285 @@ inline SolType bc( SolType& wl, size_t color, real_t x, real_t y, real_t nx, rea
 	return wl;
 }
 
+// Stato iniziale e condizioni al bordo per i solutori scelti per nome (vettori di double)
+inline void initArray( size_t color, real_t x, real_t y, real_t* w ) {
+	SolType sol = init(color, x, y);
+	for (int i = 0; i < SolType::RowsAtCompileTime; ++i) w[i] = sol[i];
+}
+inline void bcArray( const real_t* wl, size_t color, real_t x, real_t y, real_t nx, real_t ny, real_t t, real_t* wr ) {
+	for (int i = 0; i < SolType::RowsAtCompileTime; ++i) wr[i] = wl[i];
+}
+
+// Risolve il problema con il solutore dato e restituisce il tempo di calcolo
+template <typename SOLVER, typename MESH>
+double run( SOLVER& solver, MESH& mesh, int nsteps ) {
+	solver.setCFLmax(0.1);
+	solver.setIC(init);
+	solver.setBC(bc);
+	solver.init();
+	clock_t ck0 = clock();
+	for (int i = 0; i <= nsteps; ++i)
+		solver.timestep();
+	return double(clock()-ck0)/CLOCKS_PER_SEC;
+}
+
+// Confronta la soluzione in precisione mista con quella in doppia precisione
+int validateMixed( myModel& model, const string& meshfile ) {
+	myMesh mesh;
+	myMixedMesh mixedmesh;
+	Mesh::IO::MeshReader(mesh, meshfile);
+	Mesh::IO::MeshReader(mixedmesh, meshfile);
+	mySolver solver(model, mesh);
+	myMixedSolver mixedsolver(model, mixedmesh);
+	double t = run(solver, mesh, 500);
+	double tmixed = run(mixedsolver, mixedmesh, 500);
+	// Errore sulla densita' in norma L1 (pesata con l'area) e infinito
+	real_t errL1(0), normL1(0), errInf(0);
+	for (size_t i = 0; i < mesh.nP(); ++i) {
+		real_t rho = solver.getSol(i)[0];
+		real_t err = abs(rho - mixedsolver.getSol(i)[0]);
+		errL1 += mesh.p(i)->area() * err;
+		normL1 += mesh.p(i)->area() * abs(rho);
+		errInf = max(errInf, err);
+	}
+	cout << "== Mixed precision validation ==" << endl;
+	cout << " Time (double): " << t << " seconds" << endl;
+	cout << " Time (mixed):  " << tmixed << " seconds" << endl;
+	cout << " Final time difference: " << solver.getCurrTime()-mixedsolver.getCurrTime() << endl;
+	cout << " Density relative L1 error: " << errL1/normL1 << endl;
+	cout << " Density max error: " << errInf << endl;
+	return ( errL1/normL1 < 1e-4 ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Differenza relativa in norma L1 (pesata con l'area) tra le densita' di due solutori
+template <typename SOLVER1, typename SOLVER2>
+real_t densityL1( SOLVER1& s1, SOLVER2& s2, myMesh& mesh ) {
+	real_t err(0), norm(0);
+	for (size_t i = 0; i < mesh.nP(); ++i) {
+		err += mesh.p(i)->area() * abs(s1.getSol(i)[0] - s2.getSol(i)[0]);
+		norm += mesh.p(i)->area() * abs(s1.getSol(i)[0]);
+	}
+	return err/norm;
+}
+
+// Confronta il flusso ibrido (Rusanov/HLLC) con HLLC e Rusanov: la densita' deve restare vicina
+// a quella di HLLC (differenza relativa in norma L1 sotto 2.5e-2, sulla mesh piu' grossolana e' 2.1e-2)
+// con HLLC solo su pochi lati (meno del 10% all'ultimo passo)
+int validateHybrid( myModel& model, const string& meshfile ) {
+	myMesh mesh, mesh1, mesh2;
+	Mesh::IO::MeshReader(mesh, meshfile);
+	Mesh::IO::MeshReader(mesh1, meshfile);
+	Mesh::IO::MeshReader(mesh2, meshfile);
+	myHLLCSolver hllc(model, mesh);
+	myRusanovSolver rusanov(model, mesh1);
+	myHybridSolver hybrid(model, mesh2);
+	hllc.setBatchedFluxes(true);
+	rusanov.setBatchedFluxes(true);
+	hybrid.setBatchedFluxes(true);
+	double thllc = run(hllc, mesh, 500);
+	double trusanov = run(rusanov, mesh1, 500);
+	double thybrid = run(hybrid, mesh2, 500);
+	real_t errRusanov = densityL1(hllc, rusanov, mesh);
+	real_t errHybrid = densityL1(hllc, hybrid, mesh);
+	cout << "== Hybrid flux validation ==" << endl;
+	cout << " Time (HLLC):    " << thllc << " seconds" << endl;
+	cout << " Time (Rusanov): " << trusanov << " seconds" << endl;
+	cout << " Time (hybrid):  " << thybrid << " seconds" << endl;
+	cout << " Faces on HLLC at last step: " << 100.0*hybrid.getSharpFraction() << " %" << endl;
+	cout << " Density relative L1 difference from HLLC: Rusanov " << errRusanov << ", hybrid " << errHybrid << endl;
+	const real_t tolL1(2.5e-2), maxSharp(0.1);
+	return ( errHybrid < tolL1 && hybrid.getSharpFraction() < maxSharp ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Confronta le disposizioni AoS e SoA della soluzione: i risultati devono coincidere
+int validateLayout( myModel& model, const string& meshfile ) {
+	bool exact = true;
+	cout << "== Solution layout validation ==" << endl;
+	for (int batched = 0; batched < 2; ++batched) {
+		myMesh mesh, mesh1;
+		Mesh::IO::MeshReader(mesh, meshfile);
+		Mesh::IO::MeshReader(mesh1, meshfile);
+		mySolver aos(model, mesh);
+		mySoASolver soa(model, mesh1);
+		aos.setBatchedFluxes(batched);
+		soa.setBatchedFluxes(batched);
+		double taos = run(aos, mesh, 500);
+		double tsoa = run(soa, mesh1, 500);
+		real_t err = densityL1(aos, soa, mesh);
+		cout << (batched ? " Batched:" : " Cells:  ") << " AoS " << taos << " seconds, SoA " << tsoa
+			<< " seconds, density relative L1 difference " << err << endl;
+		exact = exact && ( err == 0 );
+	}
+	return exact ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Stati identici componente per componente
+inline bool sameState( const SolType& a, const SolType& b ) {
+	for (int i = 0; i < SolType::RowsAtCompileTime; ++i)
+		if ( a[i] != b[i] ) return false;
+	return true;
+}
+// Confronta l'esecuzione seriale con quella con nthreads thread: soluzione, passo temporale
+// e integrali delle variabili conservate devono coincidere bit per bit
+int validateThreads( myModel& model, const string& meshfile, int nthreads ) {
+	myMesh mesh, mesh1;
+	Mesh::IO::MeshReader(mesh, meshfile);
+	Mesh::IO::MeshReader(mesh1, meshfile);
+	mySolver serial(model, mesh);
+	mySolver threaded(model, mesh1);
+	threaded.setThreads(nthreads);
+	double tserial = run(serial, mesh, 500);
+	double tthreaded = run(threaded, mesh1, 500);
+	bool exact = ( serial.getCurrTime() == threaded.getCurrTime() );
+	for (size_t i = 0; i < mesh.nP(); ++i)
+		exact = exact && sameState(serial.getSol(i), threaded.getSol(i));
+	SolType tot = serial.getTotals(), tot1 = threaded.getTotals();
+	exact = exact && sameState(tot, tot1);
+	// Costo degli integrali rispetto a una somma semplice in un ciclo seriale: miglior tempo
+	// su piu' prove, una singola misura di pochi microsecondi dipende troppo dal carico della macchina
+	const int nrep = 50, ntrials = 20;
+	double ttotals(1e30), tnaive(1e30);
+	SolType naive = SolType::Zero();
+	for (int k = 0; k < ntrials; ++k) {
+		std::chrono::steady_clock::time_point c0 = std::chrono::steady_clock::now();
+		for (int r = 0; r < nrep; ++r) tot1 = serial.getTotals();
+		std::chrono::steady_clock::time_point c1 = std::chrono::steady_clock::now();
+		for (int r = 0; r < nrep; ++r) {
+			naive = SolType::Zero();
+			for (size_t i = 0; i < mesh.nP(); ++i)
+				naive += mesh.p(i)->area() * serial.getSol(i);
+		}
+		std::chrono::steady_clock::time_point c2 = std::chrono::steady_clock::now();
+		ttotals = min(ttotals, std::chrono::duration<double>(c1-c0).count()/nrep);
+		tnaive = min(tnaive, std::chrono::duration<double>(c2-c1).count()/nrep);
+	}
+	cout.precision(17);
+	cout << "== Thread reproducibility validation ==" << endl;
+	cout << " Time (1 thread): " << tserial << " seconds, (" << nthreads << " threads): " << tthreaded << " seconds" << endl;
+	cout << " Totals: mass " << tot[0] << ", momentum " << tot[1] << " " << tot[2] << ", energy " << tot[3] << endl;
+	cout << " Naive sum:   mass " << naive[0] << ", momentum " << naive[1] << " " << naive[2] << ", energy " << naive[3] << endl;
+	cout << " Totals time: " << 1e6*ttotals << " us, naive sum: " << 1e6*tnaive << " us (best of "
+		<< ntrials << " trials)" << endl;
+	cout << " Bitwise equal: " << (exact ? "yes" : "NO") << endl;
+	return exact ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Analisi di un frame: posizione dell'urto (baricentro piu' a destra con densita' sopra lo stato
+// a destra) e massa totale; vale per le viste senza copie e per gli snapshot
+template <typename FRAME>
+string analyseFrame( const FRAME& frame ) {
+	real_t shock(-1e30), mass(0);
+	for (size_t c = 0; c < frame.nCells(); ++c) {
+		const real_t rho = frame(c, 0);
+		mass += frame.mesh().p(c)->area() * rho;
+		if ( rho > 0.15 ) shock = max(shock, real_t(frame.mesh().p(c)->cx()));
+	}
+	stringstream out;
+	out << "Frame " << frame.index() << ": step " << frame.step() << " time " << frame.time()
+		<< " shock x " << shock << " mass " << std::setprecision(12) << mass;
+	return out.str();
+}
+
+// Analisi in linea ai tempi richiesti, senza file: nello stesso thread con le viste del flusso
+// di frame o su un thread dedicato con gli snapshot
+int runStream( myModel& model, const string& meshfile, int nframes, bool async ) {
+	myMesh mesh;
+	Mesh::IO::MeshReader(mesh, meshfile);
+	mySolver solver(model, mesh);
+	solver.setCFLmax(0.1);
+	solver.setIC(init);
+	solver.setBC(bc);
+	solver.init();
+	vector<double> times;
+	for (int k = 1; k <= nframes; ++k)
+		times.push_back(0.2*k/nframes);
+	std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+	if ( async ) {
+		Solver::FrameAnalysis<mySolver::View> analysis( [](const Solver::FrameAnalysis<mySolver::View>::Snapshot& s) {
+			cout << analyseFrame(s) << endl;
+		} );
+		for (auto& frame : solver.stream(times))
+			analysis.submit(frame);
+		analysis.finish();
+		cout << "Snapshots that waited for the analysis: " << analysis.waits() << endl;
+	} else {
+		for (auto& frame : solver.stream(times))
+			cout << analyseFrame(frame) << endl;
+	}
+	cout << "Elapsed time: " << std::chrono::duration<double>(std::chrono::steady_clock::now()-t0).count() << " s" << endl;
+	return EXIT_SUCCESS;
+}
+
+#ifdef CONSLAW2D_MPI
+// Esecuzione distribuita: ogni processo aggiorna una striscia del dominio; alla fine
+// il primo processo raccoglie la soluzione e la confronta con l'esecuzione seriale
+int runDistributed( myModel& model, const string& meshfile, bool vtu ) {
+	int rank, size;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	MPI_Comm_size(MPI_COMM_WORLD, &size);
+	myMesh mesh;
+	Mesh::IO::MeshReader(mesh, meshfile);
+	mySolver solver(model, mesh);
+	solver.setCFLmax(0.1);
+	solver.setIC(init);
+	solver.setBC(bc);
+	solver.setDirectory("./data");
+	solver.setDistributed(true);
+	solver.init();
+	MPI_Barrier(MPI_COMM_WORLD);
+	double t0 = MPI_Wtime();
+	for (int i = 0; i <= 500; ++i) {
+		solver.timestep();
+		if (vtu && i%50 == 0) solver.framegrabVTU(i/50);
+	}
+	double t = MPI_Wtime() - t0;
+	solver.gatherSolution();
+	if ( rank != 0 )
+		return EXIT_SUCCESS;
+	myMesh mesh1;
+	Mesh::IO::MeshReader(mesh1, meshfile);
+	mySolver serial(model, mesh1);
+	double tserial = run(serial, mesh1, 500);
+	real_t err(0);
+	for (size_t i = 0; i < mesh.nP(); ++i)
+		err = max(err, (solver.getSol(i) - serial.getSol(i)).cwise().abs().maxCoeff());
+	cout << "== Distributed run ==" << endl;
+	cout << " Ranks: " << size << ", time " << t << " seconds (serial " << tserial << " seconds)" << endl;
+	cout << " Final time difference: " << solver.getCurrTime()-serial.getCurrTime() << endl;
+	cout << " Max difference from the serial run: " << err << endl;
+	return ( err == 0 ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+#endif
+
 int main(int argc, char **argv) {
 	// Parametri in ingresso
-	bool gnuplot(false), interpolated(false);
-	string meshfile;
+	bool gnuplot(false), interpolated(false), validate(false), batched(false), hybrid(false), binary(false);
+	bool layout(false), mpi(false), vtu(false);
+	int monitor(0), stages(1), threads(1), vthreads(0), liveEvery(1), stream(0);
+	bool async(false);
+	string meshfile, flux("roe"), live;
 	if ( argc < 2 ) {
 		cout << "Usage: " << argv[0] << " [options] meshfile.msh" << endl;
 		cout << "Options:" << endl;
 		cout << "  --gnuplot\t\tGenerate plot and animation from gnuplot" << endl;
 		cout << "  --interpolated\t\tInterpolate solution on vertices" << endl;
+		cout << "  --batched\t\tCompute fluxes once per edge with vectorized kernels" << endl;
+		cout << "  --validate-mixed\tCompare mixed precision against double precision" << endl;
+		cout << "  --validate-hybrid\tCompare the hybrid Rusanov/HLLC flux against HLLC" << endl;
+		cout << "  --monitor N\t\tRecord probes and a line-out along y=0.5 every N steps" << endl;
+		cout << "  --binary\t\tWrite the monitor file in binary format" << endl;
+		cout << "  --stages N\t\tTime integrator: 1 explicit Euler (default), 2 or 3 SSP Runge-Kutta" << endl;
+		cout << "  --validate-layout\tCompare AoS and SoA solution storage" << endl;
+		cout << "  --vtu\t\t\tAlso write frames in VTK format (.vtu/.pvtu)" << endl;
+		cout << "  --threads N\t\tUpdate the cells with N pinned threads (NUMA first-touch placement)" << endl;
+		cout << "  --validate-threads N\tCompare the run with N threads against the serial one, bit by bit" << endl;
+		cout << "  --mpi\t\t\tDistributed run, compared with the serial one (build with make mpi, run with mpirun)" << endl;
+		cout << "  --live NAME\t\tPublish the state in shared memory /NAME (read it with test/livefeed)" << endl;
+		cout << "  --live-every N\tSteps between two publications (default 1)" << endl;
+		cout << "  --stream N\t\tAnalyse N frames up to t=0.2 in process, without files" << endl;
+		cout << "  --async\t\tWith --stream, analyse snapshots on another thread" << endl;
+		cout << "  --flux NAME\t\tNumerical flux (default roe, also as euler/NAME): ";
+		Solver::Registry::instance().list(cout, "euler");
 		exit(1);
 	}
 	for (int i=1; i<argc; ++i) {
@@ -59,11 +344,73 @@ int main(int argc, char **argv) {
 			gnuplot = true;
 		else if (!strcmp(argv[i],"--interpolated"))
 			interpolated = true;
+		else if (!strcmp(argv[i],"--batched"))
+			batched = true;
+		else if (!strcmp(argv[i],"--validate-mixed"))
+			validate = true;
+		else if (!strcmp(argv[i],"--validate-hybrid"))
+			hybrid = true;
+		else if (!strcmp(argv[i],"--monitor") && i+1 < argc)
+			monitor = atoi(argv[++i]);
+		else if (!strcmp(argv[i],"--binary"))
+			binary = true;
+		else if (!strcmp(argv[i],"--stages") && i+1 < argc)
+			stages = atoi(argv[++i]);
+		else if (!strcmp(argv[i],"--validate-layout"))
+			layout = true;
+		else if (!strcmp(argv[i],"--vtu"))
+			vtu = true;
+		else if (!strcmp(argv[i],"--threads") && i+1 < argc)
+			threads = atoi(argv[++i]);
+		else if (!strcmp(argv[i],"--validate-threads") && i+1 < argc)
+			vthreads = atoi(argv[++i]);
+		else if (!strcmp(argv[i],"--mpi"))
+			mpi = true;
+		else if (!strcmp(argv[i],"--flux") && i+1 < argc)
+			flux = argv[++i];
+		else if (!strcmp(argv[i],"--live") && i+1 < argc)
+			live = argv[++i];
+		else if (!strcmp(argv[i],"--live-every") && i+1 < argc)
+			liveEvery = atoi(argv[++i]);
+		else if (!strcmp(argv[i],"--stream") && i+1 < argc)
+			stream = atoi(argv[++i]);
+		else if (!strcmp(argv[i],"--async"))
+			async = true;
 		else
 			meshfile = argv[i];
 	}
+	// Il flusso si puo' dare anche col nome completo del registro ("euler/hllc")
+	if (flux.compare(0, 6, "euler/") == 0)
+		flux = flux.substr(6);
 	// Definisco il modello (con gamma=1.4)
 	myModel model(1.4);
+	// Validazione della precisione mista
+	if (validate)
+		return validateMixed(model, meshfile);
+	// Validazione del flusso ibrido
+	if (hybrid)
+		return validateHybrid(model, meshfile);
+	// Validazione della disposizione della soluzione
+	if (layout)
+		return validateLayout(model, meshfile);
+	// Validazione dell'esecuzione con piu' thread
+	if (vthreads > 0)
+		return validateThreads(model, meshfile, vthreads);
+	// Analisi in linea
+	if (stream > 0)
+		return runStream(model, meshfile, stream, async);
+	// Esecuzione distribuita
+	if (mpi) {
+#ifdef CONSLAW2D_MPI
+		MPI_Init(&argc, &argv);
+		int ret = runDistributed(model, meshfile, vtu);
+		MPI_Finalize();
+		return ret;
+#else
+		cerr << "MPI support not compiled: build with make mpi" << endl;
+		return EXIT_FAILURE;
+#endif
+	}
 	// Definisco la mesh
 	myMesh mesh;
 	// Leggo la mesh
@@ -71,21 +418,43 @@ int main(int argc, char **argv) {
 	// Storing della geometria e output di alcune statistiche
 	mesh.init_geom();
 	mesh.stats();
-	// Definisco il solutore per il mio modello
-	mySolver solver(model, mesh);
+	// Solutore per il modello di Eulero con il flusso scelto per nome (con gamma=1.4)
+	Solver::Parameters params;
+	params["gamma"] = model.gamma();
+	std::shared_ptr<Solver::Simulation> solver = Solver::Registry::instance().create("euler", flux, mesh, params);
+	if ( !solver ) {
+		cerr << "Unknown flux " << flux << ", available: ";
+		Solver::Registry::instance().list(cerr, "euler");
+		return EXIT_FAILURE;
+	}
 	// Inizializzo alcuni parametri
-	solver.setCFLmax(0.1);
-	solver.setIC(init);
-	solver.setBC(bc);
-	solver.setDirectory("./data");
+	solver->setCFLmax(0.1);
+	solver->setIC(initArray);
+	solver->setBC(bcArray);
+	solver->setBatchedFluxes(batched);
+	solver->setTimeIntegrator(stages);
+	solver->setThreads(threads);
+	solver->setDirectory("./data");
+	// Sonde ai due lati della discontinuita' iniziale e linea lungo l'asse del canale
+	if ( monitor > 0 ) {
+		solver->addProbe(-0.5, 0.5);
+		solver->addProbe( 0.0, 0.5);
+		solver->addProbe( 0.5, 0.5);
+		solver->addLine(-1.0, 0.5, 1.0, 0.5, 201);
+		solver->setMonitor(binary ? "./data/monitor.bin" : "./data/monitor.csv", monitor, binary);
+	}
+	// Stato in memoria condivisa per i visualizzatori esterni
+	if ( !live.empty() )
+		solver->setLiveFeed(live, liveEvery);
 	// Inizializzo il solutore
-	solver.init();
+	solver->init();
 	// Passi temporali
 	for (int i = 0; i <= 500; ++i) {
-		std::cout << "== Timestep " << i << " == currtime: " << std::setw(8) << solver.getCurrTime();
-		std::cout << ", dt = " << std::setw(8) << solver.getCurrDt() << std::endl;
-		solver.timestep();
-		if (i%50 == 0) solver.framegrab(i/50, gnuplot, interpolated);
+		std::cout << "== Timestep " << i << " == currtime: " << std::setw(8) << solver->getCurrTime();
+		std::cout << ", dt = " << std::setw(8) << solver->getCurrDt() << std::endl;
+		solver->timestep();
+		if (i%50 == 0) solver->framegrab(i/50, gnuplot, interpolated);
+		if (vtu && i%50 == 0) solver->framegrabVTU(i/50);
 	}
 	return 0;
 }
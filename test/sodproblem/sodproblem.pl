@@ -9,16 +9,75 @@ if (@ARGV < 1) {
 	print("Options:\n");
 	print("  --gnuplot\t\tGenerate plot and animation from gnuplot\n");
 	print("  --interpolated\t\tInterpolate solution on vertices\n");
+	print("  --batched\t\tCompute fluxes once per edge with vectorized kernels\n");
+	print("  --validate-mixed\tCompare mixed precision against double precision\n");
+	print("  --validate-hybrid\tCompare the hybrid Rusanov/HLLC flux against HLLC\n");
+	print("  --monitor N\t\tRecord probes and a line-out along y=0.5 every N steps\n");
+	print("  --binary\t\tWrite the monitor file in binary format\n");
+	print("  --stages N\t\tTime integrator: 1 explicit Euler (default), 2 or 3 SSP Runge-Kutta\n");
+	print("  --validate-layout\tCompare AoS and SoA solution storage\n");
+	print("  --vtu\t\t\tAlso write frames in VTK format (.vtu/.pvtu)\n");
+	print("  --threads N\t\tUpdate the cells with N pinned threads (NUMA first-touch placement)\n");
+	print("  --validate-threads N\tCompare the run with N threads against the serial one, bit by bit\n");
+	print("  --mpi\t\t\tDistributed run, compared with the serial one (build with make mpi, run with mpirun)\n");
+	print("  --flux NAME\t\tNumerical flux (also as euler/NAME): roe (default), hll, hllc, rusanov, laxfriedrichs, hybrid\n");
+	print("  --live NAME\t\tPublish the state in shared memory /NAME (read it with test/livefeed)\n");
+	print("  --live-every N\tSteps between two publications (default 1)\n");
+	print("  --stream N\t\tAnalyse N frames up to t=0.2 in process, without files\n");
+	print("  --async\t\tWith --stream, analyse snapshots on another thread\n");
 	exit();
 }
 my $meshfile;
 $gnuplot = false;
 $interpolated = false;
+$batched = false;
+$nextmonitor = false;
+$nextstages = false;
+$nextthreads = false;
+$nextvthreads = false;
+$nextflux = false;
+$nextlive = false;
+$nextliveevery = false;
+$nextstream = false;
 foreach $arg (@ARGV) {
-	if ($arg eq "--gnuplot") {
+	if ($nextmonitor eq true) {
+		$nextmonitor = false;
+	} elsif ($nextstages eq true) {
+		$nextstages = false;
+	} elsif ($nextthreads eq true) {
+		$nextthreads = false;
+	} elsif ($nextvthreads eq true) {
+		$nextvthreads = false;
+	} elsif ($nextflux eq true) {
+		$nextflux = false;
+	} elsif ($nextlive eq true) {
+		$nextlive = false;
+	} elsif ($nextliveevery eq true) {
+		$nextliveevery = false;
+	} elsif ($nextstream eq true) {
+		$nextstream = false;
+	} elsif ($arg eq "--monitor") {
+		$nextmonitor = true;
+	} elsif ($arg eq "--stages") {
+		$nextstages = true;
+	} elsif ($arg eq "--threads") {
+		$nextthreads = true;
+	} elsif ($arg eq "--validate-threads") {
+		$nextvthreads = true;
+	} elsif ($arg eq "--flux") {
+		$nextflux = true;
+	} elsif ($arg eq "--live") {
+		$nextlive = true;
+	} elsif ($arg eq "--live-every") {
+		$nextliveevery = true;
+	} elsif ($arg eq "--stream") {
+		$nextstream = true;
+	} elsif ($arg eq "--gnuplot") {
 		$gnuplot = true;
 	} elsif($arg eq "--interpolated") {
 		$interpolated = true;
+	} elsif($arg eq "--batched") {
+		$batched = true;
 	} else {
 		$meshfile = $arg;
 	}
@@ -1,7 +1,11 @@
 #include <mesh/mesh_default_traits.hpp>
 #include <mesh/io/meshreader.hpp>
+#include <mesh/io/meshgenerator.hpp>
+#include <mesh/search/pointlocator.hpp>
+#include <mesh/partition/partitioner.hpp>
 
 #include <iostream>
+#include <cstring>
 #include <ctime>
 
 using namespace std;
@@ -11,21 +15,203 @@ using namespace ConservationLaw2D;
 typedef Mesh::DefaultTraits<double>	Traits;
 typedef Traits::PolygonalMesh		SimpleMesh;
 
+// Verifica della topologia: gemelli reciproci con vertici scambiati, area totale
+bool checkMesh( SimpleMesh& m ) {
+	bool ok = true;
+	double area(0);
+	size_t nboundary(0);
+	for (size_t i = 0; i < m.nE(); ++i) {
+		SimpleMesh::hedge_ptr e = m.e(i);
+		if ( e->isBoundary() ) {
+			nboundary++;
+			continue;
+		}
+		const SimpleMesh::HEdge& t = e->getTwinHEdge();
+		ok &= ( &t.getTwinHEdge() == e );
+		ok &= ( &t.vertexS() == &e->vertexE() ) && ( &t.vertexE() == &e->vertexS() );
+	}
+	for (size_t i = 0; i < m.nP(); ++i) {
+		ok &= ( m.p(i)->area() > 0 );
+		area += m.p(i)->area();
+	}
+	cout << "Check: " << (ok ? "ok" : "FAILED") << ", area " << area << ", boundary hedges " << nboundary << endl;
+	return ok;
+}
+
+// Localizzazione di punti: griglia, cammino lungo i lati e ricerca lineare a confronto
+bool checkLocator( SimpleMesh& m, size_t npoints ) {
+	typedef Mesh::PointLocator<SimpleMesh> Locator;
+	clock_t ck0 = clock();
+	Locator loc(m);
+	clock_t ck1 = clock();
+	cout << "Grid: " << loc.nBinsX() << " x " << loc.nBinsY() << ", build time: " << double(ck1-ck0)/CLOCKS_PER_SEC << " seconds" << endl;
+	// Bounding box della mesh
+	double xmin(m.v(0)->x()), xmax(xmin), ymin(m.v(0)->y()), ymax(ymin);
+	for (size_t i = 0; i < m.nV(); ++i) {
+		xmin = min(xmin, m.v(i)->x()); xmax = max(xmax, m.v(i)->x());
+		ymin = min(ymin, m.v(i)->y()); ymax = max(ymax, m.v(i)->y());
+	}
+	// Punti casuali e punti lungo la diagonale (line-out)
+	srand(1);
+	vector<double> x(npoints), y(npoints), lx(npoints), ly(npoints);
+	for (size_t i = 0; i < npoints; ++i) {
+		x[i] = xmin + (xmax-xmin)*rand()/RAND_MAX;
+		y[i] = ymin + (ymax-ymin)*rand()/RAND_MAX;
+		lx[i] = xmin + (xmax-xmin)*(i+0.5)/npoints;
+		ly[i] = ymin + (ymax-ymin)*(i+0.5)/npoints;
+	}
+	vector<size_t> ids(npoints), lids;
+	ck0 = clock();
+	for (size_t i = 0; i < npoints; ++i)
+		ids[i] = loc.locate(x[i], y[i]);
+	ck1 = clock();
+	double tgrid = double(ck1-ck0)/CLOCKS_PER_SEC;
+	ck0 = clock();
+	loc.locate(lx, ly, lids);
+	ck1 = clock();
+	double tline = double(ck1-ck0)/CLOCKS_PER_SEC;
+	// Confronto con la ricerca lineare (su un sottoinsieme)
+	bool ok = true;
+	size_t nbrute = min(npoints, size_t(200)), outside(0);
+	ck0 = clock();
+	for (size_t i = 0; i < nbrute; ++i) {
+		size_t found = size_t(Locator::NOPOLYGON);
+		for (size_t p = 0; p < m.nP() && found == size_t(Locator::NOPOLYGON); ++p)
+			if ( loc.contains(p, x[i], y[i]) ) found = p;
+		if ( found == size_t(Locator::NOPOLYGON) ) {
+			outside++;
+			ok &= ( ids[i] == found );
+			// Fuori dalla mesh: il piu' vicino deve contenere il punto o avere il baricentro piu' vicino
+			ok &= ( loc.nearest(x[i], y[i]) < m.nP() );
+		} else {
+			ok &= ( ids[i] != size_t(Locator::NOPOLYGON) ) && loc.contains(ids[i], x[i], y[i]);
+		}
+		size_t l = loc.locate(lx[i], ly[i]);
+		ok &= ( l == size_t(Locator::NOPOLYGON) ) ? ( lids[i] == l ) : loc.contains(lids[i], lx[i], ly[i]);
+	}
+	ck1 = clock();
+	double tbrute = double(ck1-ck0)/CLOCKS_PER_SEC;
+	cout << "Locate " << npoints << " random points: " << 1e6*tgrid/npoints << " us/point" << endl;
+	cout << "Locate " << npoints << " points on a line (walking): " << 1e6*tline/npoints << " us/point" << endl;
+	cout << "Linear scan: " << 1e6*tbrute/nbrute << " us/point (" << outside << " of " << nbrute << " outside)" << endl;
+	cout << "Check: " << (ok ? "ok" : "FAILED") << endl;
+	return ok;
+}
+
+// Partizione: bisezione delle coordinate e bisezione multilivello del grafo a confronto
+bool checkPartition( SimpleMesh& m, size_t nparts ) {
+	typedef Mesh::Partitioner<SimpleMesh> Partitioner;
+	bool ok = true;
+	Partitioner part(m);
+	const char* name[2] = { "RCB", "Multilevel" };
+	const Mesh::PartitionMethod method[2] = { Mesh::PARTITION_RCB, Mesh::PARTITION_MULTILEVEL };
+	for (int k = 0; k < 2; ++k) {
+		clock_t ck0 = clock();
+		part.partition(nparts, method[k]);
+		clock_t ck1 = clock();
+		// Ogni cella in una sola parte, parti non vuote
+		vector<int> seen(m.nP(), 0);
+		for (size_t j = 0; j < nparts; ++j) {
+			ok &= ( part.end(j) > part.begin(j) );
+			for (size_t i = part.begin(j); i < part.end(j); ++i) {
+				ok &= ( part.part()[part.order()[i]] == int(j) );
+				seen[part.order()[i]]++;
+			}
+		}
+		for (size_t i = 0; i < m.nP(); ++i) ok &= ( seen[i] == 1 );
+		cout << name[k] << ": edge cut " << part.edgeCut() << ", imbalance " << part.imbalance();
+		cout << ", time: " << double(ck1-ck0)/CLOCKS_PER_SEC << " seconds" << endl;
+	}
+	// Pesi: i lati di bordo costano come mezza cella
+	part.setBoundaryWeights(1.0, 0.5);
+	part.partition(nparts);
+	cout << "Multilevel, boundary weights: edge cut " << part.edgeCut() << ", imbalance " << part.imbalance() << endl;
+	cout << "Check: " << (ok ? "ok" : "FAILED") << endl;
+	return ok;
+}
+
 int main(int argc, char **argv) {
 	// Avvertimento
 	if ( argc < 2 ) {
-		cout << "Usage: " << argv[0] << " meshfile.msh" << endl;
+		cout << "Usage: " << argv[0] << " [options] meshfile.msh" << endl;
+		cout << "Options:" << endl;
+		cout << "  --reorder rcm|hilbert|morton\tRenumber the mesh for memory locality" << endl;
+		cout << "  --refine N\t\t\tUniformly refine the mesh N times (1:4)" << endl;
+		cout << "  --rectangle NX NY\t\tGenerate a structured mesh of the unit square instead of reading meshfile" << endl;
+		cout << "  --locate N\t\t\tLocate N points with the spatial index" << endl;
+		cout << "  --partition K\t\t\tSplit the mesh in K parts (coordinate and graph bisection)" << endl;
 		exit(EXIT_SUCCESS);
 	}
+	string meshfile, ordering;
+	int refine(0), rnx(0), rny(0), nlocate(0), nparts(0);
+	for (int i=1; i<argc; ++i) {
+		if (!strcmp(argv[i],"--reorder") && i+1 < argc)
+			ordering = argv[++i];
+		else if (!strcmp(argv[i],"--refine") && i+1 < argc)
+			refine = atoi(argv[++i]);
+		else if (!strcmp(argv[i],"--locate") && i+1 < argc)
+			nlocate = atoi(argv[++i]);
+		else if (!strcmp(argv[i],"--partition") && i+1 < argc)
+			nparts = atoi(argv[++i]);
+		else if (!strcmp(argv[i],"--rectangle") && i+2 < argc) {
+			rnx = atoi(argv[++i]);
+			rny = atoi(argv[++i]);
+		} else
+			meshfile = argv[i];
+	}
+	if ( !ordering.empty() && ordering != "rcm" && ordering != "hilbert" && ordering != "morton" ) {
+		cerr << "Unknown ordering " << ordering << ", available: rcm hilbert morton" << endl;
+		exit(1);
+	}
 	// Cronometro
 	clock_t ck0, ck1;
 	// Leggo la mesh
 	cout << "====== READING MESH ======" << endl;
 	SimpleMesh m;
 	ck0=clock();
-	Mesh::IO::MeshReader(m, argv[1]);
+	if ( rnx > 0 )
+		Mesh::IO::RectangleMesh(m, 0.0, 1.0, 0.0, 1.0, rnx, rny);
+	else
+		Mesh::IO::MeshReader(m, meshfile);
 	ck1=clock();
 	m.stats();
 	cout << "Time: " << double(ck1-ck0)/CLOCKS_PER_SEC << " seconds" << endl;
-	return 0;
+	bool ok = checkMesh(m);
+	// Raffinamento
+	for (int r = 0; r < refine; ++r) {
+		cout << "====== REFINING MESH ======" << endl;
+		ck0=clock();
+		m.refine();
+		ck1=clock();
+		m.stats();
+		cout << "Time: " << double(ck1-ck0)/CLOCKS_PER_SEC << " seconds" << endl;
+		ok &= checkMesh(m);
+	}
+	// Rinumerazione
+	if ( !ordering.empty() ) {
+		cout << "====== REORDERING MESH ======" << endl;
+		ck0=clock();
+		if ( ordering == "rcm" )
+			m.reorder(Mesh::ORDERING_RCM);
+		else if ( ordering == "hilbert" )
+			m.reorder(Mesh::ORDERING_HILBERT);
+		else
+			m.reorder(Mesh::ORDERING_MORTON);
+		ck1=clock();
+		m.stats();
+		cout << "Time: " << double(ck1-ck0)/CLOCKS_PER_SEC << " seconds" << endl;
+		// La rinumerazione riscrive tutte le liste: stessi controlli della mesh letta
+		ok &= checkMesh(m);
+	}
+	// Localizzazione di punti
+	if ( nlocate > 0 ) {
+		cout << "====== LOCATING POINTS ======" << endl;
+		ok &= checkLocator(m, nlocate);
+	}
+	// Partizione
+	if ( nparts > 0 ) {
+		cout << "====== PARTITIONING MESH ======" << endl;
+		ok &= checkPartition(m, nparts);
+	}
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
 }